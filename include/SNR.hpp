@@ -18,6 +18,9 @@
 #include <cmath>
 #include <map>
 #include <fstream>
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
 
 #include <Kernel.hpp>
 #include <Observation.hpp>
@@ -34,22 +37,170 @@ public:
   ~snrConf();
   // Get
   bool getSubbandDedispersion() const;
+  bool getSubgroupReduction() const;
+  unsigned int getNrSlices() const;
+  unsigned int getVectorWidth() const;
+  unsigned int getTransposeTile() const;
   // Set
   void setSubbandDedispersion(bool subband);
+  void setSubgroupReduction(bool subgroup);
+  void setNrSlices(unsigned int slices);
+  void setVectorWidth(unsigned int width);
+  void setTransposeTile(unsigned int tile);
   // utils
+  // Subband dedispersion and the KernelConf fields, followed by subgroup, slices, vector width and transpose tile only if one of them is not the default
   std::string print() const;
+  // Same as print, with the last four fields always present
+  std::string print(const bool allFields) const;
 
 private:
   bool subbandDedispersion;
+  // Reduce the DMsSamples partials inside sub-groups first (cl_khr_subgroups)
+  bool subgroupReduction;
+  // Number of work-groups sharing the samples of the same DMs in the sliced SamplesDMs kernel
+  unsigned int nrSlices;
+  // Contiguous elements read with one vector load by the generic DMsSamples and SamplesDMs kernels: 1, 2, 4 or 8, dividing nrItemsD0 and, for DMsSamples, nrSamples
+  unsigned int vectorWidth;
+  // Layout of the SNR kernel: 0 for the layout of the input, otherwise the input is first transposed in tiles of transposeTile x transposeTile elements and the kernel of the other layout is used
+  unsigned int transposeTile;
 };
 
 typedef std::map<std::string, std::map<unsigned int, std::map<unsigned int, SNR::snrConf *> *> *> tunedSNRConf;
 
+// Tuned configurations stored in a contiguous array sorted by (device, nrDMs, nrSamples)
+//
+// Exact lookups are O(log n); shapes that were not tuned get the configuration of the closest tuned shape of the same device
+// that is valid for the shape, with distance measured on the logarithm of nrDMs and nrSamples, scanning all the entries of the device.
+class snrConfTable {
+public:
+  struct entry {
+    unsigned int device;
+    unsigned int nrDMs;
+    unsigned int nrSamples;
+    snrConf conf;
+  };
+
+  snrConfTable();
+  ~snrConfTable();
+  // Get
+  unsigned int size() const;
+  const std::vector<std::string> & getDevices() const;
+  // Entries of one device, sorted by (nrDMs, nrSamples)
+  std::pair<std::vector<entry>::const_iterator, std::vector<entry>::const_iterator> getEntries(const std::string & deviceName) const;
+  // Set
+  void insert(const std::string & deviceName, const unsigned int nrDMs, const unsigned int nrSamples, const snrConf & conf);
+  // utils
+  bool contains(const std::string & deviceName, const unsigned int nrDMs, const unsigned int nrSamples) const;
+  // Exact match, or the closest tuned shape with a valid configuration for an input in the DMsSamples, or SamplesDMs, layout; throws std::out_of_range if there is none
+  const snrConf & getConf(const std::string & deviceName, const bool DMsSamples, const unsigned int nrDMs, const unsigned int nrSamples) const;
+  // Read the text format written by the analysis scripts; later entries replace earlier ones with the same key
+  void read(const std::string & filename);
+  // Binary serialization, one format version: "SNRT", version, number of devices and entries, the device names, then per entry device, DMs, samples, subband (bit 0) and sub-group (bit 1) flags,
+  // threads and items in the three dimensions, slices, vector width and transpose tile; files of any other version are rejected with AstroData::FileError, as malformed or truncated files
+  void readBinary(const std::string & filename);
+  void writeBinary(const std::string & filename) const;
+
+private:
+  static const uint32_t binaryVersion = 1;
+  static const uint32_t binaryEntrySize = 13;
+  static const uint32_t maxDeviceNameLength = 4096;
+  std::vector<std::string> devices;
+  std::vector<entry> entries;
+
+  unsigned int getDevice(const std::string & deviceName);
+  void sort();
+};
+
+// Record written by the threshold and top-K kernels, four unsigned int per candidate
+struct snrCandidate {
+  unsigned int beam;
+  unsigned int dm;
+  unsigned int sample;
+  float snr;
+};
+
+// Host storage of OpenCL half values, converted to and from float with round to nearest even
+class snrHalf {
+public:
+  snrHalf();
+  snrHalf(const float value);
+  operator float() const;
+
+private:
+  uint16_t value;
+};
+
 // OpenCL SNR
+// The DMsSamples kernels run (nrThreadsD0, nrDMs / nrItemsD1, beams) work-items in groups of (nrThreadsD0, nrThreadsD1, 1); every work-group processes nrThreadsD1 * nrItemsD1 DMs,
+// and every work-item nrItemsD1 DMs nrThreadsD1 apart; requires nrDMs % (nrThreadsD1 * nrItemsD1) == 0. The boxcar, sigma clip and runtime ones only support nrThreadsD1 and nrItemsD1 of 1, one DM per work-group.
+// The SamplesDMs kernels, except the sliced one, run (nrDMs / nrItemsD0, beams) work-items in groups of (nrThreadsD0, 1); every work-group processes nrThreadsD0 * nrItemsD0 DMs, and every work-item nrItemsD0 of them; requires nrDMs % (nrThreadsD0 * nrItemsD0) == 0.
 template<typename T> std::string * getSNRDMsSamplesOpenCL(const snrConf & conf, const std::string & dataName, const AstroData::Observation & observation, const unsigned int nrSamples, const unsigned int padding);
 template<typename T> std::string * getSNRSamplesDMsOpenCL(const snrConf & conf, const std::string & dataName, const AstroData::Observation & observation, const unsigned int nrSamples, const unsigned int padding);
-// Read configuration files
+// OpenCL SNR, only candidates with SNR above a threshold are appended to a compacted buffer
+template<typename T> std::string * getSNRDMsSamplesThresholdOpenCL(const snrConf & conf, const std::string & dataName, const AstroData::Observation & observation, const unsigned int nrSamples, const unsigned int padding, const unsigned int maxCandidates);
+template<typename T> std::string * getSNRSamplesDMsThresholdOpenCL(const snrConf & conf, const std::string & dataName, const AstroData::Observation & observation, const unsigned int nrSamples, const unsigned int padding, const unsigned int maxCandidates);
+// OpenCL SNR with number of samples and DMs as kernel arguments, one binary serves every observation shape; requires nrSamples >= (nrThreadsD0 * nrItemsD0) for DMsSamples
+template<typename T> std::string * getSNRDMsSamplesRuntimeOpenCL(const snrConf & conf, const std::string & dataName, const unsigned int padding);
+template<typename T> std::string * getSNRSamplesDMsRuntimeOpenCL(const snrConf & conf, const std::string & dataName, const unsigned int padding);
+// OpenCL streaming SNR, the statistics are merged with the (count, mean, M2, unused) state of every beam and DM kept on device between batches; with decay < 1 the previous state is exponentially forgotten
+template<typename T> std::string * getSNRDMsSamplesStreamingOpenCL(const snrConf & conf, const std::string & dataName, const AstroData::Observation & observation, const unsigned int nrSamples, const unsigned int padding, const float decay);
+template<typename T> std::string * getSNRSamplesDMsStreamingOpenCL(const snrConf & conf, const std::string & dataName, const AstroData::Observation & observation, const unsigned int nrSamples, const unsigned int padding, const float decay);
+// OpenCL SNR of quantized data, the values are (input * scale[dm]) + offset[dm] with scale > 0; scale and offset are the last two kernel arguments
+// The transformation is applied to the statistics of every DM, so it only changes the result when merged with the state of other batches
+template<typename T> std::string * getSNRDMsSamplesScaledOpenCL(const snrConf & conf, const std::string & dataName, const AstroData::Observation & observation, const unsigned int nrSamples, const unsigned int padding, const bool streaming, const float decay);
+template<typename T> std::string * getSNRSamplesDMsScaledOpenCL(const snrConf & conf, const std::string & dataName, const AstroData::Observation & observation, const unsigned int nrSamples, const unsigned int padding, const bool streaming, const float decay);
+// OpenCL SamplesDMs streaming SNR that also stores, for every beam and sample, the highest value normalized with the statistics of the previous batches and its DM
+// The time series is a 64 bits key per sample, zeroed before the launch and decoded with getTimeSeriesValue and getTimeSeriesDM
+// Every sample is reduced over the work-group with a tree in local memory, or with sub_group_reduce_max and one local atom_max per sub-group if the sub-group reduction is enabled
+// The keys of a chunk of nrThreadsD0 samples are kept in local memory and combined with global atom_max; throws std::invalid_argument if they do not fit in maxLocalMemory bytes
+// Without a previous state, i.e. in the first batch, the values are normalized with the statistics of this batch, at the cost of reading it twice
+template<typename T> std::string * getSNRSamplesDMsTimeSeriesOpenCL(const snrConf & conf, const std::string & dataName, const AstroData::Observation & observation, const unsigned int nrSamples, const unsigned int padding, const float decay, const uint64_t maxLocalMemory);
+float getTimeSeriesValue(const uint64_t key);
+unsigned int getTimeSeriesDM(const uint64_t key);
+// OpenCL boxcar SNR, the best SNR, width and first sample are stored; every sample is read once, and every boxcar is the difference of two prefix sums in local memory
+// The local memory grows with the largest width; throws std::invalid_argument if widths is empty, a width is 0 or larger than nrSamples, or the local memory does not fit in maxLocalMemory bytes
+template<typename T> std::string * getSNRDMsSamplesBoxcarOpenCL(const snrConf & conf, const std::string & dataName, const AstroData::Observation & observation, const unsigned int nrSamples, const unsigned int padding, const std::vector<unsigned int> & widths, const uint64_t maxLocalMemory);
+// OpenCL sigma clipped SNR, mean and standard deviation are recomputed nrIterations times excluding the samples further than sigma standard deviations from the mean
+template<typename T> std::string * getSNRDMsSamplesSigmaClipOpenCL(const snrConf & conf, const std::string & dataName, const AstroData::Observation & observation, const unsigned int nrSamples, const unsigned int padding, const unsigned int nrIterations, const float sigma);
+template<typename T> std::string * getSNRSamplesDMsSigmaClipOpenCL(const snrConf & conf, const std::string & dataName, const AstroData::Observation & observation, const unsigned int nrSamples, const unsigned int padding, const unsigned int nrIterations, const float sigma);
+// OpenCL SNR with the best trial of every subbanding DM step and of every beam, as keys combined with atom_max in zeroed buffers of padded nrSubbandingDMs and nrBeams elements
+// Without subband dedispersion there is one step with all DMs; with fullOutput the SNR and sample of every trial are also stored, before the hierarchical outputs in the arguments
+// The keys are decoded with getBestSNR, getBestDM and getBestSample; throws std::invalid_argument if nrDMs * nrSamples > 2^32
+template<typename T> std::string * getSNRDMsSamplesHierarchicalOpenCL(const snrConf & conf, const std::string & dataName, const AstroData::Observation & observation, const unsigned int nrSamples, const unsigned int padding, const bool fullOutput);
+template<typename T> std::string * getSNRSamplesDMsHierarchicalOpenCL(const snrConf & conf, const std::string & dataName, const AstroData::Observation & observation, const unsigned int nrSamples, const unsigned int padding, const bool fullOutput);
+float getBestSNR(const uint64_t key);
+unsigned int getBestDM(const uint64_t key, const unsigned int nrSamples);
+unsigned int getBestSample(const uint64_t key, const unsigned int nrSamples);
+// OpenCL SamplesDMs SNR in two stages, for few DMs or long batches
+// The sliced kernel runs (nrDMs / nrItemsD0, nrSlices, beams) work-items, every slice of the samples stores the partial (count, mean, M2, max) and sample of the max of its DMs
+// The merge kernel runs like getSNRSamplesDMsOpenCL and combines the nrSlices partials of every DM in the outputs; requires nrSlices <= nrSamples
+template<typename T> std::string * getSNRSamplesDMsSlicedOpenCL(const snrConf & conf, const std::string & dataName, const AstroData::Observation & observation, const unsigned int nrSamples, const unsigned int padding);
+std::string * getSNRSamplesDMsMergeOpenCL(const snrConf & conf, const AstroData::Observation & observation, const unsigned int nrSamples, const unsigned int padding);
+// OpenCL tiled transpose of the input from the layout DMsSamples to the other one, through local memory, with tiles of conf.getTransposeTile() x conf.getTransposeTile() elements
+// The kernel runs (pad(inner, tile), pad(outer, tile), beams) work-items in groups of (tile, tile, 1), with inner and outer the dimensions of the input; the padding of the output is the one of the other layout
+template<typename T> std::string * getSNRTransposeOpenCL(const snrConf & conf, const std::string & dataName, const AstroData::Observation & observation, const unsigned int nrSamples, const unsigned int padding, const bool DMsSamples);
+// OpenCL top-K, the K candidates with highest SNR of every beam are selected from the output of the SNR kernels
+std::string * getSNRTopKOpenCL(const snrConf & conf, const AstroData::Observation & observation, const unsigned int nrCandidates, const unsigned int padding);
+// OpenCL STREAM-like bandwidth probes on float4 buffers: bandwidthCopy copies one element per work-item, bandwidthRead reads nrItemsPerThread elements per work-item without storing them
+std::string * getBandwidthOpenCL(const unsigned int nrItemsPerThread);
+// Expression reading element index of pointer as float; inputs can be float, half, or integer types
+std::string getSNRInputLoad(const std::string & dataName, const std::string & pointer, const std::string & index);
+// Expression reading width contiguous elements, starting at element index of pointer, as a float vector; the index needs no alignment
+std::string getSNRInputLoad(const std::string & dataName, const std::string & pointer, const std::string & index, const unsigned int width);
+// Item of a kernel template, with <%NUM%>, <%OFFSET%>, <%VECTOR%> and <%COMPONENT%> replaced; " + <%OFFSET%>" is removed when the offset is zero
+std::string getSNRItemCode(const std::string & code, const std::string & num, const std::string & offset, const std::string & vector, const std::string & component);
+// Generic SNR generators used by the functions above
+template<typename T> std::string * getSNRDMsSamplesKernelOpenCL(const snrConf & conf, const std::string & dataName, const AstroData::Observation & observation, const unsigned int nrSamples, const unsigned int padding, const bool threshold, const unsigned int maxCandidates, const bool streaming, const float decay, const bool scaled, const bool hierarchical, const bool fullOutput);
+template<typename T> std::string * getSNRSamplesDMsKernelOpenCL(const snrConf & conf, const std::string & dataName, const AstroData::Observation & observation, const unsigned int nrSamples, const unsigned int padding, const bool threshold, const unsigned int maxCandidates, const bool streaming, const float decay, const bool scaled, const bool hierarchical, const bool fullOutput);
+// Compiler flags for the SNR kernels of conf; the sub-group reduction requires OpenCL C 2.0
+std::string getSNRBuildFlags(const snrConf & conf);
+// True if the device can build the SNR kernels of conf; the sub-group reduction requires cl_khr_subgroups
+bool isSupportedSNRConf(const snrConf & conf, const cl::Device & device);
+// True if the configuration can run the dense, sliced, or transposed kernels for the shape; DMsSamples is the layout of the SNR kernel
+bool isValidSNRConf(const snrConf & conf, const bool DMsSamples, const unsigned int nrDMs, const unsigned int nrSamples);
+// Read configuration files; the table also reads the binary format
 void readTunedSNRConf(tunedSNRConf & tunedSNR, const std::string & snrFilename);
+void readTunedSNRConf(snrConfTable & tunedSNR, const std::string & snrFilename);
 
 
 // Implementations
@@ -57,34 +208,438 @@ inline bool snrConf::getSubbandDedispersion() const {
   return subbandDedispersion;
 }
 
+inline bool snrConf::getSubgroupReduction() const {
+  return subgroupReduction;
+}
+
+inline unsigned int snrConf::getNrSlices() const {
+  return nrSlices;
+}
+
+inline unsigned int snrConf::getVectorWidth() const {
+  return vectorWidth;
+}
+
+inline unsigned int snrConf::getTransposeTile() const {
+  return transposeTile;
+}
+
 inline void snrConf::setSubbandDedispersion(bool subband) {
   subbandDedispersion = subband;
 }
 
+inline void snrConf::setSubgroupReduction(bool subgroup) {
+  subgroupReduction = subgroup;
+}
+
+inline void snrConf::setNrSlices(unsigned int slices) {
+  nrSlices = slices;
+}
+
+inline void snrConf::setVectorWidth(unsigned int width) {
+  vectorWidth = width;
+}
+
+inline void snrConf::setTransposeTile(unsigned int tile) {
+  transposeTile = tile;
+}
+
+inline snrHalf::snrHalf() : value(0) {}
+
+inline unsigned int snrConfTable::size() const {
+  return entries.size();
+}
+
+inline const std::vector<std::string> & snrConfTable::getDevices() const {
+  return devices;
+}
+
 template<typename T> std::string * getSNRDMsSamplesOpenCL(const snrConf & conf, const std::string & dataName, const AstroData::Observation & observation, const unsigned int nrSamples, const unsigned int padding) {
+  return getSNRDMsSamplesKernelOpenCL<T>(conf, dataName, observation, nrSamples, padding, false, 0, false, 1.0f, false, false, true);
+}
+
+template<typename T> std::string * getSNRDMsSamplesThresholdOpenCL(const snrConf & conf, const std::string & dataName, const AstroData::Observation & observation, const unsigned int nrSamples, const unsigned int padding, const unsigned int maxCandidates) {
+  return getSNRDMsSamplesKernelOpenCL<T>(conf, dataName, observation, nrSamples, padding, true, maxCandidates, false, 1.0f, false, false, true);
+}
+
+template<typename T> std::string * getSNRDMsSamplesStreamingOpenCL(const snrConf & conf, const std::string & dataName, const AstroData::Observation & observation, const unsigned int nrSamples, const unsigned int padding, const float decay) {
+  return getSNRDMsSamplesKernelOpenCL<T>(conf, dataName, observation, nrSamples, padding, false, 0, true, decay, false, false, true);
+}
+
+template<typename T> std::string * getSNRDMsSamplesScaledOpenCL(const snrConf & conf, const std::string & dataName, const AstroData::Observation & observation, const unsigned int nrSamples, const unsigned int padding, const bool streaming, const float decay) {
+  return getSNRDMsSamplesKernelOpenCL<T>(conf, dataName, observation, nrSamples, padding, false, 0, streaming, decay, true, false, true);
+}
+
+template<typename T> std::string * getSNRDMsSamplesHierarchicalOpenCL(const snrConf & conf, const std::string & dataName, const AstroData::Observation & observation, const unsigned int nrSamples, const unsigned int padding, const bool fullOutput) {
+  return getSNRDMsSamplesKernelOpenCL<T>(conf, dataName, observation, nrSamples, padding, false, 0, false, 1.0f, false, true, fullOutput);
+}
+
+template<typename T> std::string * getSNRDMsSamplesKernelOpenCL(const snrConf & conf, const std::string & dataName, const AstroData::Observation & observation, const unsigned int nrSamples, const unsigned int padding, const bool threshold, const unsigned int maxCandidates, const bool streaming, const float decay, const bool scaled, const bool hierarchical, const bool fullOutput) {
   unsigned int nrDMs = 0;
+  // Every DM of the work-group has its own row of nrThreadsD0 elements in local memory
+  const unsigned int nrRows = conf.getNrThreadsD1() * conf.getNrItemsD1();
   std::string * code = new std::string();
+  // With vector loads every thread starts at vectorWidth contiguous samples
+  std::string first_s = "get_local_id(0)";
+  std::string dm_s = "get_group_id(1)";
 
   if ( conf.getSubbandDedispersion() ) {
     nrDMs = observation.getNrDMs(true) * observation.getNrDMs();
   } else {
     nrDMs = observation.getNrDMs();
   }
+  // The position of the best trial, dm * nrSamples + sample, is stored in the low 32 bits of the hierarchical keys
+  if ( hierarchical && (static_cast<uint64_t>(nrDMs) * nrSamples) > (static_cast<uint64_t>(1) << 32) ) {
+    throw std::invalid_argument("The hierarchical keys require nrDMs * nrSamples <= 2^32, not " + std::to_string(static_cast<uint64_t>(nrDMs) * nrSamples) + ".");
+  }
+  if ( conf.getVectorWidth() > 1 ) {
+    first_s = "(get_local_id(0) * " + std::to_string(conf.getVectorWidth()) + ")";
+  }
+  if ( (conf.getNrThreadsD1() * conf.getNrItemsD1()) > 1 ) {
+    dm_s = "(get_group_id(1) * " + std::to_string(conf.getNrThreadsD1() * conf.getNrItemsD1()) + ")";
+    if ( conf.getNrThreadsD1() > 1 ) {
+      dm_s += " + get_local_id(1)";
+    }
+  }
+  // Begin kernel's template
+  *code = "<%EXTENSION%>"
+    "<%SIGNATURE%>"
+    "unsigned int dm = " + dm_s + ";\n"
+    "unsigned int beam = get_group_id(2);\n"
+    "float delta = 0.0f;\n"
+    "__local float reductionCOU[" + std::to_string(isa::utils::pad(conf.getNrThreadsD0() * nrRows, padding / sizeof(float))) + "];\n"
+    "__local float reductionMAX[" + std::to_string(isa::utils::pad(conf.getNrThreadsD0() * nrRows, padding / sizeof(float))) + "];\n"
+    "__local unsigned int reductionSAM[" + std::to_string(isa::utils::pad(conf.getNrThreadsD0() * nrRows, padding / sizeof(unsigned int))) + "];\n"
+    "__local float reductionMEA[" + std::to_string(isa::utils::pad(conf.getNrThreadsD0() * nrRows, padding / sizeof(float))) + "];\n"
+    "__local float reductionVAR[" + std::to_string(isa::utils::pad(conf.getNrThreadsD0() * nrRows, padding / sizeof(float))) + "];\n"
+    "<%DEF%>"
+    "\n"
+    "// Compute phase\n"
+    "for ( unsigned int sample = " + first_s + " + " + std::to_string(conf.getNrThreadsD0() * conf.getNrItemsD0()) + "; sample < " + std::to_string(nrSamples) + "; sample += " + std::to_string(conf.getNrThreadsD0() * conf.getNrItemsD0()) + " ) {\n"
+    "float item = 0.0f;\n"
+    "<%COMPUTE%>"
+    "}\n"
+    "// In-thread reduce\n"
+    "<%REDUCE%>"
+    "<%LOCAL_REDUCE%>"
+    "// Store\n"
+    "if ( get_local_id(0) == 0 ) {\n"
+    "<%STORE%>"
+    "}\n"
+    "}\n";
+  std::string extension_s;
+  std::string localStore_s;
+  std::string localReduce_s;
+  std::string localStore_sTemplate;
+  std::string localReduce_sTemplate;
+  if ( hierarchical ) {
+    extension_s = "#pragma OPENCL EXTENSION cl_khr_int64_extended_atomics : enable\n";
+  }
+  // Sub-groups can span rows of a work-group, so the sub-group reduction is only used with nrThreadsD1 == 1
+  if ( conf.getSubgroupReduction() && conf.getNrThreadsD1() == 1 ) {
+    // Only the partials of the sub-groups go through local memory
+    extension_s += "#pragma OPENCL EXTENSION cl_khr_subgroups : enable\n";
+    localStore_sTemplate = "float subCounter = sub_group_reduce_add(counter<%NUM%>);\n"
+      "float subMean = sub_group_reduce_add(counter<%NUM%> * mean<%NUM%>) / subCounter;\n"
+      "delta = mean<%NUM%> - subMean;\n"
+      "variance<%NUM%> = sub_group_reduce_add(variance<%NUM%> + ((delta * delta) * counter<%NUM%>));\n"
+      "float subMax = sub_group_reduce_max(max<%NUM%>);\n"
+      "maxSample<%NUM%> = sub_group_reduce_min((max<%NUM%> == subMax) ? maxSample<%NUM%> : 0xFFFFFFFF);\n"
+      "counter<%NUM%> = subCounter;\n"
+      "mean<%NUM%> = subMean;\n"
+      "max<%NUM%> = subMax;\n"
+      "// Local memory store\n"
+      "if ( get_sub_group_local_id() == 0 ) {\n"
+      "reductionCOU[<%ROW%>get_sub_group_id()] = counter<%NUM%>;\n"
+      "reductionMAX[<%ROW%>get_sub_group_id()] = max<%NUM%>;\n"
+      "reductionSAM[<%ROW%>get_sub_group_id()] = maxSample<%NUM%>;\n"
+      "reductionMEA[<%ROW%>get_sub_group_id()] = mean<%NUM%>;\n"
+      "reductionVAR[<%ROW%>get_sub_group_id()] = variance<%NUM%>;\n"
+      "}\n";
+    if ( conf.getNrItemsD1() > 1 ) {
+      localStore_sTemplate = "{\n" + localStore_sTemplate + "}\n";
+    }
+    localStore_sTemplate = "// Sub-group reduce\n" + localStore_sTemplate;
+    localReduce_sTemplate = "delta = reductionMEA[<%ROW%>subgroup] - mean<%NUM%>;\n"
+      "counter<%NUM%> += reductionCOU[<%ROW%>subgroup];\n"
+      "mean<%NUM%> = (((counter<%NUM%> - reductionCOU[<%ROW%>subgroup]) * mean<%NUM%>) + (reductionCOU[<%ROW%>subgroup] * reductionMEA[<%ROW%>subgroup])) / counter<%NUM%>;\n"
+      "variance<%NUM%> += reductionVAR[<%ROW%>subgroup] + ((delta * delta) * (((counter<%NUM%> - reductionCOU[<%ROW%>subgroup]) * reductionCOU[<%ROW%>subgroup]) / counter<%NUM%>));\n"
+      "if ( reductionMAX[<%ROW%>subgroup] - max<%NUM%> > 0.0f ) {\n"
+      "max<%NUM%> = reductionMAX[<%ROW%>subgroup];\n"
+      "maxSample<%NUM%> = reductionSAM[<%ROW%>subgroup];\n"
+      "}\n";
+  } else {
+    localStore_sTemplate = "reductionCOU[<%ROW%>get_local_id(0)] = counter<%NUM%>;\n"
+      "reductionMAX[<%ROW%>get_local_id(0)] = max<%NUM%>;\n"
+      "reductionSAM[<%ROW%>get_local_id(0)] = maxSample<%NUM%>;\n"
+      "reductionMEA[<%ROW%>get_local_id(0)] = mean<%NUM%>;\n"
+      "reductionVAR[<%ROW%>get_local_id(0)] = variance<%NUM%>;\n";
+    localReduce_sTemplate = "delta = reductionMEA[<%ROW%>sample + threshold] - mean<%NUM%>;\n"
+      "counter<%NUM%> += reductionCOU[<%ROW%>sample + threshold];\n"
+      "mean<%NUM%> = ((reductionCOU[<%ROW%>sample] * mean<%NUM%>) + (reductionCOU[<%ROW%>sample + threshold] * reductionMEA[<%ROW%>sample + threshold])) / counter<%NUM%>;\n"
+      "variance<%NUM%> += reductionVAR[<%ROW%>sample + threshold] + ((delta * delta) * ((reductionCOU[<%ROW%>sample] * reductionCOU[<%ROW%>sample + threshold]) / counter<%NUM%>));\n"
+      "if ( reductionMAX[<%ROW%>sample + threshold] - max<%NUM%> > 0.0f ) {\n"
+      "max<%NUM%> = reductionMAX[<%ROW%>sample + threshold];\n"
+      "maxSample<%NUM%> = reductionSAM[<%ROW%>sample + threshold];\n"
+      "}\n"
+      "reductionCOU[<%ROW%>sample] = counter<%NUM%>;\n"
+      "reductionMAX[<%ROW%>sample] = max<%NUM%>;\n"
+      "reductionSAM[<%ROW%>sample] = maxSample<%NUM%>;\n"
+      "reductionMEA[<%ROW%>sample] = mean<%NUM%>;\n"
+      "reductionVAR[<%ROW%>sample] = variance<%NUM%>;\n";
+  }
+  std::string signature_s;
+  std::string state_s;
+  std::string scale_s;
+  std::string stdDev_s;
+  std::string store_s;
+  if ( scaled ) {
+    // Statistics of (input * scale) + offset
+    scale_s = ", __global const float * const restrict scale, __global const float * const restrict offset";
+    store_s = "mean0 = mad(mean0, scale[dm], offset[dm]);\n"
+      "max0 = mad(max0, scale[dm], offset[dm]);\n"
+      "variance0 *= scale[dm] * scale[dm];\n";
+  }
+  if ( streaming ) {
+    // Parallel merge of the batch statistics with the state of the previous batches
+    state_s = "__global float4 * const restrict state, ";
+    stdDev_s = "native_sqrt(variance0 / (counter0 - 1.0f))";
+    store_s += "float4 previous = state[(beam * " + std::to_string(nrDMs) + ") + dm];\n";
+    if ( decay < 1.0f ) {
+      store_s += "previous.x *= " + std::to_string(decay) + "f;\n"
+        "previous.z *= " + std::to_string(decay) + "f;\n";
+    }
+    store_s += "if ( previous.x > 0.0f ) {\n"
+      "delta = mean0 - previous.y;\n"
+      "counter0 += previous.x;\n"
+      "mean0 = ((previous.x * previous.y) + ((counter0 - previous.x) * mean0)) / counter0;\n"
+      "variance0 += previous.z + ((delta * delta) * ((previous.x * (counter0 - previous.x)) / counter0));\n"
+      "}\n"
+      "state[(beam * " + std::to_string(nrDMs) + ") + dm] = (float4)(counter0, mean0, variance0, 0.0f);\n";
+  } else {
+    stdDev_s = "native_sqrt(variance0 * " + std::to_string(1.0f / (nrSamples - 1)) + "f)";
+  }
+  if ( threshold ) {
+    signature_s = "__kernel void snrDMsSamplesThreshold<%STREAMING%>" + std::to_string(nrSamples) + "(__global const " + dataName + " * const restrict input, " + state_s + "const float snrThreshold, __global unsigned int * const restrict candidates, volatile __global unsigned int * const restrict nrCandidates" + scale_s + ") {\n";
+    store_s += "float snr = (max0 - mean0) / " + stdDev_s + ";\n"
+      "if ( snr >= snrThreshold ) {\n"
+      "unsigned int candidate = atomic_inc(nrCandidates);\n"
+      "if ( candidate < " + std::to_string(maxCandidates) + " ) {\n"
+      "candidates[(candidate * 4)] = beam;\n"
+      "candidates[(candidate * 4) + 1] = dm;\n"
+      "candidates[(candidate * 4) + 2] = maxSample0;\n"
+      "candidates[(candidate * 4) + 3] = as_uint(snr);\n"
+      "}\n"
+      "}\n";
+  } else {
+    std::string outputs_s;
+    if ( fullOutput ) {
+      outputs_s = "__global float * const restrict outputSNR, __global unsigned int * const restrict outputSample";
+      store_s += "outputSNR[(beam * " + std::to_string(isa::utils::pad(nrDMs, padding / sizeof(float))) + ") + dm] = (max0 - mean0) / " + stdDev_s + ";\n"
+        "outputSample[(beam * " + std::to_string(isa::utils::pad(nrDMs, padding / sizeof(unsigned int))) + ") + dm] = maxSample0;\n";
+    }
+    if ( hierarchical ) {
+      // The key orders the SNRs as unsigned integers, and equal SNRs by lower DM and sample
+      outputs_s += std::string(fullOutput ? ", " : "") + "volatile __global ulong * const restrict bestSubbandDM, volatile __global ulong * const restrict bestBeam";
+      store_s += "float snr = (max0 - mean0) / " + stdDev_s + ";\n"
+        "unsigned int key = as_uint(snr);\n"
+        "key = (key & 0x80000000) ? ~key : (key | 0x80000000);\n"
+        "ulong best = (((ulong)(key)) << 32) | (0xFFFFFFFF - ((dm * " + std::to_string(nrSamples) + ") + maxSample0));\n"
+        "atom_max(&bestSubbandDM[(beam * " + std::to_string(isa::utils::pad(nrDMs / observation.getNrDMs(), padding / sizeof(uint64_t))) + ") + (dm / " + std::to_string(observation.getNrDMs()) + ")], best);\n"
+        "atom_max(&bestBeam[beam], best);\n";
+    }
+    signature_s = "__kernel void snrDMsSamples<%STREAMING%>" + std::to_string(nrSamples) + "(__global const " + dataName + " * const restrict input, " + state_s + outputs_s + scale_s + ") {\n";
+  }
+  // The statistics of the other DMs of the work-item are moved in the variables of the first one before their store
+  std::string storeNext_sTemplate = "dm += " + std::to_string(conf.getNrThreadsD1()) + ";\n"
+    "counter0 = counter<%NUM%>;\n"
+    "mean0 = mean<%NUM%>;\n"
+    "variance0 = variance<%NUM%>;\n"
+    "max0 = max<%NUM%>;\n"
+    "maxSample0 = maxSample<%NUM%>;\n";
+  if ( conf.getNrItemsD1() > 1 ) {
+    store_s = "{\n" + store_s + "}\n";
+  }
+  // With vector loads, every vector of vectorWidth samples is loaded before the items it contains, and the loop bound is checked once per vector
+  std::string defVector_sTemplate;
+  std::string def_sTemplate = "float counter<%NUM%> = 1.0f;\n"
+    "unsigned int maxSample<%NUM%> = " + first_s + " + <%OFFSET%>;\n";
+  std::string computeVector_sTemplate;
+  std::string computeEnd_sTemplate;
+  std::string compute_sTemplate;
+  if ( (nrSamples % (conf.getNrThreadsD0() * conf.getNrItemsD0())) != 0 ) {
+    computeVector_sTemplate = "if ( (sample + <%OFFSET%>) < " + std::to_string(nrSamples) + " ) {\n";
+    computeEnd_sTemplate = "}\n";
+  }
+  if ( conf.getVectorWidth() > 1 ) {
+    defVector_sTemplate = "float" + std::to_string(conf.getVectorWidth()) + " vector<%VECTOR%> = " + getSNRInputLoad(dataName, "input", "(beam * " + std::to_string(nrDMs * isa::utils::pad(nrSamples, padding / sizeof(T))) + ") + (<%DM%> * " + std::to_string(isa::utils::pad(nrSamples, padding / sizeof(T))) + ") + (" + first_s + " + <%OFFSET%>)", conf.getVectorWidth()) + ";\n";
+    def_sTemplate += "float max<%NUM%> = vector<%VECTOR%>.s<%COMPONENT%>;\n";
+    computeVector_sTemplate += "vector<%VECTOR%> = " + getSNRInputLoad(dataName, "input", "(beam * " + std::to_string(nrDMs * isa::utils::pad(nrSamples, padding / sizeof(T))) + ") + (<%DM%> * " + std::to_string(isa::utils::pad(nrSamples, padding / sizeof(T))) + ") + (sample + <%OFFSET%>)", conf.getVectorWidth()) + ";\n";
+    compute_sTemplate = "item = vector<%VECTOR%>.s<%COMPONENT%>;\n";
+  } else {
+    def_sTemplate += "float max<%NUM%> = " + getSNRInputLoad(dataName, "input", "(beam * " + std::to_string(nrDMs * isa::utils::pad(nrSamples, padding / sizeof(T))) + ") + (<%DM%> * " + std::to_string(isa::utils::pad(nrSamples, padding / sizeof(T))) + ") + (get_local_id(0) + <%OFFSET%>)") + ";\n";
+    compute_sTemplate = "item = " + getSNRInputLoad(dataName, "input", "(beam * " + std::to_string(nrDMs * isa::utils::pad(nrSamples, padding / sizeof(T))) + ") + (<%DM%> * " + std::to_string(isa::utils::pad(nrSamples, padding / sizeof(T))) + ") + (sample + <%OFFSET%>)") + ";\n";
+  }
+  def_sTemplate += "float variance<%NUM%> = 0.0f;\n"
+    "float mean<%NUM%> = max<%NUM%>;\n";
+  compute_sTemplate += "counter<%NUM%> += 1.0f;\n"
+    "delta = item - mean<%NUM%>;\n"
+    "mean<%NUM%> += delta / counter<%NUM%>;\n"
+    "variance<%NUM%> += delta * (item - mean<%NUM%>);\n"
+    "if ( item - max<%NUM%> > 0.0f ) {\n"
+    "max<%NUM%> = item;\n"
+    "maxSample<%NUM%> = sample + <%OFFSET%>;\n"
+    "}\n";
+  std::string reduce_sTemplate = "delta = mean<%NUM%> - mean<%FIRST%>;\n"
+    "counter<%FIRST%> += counter<%NUM%>;\n"
+    "mean<%FIRST%> = (((counter<%FIRST%> - counter<%NUM%>) * mean<%FIRST%>) + (counter<%NUM%> * mean<%NUM%>)) / counter<%FIRST%>;\n"
+    "variance<%FIRST%> += variance<%NUM%> + ((delta * delta) * (((counter<%FIRST%> - counter<%NUM%>) * counter<%NUM%>) / counter<%FIRST%>));\n"
+    "if ( max<%NUM%> - max<%FIRST%> > 0.0f ) {\n"
+    "max<%FIRST%> = max<%NUM%>;\n"
+    "maxSample<%FIRST%> = maxSample<%NUM%>;\n"
+    "}\n";
+  // End kernel's template
+
+  std::string * def_s = new std::string();
+  std::string * compute_s = new std::string();
+  std::string * reduce_s = new std::string();
+  std::string * store = new std::string();
+
+  for ( unsigned int dm = 0; dm < conf.getNrItemsD1(); dm++ ) {
+    std::string base_s = std::to_string(dm * conf.getNrItemsD0());
+    std::string row_s;
+    std::string * defVector_dm = 0;
+    std::string * def_dm = 0;
+    std::string * computeVector_dm = 0;
+    std::string * compute_dm = 0;
+    std::string * temp = 0;
+
+    if ( dm == 0 ) {
+      temp = new std::string("dm");
+    } else {
+      temp = new std::string("(dm + " + std::to_string(dm * conf.getNrThreadsD1()) + ")");
+    }
+    defVector_dm = isa::utils::replace(&defVector_sTemplate, "<%DM%>", *temp);
+    def_dm = isa::utils::replace(&def_sTemplate, "<%DM%>", *temp);
+    computeVector_dm = isa::utils::replace(&computeVector_sTemplate, "<%DM%>", *temp);
+    compute_dm = isa::utils::replace(&compute_sTemplate, "<%DM%>", *temp);
+    delete temp;
+    for ( unsigned int sample = 0; sample < conf.getNrItemsD0(); sample++ ) {
+      std::string sample_s = std::to_string((dm * conf.getNrItemsD0()) + sample);
+      std::string offset_s = std::to_string((conf.getNrThreadsD0() * conf.getVectorWidth() * (sample / conf.getVectorWidth())) + (sample % conf.getVectorWidth()));
+      std::string vector_s = std::to_string(((dm * conf.getNrItemsD0()) + sample) / conf.getVectorWidth());
+      std::string component_s = std::to_string(sample % conf.getVectorWidth());
+
+      if ( (sample % conf.getVectorWidth()) == 0 ) {
+        def_s->append(getSNRItemCode(*defVector_dm, sample_s, offset_s, vector_s, component_s));
+        compute_s->append(getSNRItemCode(*computeVector_dm, sample_s, offset_s, vector_s, component_s));
+      }
+      def_s->append(getSNRItemCode(*def_dm, sample_s, offset_s, vector_s, component_s));
+      compute_s->append(getSNRItemCode(*compute_dm, sample_s, offset_s, vector_s, component_s));
+      if ( (sample % conf.getVectorWidth()) == conf.getVectorWidth() - 1 ) {
+        compute_s->append(computeEnd_sTemplate);
+      }
+      if ( sample == 0 ) {
+        continue;
+      }
+      temp = isa::utils::replace(&reduce_sTemplate, "<%FIRST%>", base_s);
+      temp = isa::utils::replace(temp, "<%NUM%>", sample_s, true);
+      reduce_s->append(*temp);
+      delete temp;
+    }
+    delete defVector_dm;
+    delete def_dm;
+    delete computeVector_dm;
+    delete compute_dm;
+    // Row of this DM in local memory
+    if ( conf.getNrThreadsD1() > 1 ) {
+      row_s = "(get_local_id(1) * " + std::to_string(conf.getNrThreadsD0()) + ") + ";
+    }
+    if ( dm > 0 ) {
+      row_s += std::to_string(dm * conf.getNrThreadsD1() * conf.getNrThreadsD0()) + " + ";
+    }
+    temp = isa::utils::replace(&localStore_sTemplate, "<%NUM%>", base_s);
+    temp = isa::utils::replace(temp, "<%ROW%>", row_s, true);
+    localStore_s.append(*temp);
+    delete temp;
+    temp = isa::utils::replace(&localReduce_sTemplate, "<%NUM%>", base_s);
+    temp = isa::utils::replace(temp, "<%ROW%>", row_s, true);
+    localReduce_s.append(*temp);
+    delete temp;
+    if ( dm > 0 ) {
+      temp = isa::utils::replace(&storeNext_sTemplate, "<%NUM%>", base_s);
+      store->append(*temp);
+      delete temp;
+    }
+    store->append(store_s);
+  }
+  if ( conf.getSubgroupReduction() && conf.getNrThreadsD1() == 1 ) {
+    localReduce_s = localStore_s + "barrier(CLK_LOCAL_MEM_FENCE);\n"
+      "// Reduce phase\n"
+      "if ( get_local_id(0) == 0 ) {\n"
+      "for ( unsigned int subgroup = 1; subgroup < get_num_sub_groups(); subgroup++ ) {\n"
+      + localReduce_s +
+      "}\n"
+      "}\n";
+  } else {
+    localReduce_s = "// Local memory store\n" + localStore_s + "barrier(CLK_LOCAL_MEM_FENCE);\n"
+      "// Reduce phase\n"
+      "unsigned int threshold = " + std::to_string(conf.getNrThreadsD0() / 2) + ";\n"
+      "for ( unsigned int sample = get_local_id(0); threshold > 0; threshold /= 2 ) {\n"
+      "if ( sample < threshold ) {\n"
+      + localReduce_s +
+      "}\n"
+      "barrier(CLK_LOCAL_MEM_FENCE);\n"
+      "}\n";
+  }
+
+  std::string streaming_s;
+  if ( streaming ) {
+    streaming_s = "Streaming";
+  }
+  if ( scaled ) {
+    streaming_s += "Scaled";
+  }
+  if ( hierarchical ) {
+    streaming_s += "Hierarchical";
+  }
+  code = isa::utils::replace(code, "<%EXTENSION%>", extension_s, true);
+  code = isa::utils::replace(code, "<%SIGNATURE%>", signature_s, true);
+  code = isa::utils::replace(code, "<%STREAMING%>", streaming_s, true);
+  code = isa::utils::replace(code, "<%DEF%>", *def_s, true);
+  code = isa::utils::replace(code, "<%COMPUTE%>", *compute_s, true);
+  code = isa::utils::replace(code, "<%REDUCE%>", *reduce_s, true);
+  code = isa::utils::replace(code, "<%LOCAL_REDUCE%>", localReduce_s, true);
+  code = isa::utils::replace(code, "<%STORE%>", *store, true);
+  delete def_s;
+  delete compute_s;
+  delete reduce_s;
+  delete store;
+
+  return code;
+}
+
+template<typename T> std::string * getSNRDMsSamplesRuntimeOpenCL(const snrConf & conf, const std::string & dataName, const unsigned int padding) {
+  std::string * code = new std::string();
+
   // Begin kernel's template
-  *code = "__kernel void snrDMsSamples" + std::to_string(nrSamples) + "(__global const " + dataName + " * const restrict input, __global float * const restrict outputSNR, __global unsigned int * const restrict outputSample) {\n"
+  *code = "__kernel void snrDMsSamplesRuntime(__global const " + dataName + " * const restrict input, __global float * const restrict outputSNR, __global unsigned int * const restrict outputSample, const unsigned int nrSamples, const unsigned int nrDMs) {\n"
     "unsigned int dm = get_group_id(1);\n"
     "unsigned int beam = get_group_id(2);\n"
+    "unsigned int inputStride = ((nrSamples + " + std::to_string((padding / sizeof(T)) - 1) + ") / " + std::to_string(padding / sizeof(T)) + ") * " + std::to_string(padding / sizeof(T)) + ";\n"
+    "unsigned int outputStride = ((nrDMs + " + std::to_string((padding / sizeof(float)) - 1) + ") / " + std::to_string(padding / sizeof(float)) + ") * " + std::to_string(padding / sizeof(float)) + ";\n"
+    "__global const " + dataName + " * const restrict row = input + (((beam * nrDMs) + dm) * inputStride);\n"
     "float delta = 0.0f;\n"
     "__local float reductionCOU[" + std::to_string(isa::utils::pad(conf.getNrThreadsD0(), padding / sizeof(float))) + "];\n"
-    "__local " + dataName + " reductionMAX[" + std::to_string(isa::utils::pad(conf.getNrThreadsD0(), padding / sizeof(T))) + "];\n"
+    "__local float reductionMAX[" + std::to_string(isa::utils::pad(conf.getNrThreadsD0(), padding / sizeof(float))) + "];\n"
     "__local unsigned int reductionSAM[" + std::to_string(isa::utils::pad(conf.getNrThreadsD0(), padding / sizeof(unsigned int))) + "];\n"
     "__local float reductionMEA[" + std::to_string(isa::utils::pad(conf.getNrThreadsD0(), padding / sizeof(float))) + "];\n"
     "__local float reductionVAR[" + std::to_string(isa::utils::pad(conf.getNrThreadsD0(), padding / sizeof(float))) + "];\n"
     "<%DEF%>"
     "\n"
     "// Compute phase\n"
-    "for ( unsigned int sample = get_local_id(0) + " + std::to_string(conf.getNrThreadsD0() * conf.getNrItemsD0()) + "; sample < " + std::to_string(nrSamples) + "; sample += " + std::to_string(conf.getNrThreadsD0() * conf.getNrItemsD0()) + " ) {\n"
-    + dataName + " item = 0;\n"
+    "for ( unsigned int sample = get_local_id(0) + " + std::to_string(conf.getNrThreadsD0() * conf.getNrItemsD0()) + "; sample < nrSamples; sample += " + std::to_string(conf.getNrThreadsD0() * conf.getNrItemsD0()) + " ) {\n"
+    "float item = 0.0f;\n"
     "<%COMPUTE%>"
     "}\n"
     "// In-thread reduce\n"
@@ -118,20 +673,18 @@ template<typename T> std::string * getSNRDMsSamplesOpenCL(const snrConf & conf,
     "}\n"
     "// Store\n"
     "if ( get_local_id(0) == 0 ) {\n"
-    "outputSNR[(beam * " + std::to_string(isa::utils::pad(nrDMs, padding / sizeof(float))) + ") + dm] = (max0 - mean0) / native_sqrt(variance0 * " + std::to_string(1.0f / (nrSamples - 1)) + "f);\n"
-    "outputSample[(beam * " + std::to_string(isa::utils::pad(nrDMs, padding / sizeof(unsigned int))) + ") + dm] = maxSample0;\n"
+    "outputSNR[(beam * outputStride) + dm] = (max0 - mean0) / native_sqrt(variance0 / (nrSamples - 1));\n"
+    "outputSample[(beam * outputStride) + dm] = maxSample0;\n"
     "}\n"
     "}\n";
   std::string def_sTemplate = "float counter<%NUM%> = 1.0f;\n"
     "unsigned int maxSample<%NUM%> = get_local_id(0) + <%OFFSET%>;\n"
-    + dataName + " max<%NUM%> = input[(beam * " + std::to_string(nrDMs * isa::utils::pad(nrSamples, padding / sizeof(T))) + ") + (dm * " + std::to_string(isa::utils::pad(nrSamples, padding / sizeof(T))) + ") + (get_local_id(0) + <%OFFSET%>)];\n"
+    "float max<%NUM%> = " + getSNRInputLoad(dataName, "row", "get_local_id(0) + <%OFFSET%>") + ";\n"
     "float variance<%NUM%> = 0.0f;\n"
     "float mean<%NUM%> = max<%NUM%>;\n";
-  std::string compute_sTemplate;
-  if ( (nrSamples % (conf.getNrThreadsD0() * conf.getNrItemsD0())) != 0 ) {
-    compute_sTemplate += "if ( (sample + <%OFFSET%>) < " + std::to_string(nrSamples) + " ) {\n";
-  }
-  compute_sTemplate += "item = input[(beam * " + std::to_string(nrDMs * isa::utils::pad(nrSamples, padding / sizeof(T))) + ") + (dm * " + std::to_string(isa::utils::pad(nrSamples, padding / sizeof(T))) + ") + (sample + <%OFFSET%>)];\n"
+  // The number of samples is not known at compile time, every item is checked
+  std::string compute_sTemplate = "if ( (sample + <%OFFSET%>) < nrSamples ) {\n"
+    "item = " + getSNRInputLoad(dataName, "row", "sample + <%OFFSET%>") + ";\n"
     "counter<%NUM%> += 1.0f;\n"
     "delta = item - mean<%NUM%>;\n"
     "mean<%NUM%> += delta / counter<%NUM%>;\n"
@@ -139,10 +692,8 @@ template<typename T> std::string * getSNRDMsSamplesOpenCL(const snrConf & conf,
     "if ( item - max<%NUM%> > 0.0f ) {\n"
     "max<%NUM%> = item;\n"
     "maxSample<%NUM%> = sample + <%OFFSET%>;\n"
+    "}\n"
     "}\n";
-  if ( (nrSamples % (conf.getNrThreadsD0() * conf.getNrItemsD0())) != 0 ) {
-    compute_sTemplate += "}\n";
-  }
   std::string reduce_sTemplate = "delta = mean<%NUM%> - mean0;\n"
     "counter0 += counter<%NUM%>;\n"
     "mean0 = (((counter0 - counter<%NUM%>) * mean0) + (counter<%NUM%> * mean<%NUM%>)) / counter0;\n"
@@ -198,92 +749,1121 @@ template<typename T> std::string * getSNRDMsSamplesOpenCL(const snrConf & conf,
   return code;
 }
 
-template<typename T> std::string * getSNRSamplesDMsOpenCL(const snrConf & conf, const std::string & dataName, const AstroData::Observation & observation, const unsigned int nrSamples, const unsigned int padding) {
+template<typename T> std::string * getSNRDMsSamplesBoxcarOpenCL(const snrConf & conf, const std::string & dataName, const AstroData::Observation & observation, const unsigned int nrSamples, const unsigned int padding, const std::vector<unsigned int> & widths, const uint64_t maxLocalMemory) {
   unsigned int nrDMs = 0;
+  unsigned int tileSize = conf.getNrThreadsD0() * conf.getNrItemsD0();
+  std::vector<unsigned int> sortedWidths(widths);
   std::string * code = new std::string();
 
+  if ( sortedWidths.empty() ) {
+    delete code;
+    throw std::invalid_argument("The boxcar kernel requires at least one width.");
+  }
+  for ( auto width = sortedWidths.begin(); width != sortedWidths.end(); ++width ) {
+    if ( *width == 0 || *width > nrSamples ) {
+      delete code;
+      throw std::invalid_argument("Boxcar width " + std::to_string(*width) + " is not between 1 and " + std::to_string(nrSamples) + ".");
+    }
+  }
   if ( conf.getSubbandDedispersion() ) {
     nrDMs = observation.getNrDMs(true) * observation.getNrDMs();
   } else {
     nrDMs = observation.getNrDMs();
   }
+  std::sort(sortedWidths.begin(), sortedWidths.end());
+  sortedWidths.erase(std::unique(sortedWidths.begin(), sortedWidths.end()), sortedWidths.end());
+  // The prefix sums of the tile follow the last maxWidth prefix sums of the previous tiles, so every boxcar ending in the tile is the difference of two local values
+  unsigned int historySize = sortedWidths.back();
+  unsigned int nrHistoryItems = (historySize + conf.getNrThreadsD0() - 1) / conf.getNrThreadsD0();
+  // Prefix sums, partials, the three statistics and the maximum and sample of every width
+  uint64_t localMemory = (isa::utils::pad(historySize + tileSize, padding / sizeof(float)) * sizeof(float)) + (4 * isa::utils::pad(conf.getNrThreadsD0(), padding / sizeof(float)) * sizeof(float)) + (isa::utils::pad(conf.getNrThreadsD0() * sortedWidths.size(), padding / sizeof(float)) * sizeof(float)) + (isa::utils::pad(conf.getNrThreadsD0() * sortedWidths.size(), padding / sizeof(unsigned int)) * sizeof(unsigned int));
+
+  if ( localMemory > maxLocalMemory ) {
+    delete code;
+    throw std::invalid_argument("The boxcar kernel needs " + std::to_string(localMemory) + " bytes of local memory, the device has " + std::to_string(maxLocalMemory) + ".");
+  }
   // Begin kernel's template
-  *code = "__kernel void snrSamplesDMs" + std::to_string(nrDMs) + "(__global const " + dataName + " * const restrict input, __global float * const restrict outputSNR, __global unsigned int * const restrict outputSample) {\n"
-    "unsigned int dm = (get_group_id(0) * " + std::to_string(conf.getNrThreadsD0() * conf.getNrItemsD0()) + ") + get_local_id(0);\n"
-    "unsigned int beam = get_group_id(1);\n"
+  *code = "__kernel void snrDMsSamplesBoxcar" + std::to_string(nrSamples) + "(__global const " + dataName + " * const restrict input, __global float * const restrict outputSNR, __global unsigned int * const restrict outputWidth, __global unsigned int * const restrict outputSample) {\n"
+    "unsigned int dm = get_group_id(1);\n"
+    "unsigned int beam = get_group_id(2);\n"
     "float delta = 0.0f;\n"
+    "float item = 0.0f;\n"
+    "float sum = 0.0f;\n"
+    "float total = 0.0f;\n"
+    "float counter0 = 0.0f;\n"
+    "float mean0 = 0.0f;\n"
+    "float variance0 = 0.0f;\n"
+    "float history[" + std::to_string(nrHistoryItems) + "];\n"
+    "__local float prefix[" + std::to_string(isa::utils::pad(historySize + tileSize, padding / sizeof(float))) + "];\n"
+    "__local float partials[" + std::to_string(isa::utils::pad(conf.getNrThreadsD0(), padding / sizeof(float))) + "];\n"
+    "__local float reductionCOU[" + std::to_string(isa::utils::pad(conf.getNrThreadsD0(), padding / sizeof(float))) + "];\n"
+    "__local float reductionMEA[" + std::to_string(isa::utils::pad(conf.getNrThreadsD0(), padding / sizeof(float))) + "];\n"
+    "__local float reductionVAR[" + std::to_string(isa::utils::pad(conf.getNrThreadsD0(), padding / sizeof(float))) + "];\n"
+    "__local float reductionMAX[" + std::to_string(isa::utils::pad(conf.getNrThreadsD0() * sortedWidths.size(), padding / sizeof(float))) + "];\n"
+    "__local unsigned int reductionSAM[" + std::to_string(isa::utils::pad(conf.getNrThreadsD0() * sortedWidths.size(), padding / sizeof(unsigned int))) + "];\n"
     "<%DEF%>"
     "\n"
-    "for ( unsigned int sample = 1; sample < " + std::to_string(nrSamples) + "; sample++ ) {\n"
-    + dataName + " item = 0;\n"
+    "for ( unsigned int sample = get_local_id(0); sample < " + std::to_string(historySize) + "; sample += " + std::to_string(conf.getNrThreadsD0()) + " ) {\n"
+    "prefix[sample] = 0.0f;\n"
+    "}\n"
+    "for ( unsigned int tileStart = 0; tileStart < " + std::to_string(nrSamples) + "; tileStart += " + std::to_string(tileSize) + " ) {\n"
+    "// Load phase, every sample is read once\n"
+    "for ( unsigned int sample = get_local_id(0); sample < " + std::to_string(tileSize) + "; sample += " + std::to_string(conf.getNrThreadsD0()) + " ) {\n"
+    "item = 0.0f;\n"
+    "if ( (tileStart + sample) < " + std::to_string(nrSamples) + " ) {\n"
+    "item = " + getSNRInputLoad(dataName, "input", "(beam * " + std::to_string(nrDMs * isa::utils::pad(nrSamples, padding / sizeof(T))) + ") + (dm * " + std::to_string(isa::utils::pad(nrSamples, padding / sizeof(T))) + ") + (tileStart + sample)") + ";\n"
+    "counter0 += 1.0f;\n"
+    "delta = item - mean0;\n"
+    "mean0 += delta / counter0;\n"
+    "variance0 += delta * (item - mean0);\n"
+    "}\n"
+    "prefix[" + std::to_string(historySize) + " + sample] = item;\n"
+    "}\n"
+    "barrier(CLK_LOCAL_MEM_FENCE);\n"
+    "// Scan phase: every work-item scans " + std::to_string(conf.getNrItemsD0()) + " contiguous samples, then the totals of the work-items are scanned\n"
+    "sum = 0.0f;\n"
+    "for ( unsigned int sample = get_local_id(0) * " + std::to_string(conf.getNrItemsD0()) + "; sample < (get_local_id(0) + 1) * " + std::to_string(conf.getNrItemsD0()) + "; sample++ ) {\n"
+    "sum += prefix[" + std::to_string(historySize) + " + sample];\n"
+    "prefix[" + std::to_string(historySize) + " + sample] = sum;\n"
+    "}\n"
+    "total = sum;\n"
+    "partials[get_local_id(0)] = sum;\n"
+    "barrier(CLK_LOCAL_MEM_FENCE);\n"
+    "for ( unsigned int stride = 1; stride < " + std::to_string(conf.getNrThreadsD0()) + "; stride *= 2 ) {\n"
+    "item = (get_local_id(0) >= stride) ? partials[get_local_id(0) - stride] : 0.0f;\n"
+    "barrier(CLK_LOCAL_MEM_FENCE);\n"
+    "partials[get_local_id(0)] += item;\n"
+    "barrier(CLK_LOCAL_MEM_FENCE);\n"
+    "}\n"
+    "sum = prefix[" + std::to_string(historySize - 1) + "] + (partials[get_local_id(0)] - total);\n"
+    "for ( unsigned int sample = get_local_id(0) * " + std::to_string(conf.getNrItemsD0()) + "; sample < (get_local_id(0) + 1) * " + std::to_string(conf.getNrItemsD0()) + "; sample++ ) {\n"
+    "prefix[" + std::to_string(historySize) + " + sample] += sum;\n"
+    "}\n"
+    "barrier(CLK_LOCAL_MEM_FENCE);\n"
+    "// Compute phase, boxcars ending in the tile\n"
     "<%COMPUTE%>"
+    "// The last prefix sums are kept for the next tile, relative to the first of them to bound the rounding error\n"
+    "total = prefix[" + std::to_string(tileSize) + "];\n"
+    "for ( unsigned int sample = get_local_id(0), entry = 0; sample < " + std::to_string(historySize) + "; sample += " + std::to_string(conf.getNrThreadsD0()) + ", entry++ ) {\n"
+    "history[entry] = prefix[" + std::to_string(tileSize) + " + sample] - total;\n"
+    "}\n"
+    "barrier(CLK_LOCAL_MEM_FENCE);\n"
+    "for ( unsigned int sample = get_local_id(0), entry = 0; sample < " + std::to_string(historySize) + "; sample += " + std::to_string(conf.getNrThreadsD0()) + ", entry++ ) {\n"
+    "prefix[sample] = history[entry];\n"
+    "}\n"
+    "}\n"
+    "// Local memory store\n"
+    "reductionCOU[get_local_id(0)] = counter0;\n"
+    "reductionMEA[get_local_id(0)] = mean0;\n"
+    "reductionVAR[get_local_id(0)] = variance0;\n"
+    "<%LOCAL_STORE%>"
+    "barrier(CLK_LOCAL_MEM_FENCE);\n"
+    "// Reduce phase\n"
+    "unsigned int threshold = " + std::to_string(conf.getNrThreadsD0() / 2) + ";\n"
+    "for ( unsigned int sample = get_local_id(0); threshold > 0; threshold /= 2 ) {\n"
+    "if ( (sample < threshold) && (reductionCOU[sample + threshold] > 0.0f) ) {\n"
+    "delta = reductionMEA[sample + threshold] - mean0;\n"
+    "counter0 += reductionCOU[sample + threshold];\n"
+    "mean0 = ((reductionCOU[sample] * mean0) + (reductionCOU[sample + threshold] * reductionMEA[sample + threshold])) / counter0;\n"
+    "variance0 += reductionVAR[sample + threshold] + ((delta * delta) * ((reductionCOU[sample] * reductionCOU[sample + threshold]) / counter0));\n"
+    "<%REDUCE%>"
+    "reductionCOU[sample] = counter0;\n"
+    "reductionMEA[sample] = mean0;\n"
+    "reductionVAR[sample] = variance0;\n"
+    "}\n"
+    "barrier(CLK_LOCAL_MEM_FENCE);\n"
     "}\n"
+    "// Store\n"
+    "if ( get_local_id(0) == 0 ) {\n"
+    "float snr = 0.0f;\n"
+    "float maxSNR = -INFINITY;\n"
+    "unsigned int maxWidth = 0;\n"
+    "unsigned int maxSample = 0;\n"
+    "float stdDev = native_sqrt(variance0 * " + std::to_string(1.0f / (nrSamples - 1)) + "f);\n"
     "<%STORE%>"
+    "outputSNR[(beam * " + std::to_string(isa::utils::pad(nrDMs, padding / sizeof(float))) + ") + dm] = maxSNR;\n"
+    "outputWidth[(beam * " + std::to_string(isa::utils::pad(nrDMs, padding / sizeof(unsigned int))) + ") + dm] = maxWidth;\n"
+    "outputSample[(beam * " + std::to_string(isa::utils::pad(nrDMs, padding / sizeof(unsigned int))) + ") + dm] = maxSample;\n"
+    "}\n"
     "}\n";
-  std::string def_sTemplate = "float counter<%NUM%> = 1.0f;\n"
-    + dataName + " max<%NUM%> = input[dm + <%OFFSET%>];\n"
-    "unsigned int maxSample<%NUM%> = 0;\n"
-    "float variance<%NUM%> = 0.0f;\n"
-    "float mean<%NUM%> = max<%NUM%>;\n";
-  std::string compute_sTemplate = "item = input[(beam * " + std::to_string(nrSamples * isa::utils::pad(nrDMs, padding / sizeof(T))) + ") + (sample * " + std::to_string(isa::utils::pad(nrDMs, padding / sizeof(T))) + ")  + (dm + <%OFFSET%>)];\n"
-    "counter<%NUM%> += 1.0f;\n"
-    "delta = item - mean<%NUM%>;\n"
-    "mean<%NUM%> += delta / counter<%NUM%>;\n"
-    "variance<%NUM%> += delta * (item - mean<%NUM%>);\n"
-    "if ( item > max<%NUM%> ) {\n"
-    "max<%NUM%> = item;\n"
-    "maxSample<%NUM%> = sample;\n"
+  std::string def_sTemplate = "float max<%WIDTH%> = -INFINITY;\n"
+    "unsigned int maxSample<%WIDTH%> = 0;\n";
+  std::string compute_sTemplate;
+  if ( (nrSamples % tileSize) != 0 ) {
+    compute_sTemplate += "if ( (tileStart + get_local_id(0) + <%OFFSET%>) < " + std::to_string(nrSamples) + " ) {\n";
+  }
+  compute_sTemplate += "<%BOXCAR%>";
+  if ( (nrSamples % tileSize) != 0 ) {
+    compute_sTemplate += "}\n";
+  }
+  // The boxcar of width w ending in the sample is the difference of the prefix sums w samples apart; boxcars starting before the batch are discarded
+  std::string boxcar_sTemplate = "if ( (tileStart + get_local_id(0) + <%OFFSET%> + 1) >= <%WIDTH%> ) {\n"
+    "sum = prefix[" + std::to_string(historySize) + " + get_local_id(0) + <%OFFSET%>] - prefix[" + std::to_string(historySize) + " + get_local_id(0) + <%OFFSET%> - <%WIDTH%>];\n"
+    "if ( sum > max<%WIDTH%> ) {\n"
+    "max<%WIDTH%> = sum;\n"
+    "maxSample<%WIDTH%> = tileStart + get_local_id(0) + <%OFFSET%> + 1 - <%WIDTH%>;\n"
+    "}\n"
+    "}\n";
+  std::string localStore_sTemplate = "reductionMAX[(<%NUM%> * " + std::to_string(conf.getNrThreadsD0()) + ") + get_local_id(0)] = max<%WIDTH%>;\n"
+    "reductionSAM[(<%NUM%> * " + std::to_string(conf.getNrThreadsD0()) + ") + get_local_id(0)] = maxSample<%WIDTH%>;\n";
+  std::string reduce_sTemplate = "if ( (reductionMAX[(<%NUM%> * " + std::to_string(conf.getNrThreadsD0()) + ") + sample + threshold] > max<%WIDTH%>) || ((reductionMAX[(<%NUM%> * " + std::to_string(conf.getNrThreadsD0()) + ") + sample + threshold] == max<%WIDTH%>) && (reductionSAM[(<%NUM%> * " + std::to_string(conf.getNrThreadsD0()) + ") + sample + threshold] < maxSample<%WIDTH%>)) ) {\n"
+    "max<%WIDTH%> = reductionMAX[(<%NUM%> * " + std::to_string(conf.getNrThreadsD0()) + ") + sample + threshold];\n"
+    "maxSample<%WIDTH%> = reductionSAM[(<%NUM%> * " + std::to_string(conf.getNrThreadsD0()) + ") + sample + threshold];\n"
+    "reductionMAX[(<%NUM%> * " + std::to_string(conf.getNrThreadsD0()) + ") + sample] = max<%WIDTH%>;\n"
+    "reductionSAM[(<%NUM%> * " + std::to_string(conf.getNrThreadsD0()) + ") + sample] = maxSample<%WIDTH%>;\n"
+    "}\n";
+  // The noise of a boxcar of width w has mean (w * mean) and standard deviation (sqrt(w) * stdDev)
+  std::string store_sTemplate = "snr = (max<%WIDTH%> - (<%WIDTH%>.0f * mean0)) / (<%SQRT%>f * stdDev);\n"
+    "if ( snr > maxSNR ) {\n"
+    "maxSNR = snr;\n"
+    "maxWidth = <%WIDTH%>;\n"
+    "maxSample = maxSample<%WIDTH%>;\n"
     "}\n";
-  std::string store_sTemplate = "outputSNR[(beam * " + std::to_string(isa::utils::pad(nrDMs, padding / sizeof(float))) + ") + dm + <%OFFSET%>] = (max<%NUM%> - mean<%NUM%>) / native_sqrt(variance<%NUM%> * " + std::to_string(1.0f / (observation.getNrSamplesPerBatch() - 1)) + "f);\n";
   // End kernel's template
 
   std::string * def_s = new std::string();
   std::string * compute_s = new std::string();
+  std::string * boxcar_s = new std::string();
+  std::string * localStore_s = new std::string();
+  std::string * reduce_s = new std::string();
   std::string * store_s = new std::string();
 
-  for ( unsigned int dm = 0; dm < conf.getNrItemsD0(); dm++ ) {
-    std::string dm_s = std::to_string(dm);
-    std::string offset_s = std::to_string(conf.getNrThreadsD0() * dm);
+  for ( unsigned int width = 0; width < sortedWidths.size(); width++ ) {
+    std::string width_s = std::to_string(sortedWidths.at(width));
+    std::string num_s = std::to_string(width);
+    std::string sqrt_s = std::to_string(std::sqrt(static_cast<float>(sortedWidths.at(width))));
     std::string * temp = 0;
 
-    temp = isa::utils::replace(&def_sTemplate, "<%NUM%>", dm_s);
-    if ( dm == 0 ) {
-      std::string empty_s("");
-      temp = isa::utils::replace(temp, " + <%OFFSET%>", empty_s, true);
-    } else {
-      temp = isa::utils::replace(temp, "<%OFFSET%>", offset_s, true);
-    }
+    temp = isa::utils::replace(&def_sTemplate, "<%WIDTH%>", width_s);
     def_s->append(*temp);
     delete temp;
-    temp = isa::utils::replace(&compute_sTemplate, "<%NUM%>", dm_s);
-    if ( dm == 0 ) {
-      std::string empty_s("");
-      temp = isa::utils::replace(temp, " + <%OFFSET%>", empty_s, true);
-    } else {
-      temp = isa::utils::replace(temp, "<%OFFSET%>", offset_s, true);
-    }
-    compute_s->append(*temp);
+    temp = isa::utils::replace(&boxcar_sTemplate, "<%WIDTH%>", width_s);
+    boxcar_s->append(*temp);
     delete temp;
-    temp = isa::utils::replace(&store_sTemplate, "<%NUM%>", dm_s);
-    if ( dm == 0 ) {
+    temp = isa::utils::replace(&localStore_sTemplate, "<%WIDTH%>", width_s);
+    temp = isa::utils::replace(temp, "<%NUM%>", num_s, true);
+    localStore_s->append(*temp);
+    delete temp;
+    temp = isa::utils::replace(&reduce_sTemplate, "<%WIDTH%>", width_s);
+    temp = isa::utils::replace(temp, "<%NUM%>", num_s, true);
+    reduce_s->append(*temp);
+    delete temp;
+    temp = isa::utils::replace(&store_sTemplate, "<%WIDTH%>", width_s);
+    temp = isa::utils::replace(temp, "<%SQRT%>", sqrt_s, true);
+    store_s->append(*temp);
+    delete temp;
+  }
+  std::string * computeBoxcar_s = isa::utils::replace(&compute_sTemplate, "<%BOXCAR%>", *boxcar_s);
+  for ( unsigned int sample = 0; sample < conf.getNrItemsD0(); sample++ ) {
+    std::string offset_s = std::to_string(conf.getNrThreadsD0() * sample);
+    std::string * temp = 0;
+
+    if ( sample == 0 ) {
       std::string empty_s("");
-      temp = isa::utils::replace(temp, " + <%OFFSET%>", empty_s, true);
+      temp = isa::utils::replace(computeBoxcar_s, " + <%OFFSET%>", empty_s);
     } else {
-      temp = isa::utils::replace(temp, "<%OFFSET%>", offset_s, true);
+      temp = isa::utils::replace(computeBoxcar_s, "<%OFFSET%>", offset_s);
     }
-    store_s->append(*temp);
+    compute_s->append(*temp);
     delete temp;
   }
 
   code = isa::utils::replace(code, "<%DEF%>", *def_s, true);
   code = isa::utils::replace(code, "<%COMPUTE%>", *compute_s, true);
+  code = isa::utils::replace(code, "<%LOCAL_STORE%>", *localStore_s, true);
+  code = isa::utils::replace(code, "<%REDUCE%>", *reduce_s, true);
   code = isa::utils::replace(code, "<%STORE%>", *store_s, true);
   delete def_s;
   delete compute_s;
+  delete boxcar_s;
+  delete computeBoxcar_s;
+  delete localStore_s;
+  delete reduce_s;
   delete store_s;
 
   return code;
 }
 
+template<typename T> std::string * getSNRDMsSamplesSigmaClipOpenCL(const snrConf & conf, const std::string & dataName, const AstroData::Observation & observation, const unsigned int nrSamples, const unsigned int padding, const unsigned int nrIterations, const float sigma) {
+  unsigned int nrDMs = 0;
+  std::string * code = new std::string();
+
+  if ( conf.getSubbandDedispersion() ) {
+    nrDMs = observation.getNrDMs(true) * observation.getNrDMs();
+  } else {
+    nrDMs = observation.getNrDMs();
+  }
+  // Begin kernel's template
+  *code = "__kernel void snrDMsSamplesSigmaClip" + std::to_string(nrSamples) + "(__global const " + dataName + " * const restrict input, __global float * const restrict outputSNR, __global unsigned int * const restrict outputSample) {\n"
+    "unsigned int dm = get_group_id(1);\n"
+    "unsigned int beam = get_group_id(2);\n"
+    "float delta = 0.0f;\n"
+    "float clipMean = 0.0f;\n"
+    "float clipLimit = INFINITY;\n"
+    "__local float reductionCOU[" + std::to_string(isa::utils::pad(conf.getNrThreadsD0(), padding / sizeof(float))) + "];\n"
+    "__local float reductionMAX[" + std::to_string(isa::utils::pad(conf.getNrThreadsD0(), padding / sizeof(float))) + "];\n"
+    "__local unsigned int reductionSAM[" + std::to_string(isa::utils::pad(conf.getNrThreadsD0(), padding / sizeof(unsigned int))) + "];\n"
+    "__local float reductionMEA[" + std::to_string(isa::utils::pad(conf.getNrThreadsD0(), padding / sizeof(float))) + "];\n"
+    "__local float reductionVAR[" + std::to_string(isa::utils::pad(conf.getNrThreadsD0(), padding / sizeof(float))) + "];\n"
+    "<%DEF%>"
+    "\n"
+    "for ( unsigned int iteration = 0; iteration <= " + std::to_string(nrIterations) + "; iteration++ ) {\n"
+    "<%RESET%>"
+    "// Compute phase\n"
+    "for ( unsigned int sample = get_local_id(0); sample < " + std::to_string(nrSamples) + "; sample += " + std::to_string(conf.getNrThreadsD0() * conf.getNrItemsD0()) + " ) {\n"
+    "float item = 0.0f;\n"
+    "<%COMPUTE%>"
+    "}\n"
+    "// In-thread reduce\n"
+    "<%REDUCE%>"
+    "// Local memory store\n"
+    "reductionCOU[get_local_id(0)] = counter0;\n"
+    "reductionMAX[get_local_id(0)] = max0;\n"
+    "reductionSAM[get_local_id(0)] = maxSample0;\n"
+    "reductionMEA[get_local_id(0)] = mean0;\n"
+    "reductionVAR[get_local_id(0)] = variance0;\n"
+    "barrier(CLK_LOCAL_MEM_FENCE);\n"
+    "// Reduce phase\n"
+    "unsigned int threshold = " + std::to_string(conf.getNrThreadsD0() / 2) + ";\n"
+    "for ( unsigned int sample = get_local_id(0); threshold > 0; threshold /= 2 ) {\n"
+    "if ( sample < threshold ) {\n"
+    "if ( reductionCOU[sample + threshold] > 0.0f ) {\n"
+    "delta = reductionMEA[sample + threshold] - mean0;\n"
+    "counter0 += reductionCOU[sample + threshold];\n"
+    "mean0 = ((reductionCOU[sample] * mean0) + (reductionCOU[sample + threshold] * reductionMEA[sample + threshold])) / counter0;\n"
+    "variance0 += reductionVAR[sample + threshold] + ((delta * delta) * ((reductionCOU[sample] * reductionCOU[sample + threshold]) / counter0));\n"
+    "}\n"
+    "if ( reductionMAX[sample + threshold] - max0 > 0.0f ) {\n"
+    "max0 = reductionMAX[sample + threshold];\n"
+    "maxSample0 = reductionSAM[sample + threshold];\n"
+    "}\n"
+    "reductionCOU[sample] = counter0;\n"
+    "reductionMAX[sample] = max0;\n"
+    "reductionSAM[sample] = maxSample0;\n"
+    "reductionMEA[sample] = mean0;\n"
+    "reductionVAR[sample] = variance0;\n"
+    "}\n"
+    "barrier(CLK_LOCAL_MEM_FENCE);\n"
+    "}\n"
+    "// Statistics of the next iteration only include the samples within sigma standard deviations\n"
+    "clipMean = reductionMEA[0];\n"
+    "clipLimit = " + std::to_string(sigma) + "f * native_sqrt(reductionVAR[0] / (reductionCOU[0] - 1.0f));\n"
+    "counter0 = reductionCOU[0];\n"
+    "mean0 = reductionMEA[0];\n"
+    "variance0 = reductionVAR[0];\n"
+    "max0 = reductionMAX[0];\n"
+    "maxSample0 = reductionSAM[0];\n"
+    "barrier(CLK_LOCAL_MEM_FENCE);\n"
+    "}\n"
+    "// Store\n"
+    "if ( get_local_id(0) == 0 ) {\n"
+    "outputSNR[(beam * " + std::to_string(isa::utils::pad(nrDMs, padding / sizeof(float))) + ") + dm] = (max0 - mean0) / native_sqrt(variance0 / (counter0 - 1.0f));\n"
+    "outputSample[(beam * " + std::to_string(isa::utils::pad(nrDMs, padding / sizeof(unsigned int))) + ") + dm] = maxSample0;\n"
+    "}\n"
+    "}\n";
+  std::string def_sTemplate = "float counter<%NUM%> = 0.0f;\n"
+    "unsigned int maxSample<%NUM%> = get_local_id(0) + <%OFFSET%>;\n"
+    "float max<%NUM%> = " + getSNRInputLoad(dataName, "input", "(beam * " + std::to_string(nrDMs * isa::utils::pad(nrSamples, padding / sizeof(T))) + ") + (dm * " + std::to_string(isa::utils::pad(nrSamples, padding / sizeof(T))) + ") + (get_local_id(0) + <%OFFSET%>)") + ";\n"
+    "float variance<%NUM%> = 0.0f;\n"
+    "float mean<%NUM%> = 0.0f;\n";
+  std::string reset_sTemplate = "counter<%NUM%> = 0.0f;\n"
+    "variance<%NUM%> = 0.0f;\n"
+    "mean<%NUM%> = 0.0f;\n";
+  std::string compute_sTemplate;
+  if ( (nrSamples % (conf.getNrThreadsD0() * conf.getNrItemsD0())) != 0 ) {
+    compute_sTemplate += "if ( (sample + <%OFFSET%>) < " + std::to_string(nrSamples) + " ) {\n";
+  }
+  compute_sTemplate += "item = " + getSNRInputLoad(dataName, "input", "(beam * " + std::to_string(nrDMs * isa::utils::pad(nrSamples, padding / sizeof(T))) + ") + (dm * " + std::to_string(isa::utils::pad(nrSamples, padding / sizeof(T))) + ") + (sample + <%OFFSET%>)") + ";\n"
+    "if ( fabs(item - clipMean) <= clipLimit ) {\n"
+    "counter<%NUM%> += 1.0f;\n"
+    "delta = item - mean<%NUM%>;\n"
+    "mean<%NUM%> += delta / counter<%NUM%>;\n"
+    "variance<%NUM%> += delta * (item - mean<%NUM%>);\n"
+    "}\n"
+    "if ( item - max<%NUM%> > 0.0f ) {\n"
+    "max<%NUM%> = item;\n"
+    "maxSample<%NUM%> = sample + <%OFFSET%>;\n"
+    "}\n";
+  if ( (nrSamples % (conf.getNrThreadsD0() * conf.getNrItemsD0())) != 0 ) {
+    compute_sTemplate += "}\n";
+  }
+  std::string reduce_sTemplate = "if ( counter<%NUM%> > 0.0f ) {\n"
+    "delta = mean<%NUM%> - mean0;\n"
+    "counter0 += counter<%NUM%>;\n"
+    "mean0 = (((counter0 - counter<%NUM%>) * mean0) + (counter<%NUM%> * mean<%NUM%>)) / counter0;\n"
+    "variance0 += variance<%NUM%> + ((delta * delta) * (((counter0 - counter<%NUM%>) * counter<%NUM%>) / counter0));\n"
+    "}\n"
+    "if ( max<%NUM%> - max0 > 0.0f ) {\n"
+    "max0 = max<%NUM%>;\n"
+    "maxSample0 = maxSample<%NUM%>;\n"
+    "}\n";
+  // End kernel's template
+
+  std::string * def_s = new std::string();
+  std::string * reset_s = new std::string();
+  std::string * compute_s = new std::string();
+  std::string * reduce_s = new std::string();
+
+  for ( unsigned int sample = 0; sample < conf.getNrItemsD0(); sample++ ) {
+    std::string sample_s = std::to_string(sample);
+    std::string offset_s = std::to_string(conf.getNrThreadsD0() * sample);
+    std::string * temp = 0;
+
+    temp = isa::utils::replace(&def_sTemplate, "<%NUM%>", sample_s);
+    if ( sample == 0 ) {
+      std::string empty_s("");
+      temp = isa::utils::replace(temp, " + <%OFFSET%>", empty_s, true);
+    } else {
+      temp = isa::utils::replace(temp, "<%OFFSET%>", offset_s, true);
+    }
+    def_s->append(*temp);
+    delete temp;
+    temp = isa::utils::replace(&reset_sTemplate, "<%NUM%>", sample_s);
+    reset_s->append(*temp);
+    delete temp;
+    temp = isa::utils::replace(&compute_sTemplate, "<%NUM%>", sample_s);
+    if ( sample == 0 ) {
+      std::string empty_s("");
+      temp = isa::utils::replace(temp, " + <%OFFSET%>", empty_s, true);
+    } else {
+      temp = isa::utils::replace(temp, "<%OFFSET%>", offset_s, true);
+    }
+    compute_s->append(*temp);
+    delete temp;
+    if ( sample == 0 ) {
+      continue;
+    }
+    temp = isa::utils::replace(&reduce_sTemplate, "<%NUM%>", sample_s);
+    reduce_s->append(*temp);
+    delete temp;
+  }
+
+  code = isa::utils::replace(code, "<%DEF%>", *def_s, true);
+  code = isa::utils::replace(code, "<%RESET%>", *reset_s, true);
+  code = isa::utils::replace(code, "<%COMPUTE%>", *compute_s, true);
+  code = isa::utils::replace(code, "<%REDUCE%>", *reduce_s, true);
+  delete def_s;
+  delete reset_s;
+  delete compute_s;
+  delete reduce_s;
+
+  return code;
+}
+
+template<typename T> std::string * getSNRSamplesDMsOpenCL(const snrConf & conf, const std::string & dataName, const AstroData::Observation & observation, const unsigned int nrSamples, const unsigned int padding) {
+  return getSNRSamplesDMsKernelOpenCL<T>(conf, dataName, observation, nrSamples, padding, false, 0, false, 1.0f, false, false, true);
+}
+
+template<typename T> std::string * getSNRSamplesDMsThresholdOpenCL(const snrConf & conf, const std::string & dataName, const AstroData::Observation & observation, const unsigned int nrSamples, const unsigned int padding, const unsigned int maxCandidates) {
+  return getSNRSamplesDMsKernelOpenCL<T>(conf, dataName, observation, nrSamples, padding, true, maxCandidates, false, 1.0f, false, false, true);
+}
+
+template<typename T> std::string * getSNRSamplesDMsStreamingOpenCL(const snrConf & conf, const std::string & dataName, const AstroData::Observation & observation, const unsigned int nrSamples, const unsigned int padding, const float decay) {
+  return getSNRSamplesDMsKernelOpenCL<T>(conf, dataName, observation, nrSamples, padding, false, 0, true, decay, false, false, true);
+}
+
+template<typename T> std::string * getSNRSamplesDMsScaledOpenCL(const snrConf & conf, const std::string & dataName, const AstroData::Observation & observation, const unsigned int nrSamples, const unsigned int padding, const bool streaming, const float decay) {
+  return getSNRSamplesDMsKernelOpenCL<T>(conf, dataName, observation, nrSamples, padding, false, 0, streaming, decay, true, false, true);
+}
+
+template<typename T> std::string * getSNRSamplesDMsHierarchicalOpenCL(const snrConf & conf, const std::string & dataName, const AstroData::Observation & observation, const unsigned int nrSamples, const unsigned int padding, const bool fullOutput) {
+  return getSNRSamplesDMsKernelOpenCL<T>(conf, dataName, observation, nrSamples, padding, false, 0, false, 1.0f, false, true, fullOutput);
+}
+
+template<typename T> std::string * getSNRSamplesDMsKernelOpenCL(const snrConf & conf, const std::string & dataName, const AstroData::Observation & observation, const unsigned int nrSamples, const unsigned int padding, const bool threshold, const unsigned int maxCandidates, const bool streaming, const float decay, const bool scaled, const bool hierarchical, const bool fullOutput) {
+  unsigned int nrDMs = 0;
+  std::string * code = new std::string();
+  // With vector loads every thread starts at vectorWidth contiguous DMs
+  std::string first_s = "get_local_id(0)";
+
+  if ( conf.getSubbandDedispersion() ) {
+    nrDMs = observation.getNrDMs(true) * observation.getNrDMs();
+  } else {
+    nrDMs = observation.getNrDMs();
+  }
+  // The position of the best trial, dm * nrSamples + sample, is stored in the low 32 bits of the hierarchical keys
+  if ( hierarchical && (static_cast<uint64_t>(nrDMs) * nrSamples) > (static_cast<uint64_t>(1) << 32) ) {
+    throw std::invalid_argument("The hierarchical keys require nrDMs * nrSamples <= 2^32, not " + std::to_string(static_cast<uint64_t>(nrDMs) * nrSamples) + ".");
+  }
+  if ( conf.getVectorWidth() > 1 ) {
+    first_s = "(get_local_id(0) * " + std::to_string(conf.getVectorWidth()) + ")";
+  }
+  // Begin kernel's template
+  *code = "<%EXTENSION%>"
+    "<%SIGNATURE%>"
+    "unsigned int dm = (get_group_id(0) * " + std::to_string(conf.getNrThreadsD0() * conf.getNrItemsD0()) + ") + " + first_s + ";\n"
+    "unsigned int beam = get_group_id(1);\n"
+    "float delta = 0.0f;\n"
+    "<%DEF%>"
+    "\n"
+    "for ( unsigned int sample = 1; sample < " + std::to_string(nrSamples) + "; sample++ ) {\n"
+    "float item = 0.0f;\n"
+    "<%COMPUTE%>"
+    "}\n"
+    "<%STORE%>"
+    "}\n";
+  // With vector loads, every vector of vectorWidth DMs is loaded before the items it contains
+  std::string defVector_sTemplate;
+  std::string def_sTemplate = "float counter<%NUM%> = 1.0f;\n";
+  std::string computeVector_sTemplate;
+  std::string compute_sTemplate;
+  if ( conf.getVectorWidth() > 1 ) {
+    defVector_sTemplate = "float" + std::to_string(conf.getVectorWidth()) + " vector<%VECTOR%> = " + getSNRInputLoad(dataName, "input", "(beam * " + std::to_string(nrSamples * isa::utils::pad(nrDMs, padding / sizeof(T))) + ") + dm + <%OFFSET%>", conf.getVectorWidth()) + ";\n";
+    def_sTemplate += "float max<%NUM%> = vector<%VECTOR%>.s<%COMPONENT%>;\n";
+    computeVector_sTemplate = "vector<%VECTOR%> = " + getSNRInputLoad(dataName, "input", "(beam * " + std::to_string(nrSamples * isa::utils::pad(nrDMs, padding / sizeof(T))) + ") + (sample * " + std::to_string(isa::utils::pad(nrDMs, padding / sizeof(T))) + ")  + (dm + <%OFFSET%>)", conf.getVectorWidth()) + ";\n";
+    compute_sTemplate = "item = vector<%VECTOR%>.s<%COMPONENT%>;\n";
+  } else {
+    def_sTemplate += "float max<%NUM%> = " + getSNRInputLoad(dataName, "input", "(beam * " + std::to_string(nrSamples * isa::utils::pad(nrDMs, padding / sizeof(T))) + ") + dm + <%OFFSET%>") + ";\n";
+    compute_sTemplate = "item = " + getSNRInputLoad(dataName, "input", "(beam * " + std::to_string(nrSamples * isa::utils::pad(nrDMs, padding / sizeof(T))) + ") + (sample * " + std::to_string(isa::utils::pad(nrDMs, padding / sizeof(T))) + ")  + (dm + <%OFFSET%>)") + ";\n";
+  }
+  def_sTemplate += "unsigned int maxSample<%NUM%> = 0;\n"
+    "float variance<%NUM%> = 0.0f;\n"
+    "float mean<%NUM%> = max<%NUM%>;\n";
+  compute_sTemplate += "counter<%NUM%> += 1.0f;\n"
+    "delta = item - mean<%NUM%>;\n"
+    "mean<%NUM%> += delta / counter<%NUM%>;\n"
+    "variance<%NUM%> += delta * (item - mean<%NUM%>);\n"
+    "if ( item > max<%NUM%> ) {\n"
+    "max<%NUM%> = item;\n"
+    "maxSample<%NUM%> = sample;\n"
+    "}\n";
+  std::string signature_s;
+  std::string state_s;
+  std::string scale_s;
+  std::string stdDev_s;
+  std::string store_sTemplate;
+  if ( scaled ) {
+    // Statistics of (input * scale) + offset
+    scale_s = ", __global const float * const restrict scale, __global const float * const restrict offset";
+    store_sTemplate = "mean<%NUM%> = mad(mean<%NUM%>, scale[dm + <%OFFSET%>], offset[dm + <%OFFSET%>]);\n"
+      "max<%NUM%> = mad(max<%NUM%>, scale[dm + <%OFFSET%>], offset[dm + <%OFFSET%>]);\n"
+      "variance<%NUM%> *= scale[dm + <%OFFSET%>] * scale[dm + <%OFFSET%>];\n";
+  }
+  if ( streaming ) {
+    // Parallel merge of the batch statistics with the state of the previous batches
+    state_s = "__global float4 * const restrict state, ";
+    stdDev_s = "native_sqrt(variance<%NUM%> / (counter<%NUM%> - 1.0f))";
+    store_sTemplate += "previous = state[(beam * " + std::to_string(nrDMs) + ") + dm + <%OFFSET%>];\n";
+    if ( decay < 1.0f ) {
+      store_sTemplate += "previous.x *= " + std::to_string(decay) + "f;\n"
+        "previous.z *= " + std::to_string(decay) + "f;\n";
+    }
+    store_sTemplate += "if ( previous.x > 0.0f ) {\n"
+      "delta = mean<%NUM%> - previous.y;\n"
+      "counter<%NUM%> += previous.x;\n"
+      "mean<%NUM%> = ((previous.x * previous.y) + ((counter<%NUM%> - previous.x) * mean<%NUM%>)) / counter<%NUM%>;\n"
+      "variance<%NUM%> += previous.z + ((delta * delta) * ((previous.x * (counter<%NUM%> - previous.x)) / counter<%NUM%>));\n"
+      "}\n"
+      "state[(beam * " + std::to_string(nrDMs) + ") + dm + <%OFFSET%>] = (float4)(counter<%NUM%>, mean<%NUM%>, variance<%NUM%>, 0.0f);\n";
+  } else {
+    stdDev_s = "native_sqrt(variance<%NUM%> * " + std::to_string(1.0f / (nrSamples - 1)) + "f)";
+  }
+  if ( threshold ) {
+    signature_s = "__kernel void snrSamplesDMsThreshold<%STREAMING%>" + std::to_string(nrDMs) + "(__global const " + dataName + " * const restrict input, " + state_s + "const float snrThreshold, __global unsigned int * const restrict candidates, volatile __global unsigned int * const restrict nrCandidates" + scale_s + ") {\n"
+      "float snr = 0.0f;\n"
+      "unsigned int candidate = 0;\n";
+    store_sTemplate += "snr = (max<%NUM%> - mean<%NUM%>) / " + stdDev_s + ";\n"
+      "if ( snr >= snrThreshold ) {\n"
+      "candidate = atomic_inc(nrCandidates);\n"
+      "if ( candidate < " + std::to_string(maxCandidates) + " ) {\n"
+      "candidates[(candidate * 4)] = beam;\n"
+      "candidates[(candidate * 4) + 1] = dm + <%OFFSET%>;\n"
+      "candidates[(candidate * 4) + 2] = maxSample<%NUM%>;\n"
+      "candidates[(candidate * 4) + 3] = as_uint(snr);\n"
+      "}\n"
+      "}\n";
+  } else {
+    std::string outputs_s;
+    if ( fullOutput ) {
+      outputs_s = "__global float * const restrict outputSNR, __global unsigned int * const restrict outputSample";
+      store_sTemplate += "outputSNR[(beam * " + std::to_string(isa::utils::pad(nrDMs, padding / sizeof(float))) + ") + dm + <%OFFSET%>] = (max<%NUM%> - mean<%NUM%>) / " + stdDev_s + ";\n"
+        "outputSample[(beam * " + std::to_string(isa::utils::pad(nrDMs, padding / sizeof(unsigned int))) + ") + dm + <%OFFSET%>] = maxSample<%NUM%>;\n";
+    }
+    if ( hierarchical ) {
+      // The key orders the SNRs as unsigned integers, and equal SNRs by lower DM and sample; the beam is reduced in-thread first
+      outputs_s += std::string(fullOutput ? ", " : "") + "volatile __global ulong * const restrict bestSubbandDM, volatile __global ulong * const restrict bestBeam";
+      store_sTemplate += "snr = (max<%NUM%> - mean<%NUM%>) / " + stdDev_s + ";\n"
+        "key = as_uint(snr);\n"
+        "key = (key & 0x80000000) ? ~key : (key | 0x80000000);\n"
+        "best = (((ulong)(key)) << 32) | (0xFFFFFFFF - (((dm + <%OFFSET%>) * " + std::to_string(nrSamples) + ") + maxSample<%NUM%>));\n"
+        "atom_max(&bestSubbandDM[(beam * " + std::to_string(isa::utils::pad(nrDMs / observation.getNrDMs(), padding / sizeof(uint64_t))) + ") + ((dm + <%OFFSET%>) / " + std::to_string(observation.getNrDMs()) + ")], best);\n"
+        "beamBest = max(beamBest, best);\n";
+    }
+    signature_s = "__kernel void snrSamplesDMs<%STREAMING%>" + std::to_string(nrDMs) + "(__global const " + dataName + " * const restrict input, " + state_s + outputs_s + scale_s + ") {\n";
+    if ( hierarchical ) {
+      signature_s += "float snr = 0.0f;\n"
+        "unsigned int key = 0;\n"
+        "ulong best = 0;\n"
+        "ulong beamBest = 0;\n";
+    }
+  }
+  if ( streaming ) {
+    signature_s += "float4 previous = (float4)(0.0f, 0.0f, 0.0f, 0.0f);\n";
+  }
+  // End kernel's template
+
+  std::string * def_s = new std::string();
+  std::string * compute_s = new std::string();
+  std::string * store_s = new std::string();
+
+  for ( unsigned int dm = 0; dm < conf.getNrItemsD0(); dm++ ) {
+    std::string dm_s = std::to_string(dm);
+    std::string offset_s = std::to_string((conf.getNrThreadsD0() * conf.getVectorWidth() * (dm / conf.getVectorWidth())) + (dm % conf.getVectorWidth()));
+    std::string vector_s = std::to_string(dm / conf.getVectorWidth());
+    std::string component_s = std::to_string(dm % conf.getVectorWidth());
+
+    if ( (dm % conf.getVectorWidth()) == 0 ) {
+      def_s->append(getSNRItemCode(defVector_sTemplate, dm_s, offset_s, vector_s, component_s));
+      compute_s->append(getSNRItemCode(computeVector_sTemplate, dm_s, offset_s, vector_s, component_s));
+    }
+    def_s->append(getSNRItemCode(def_sTemplate, dm_s, offset_s, vector_s, component_s));
+    compute_s->append(getSNRItemCode(compute_sTemplate, dm_s, offset_s, vector_s, component_s));
+    store_s->append(getSNRItemCode(store_sTemplate, dm_s, offset_s, vector_s, component_s));
+  }
+
+  std::string streaming_s;
+  if ( streaming ) {
+    streaming_s = "Streaming";
+  }
+  if ( scaled ) {
+    streaming_s += "Scaled";
+  }
+  std::string extension_s;
+  if ( hierarchical ) {
+    streaming_s += "Hierarchical";
+    extension_s = "#pragma OPENCL EXTENSION cl_khr_int64_extended_atomics : enable\n";
+    store_s->append("atom_max(&bestBeam[beam], beamBest);\n");
+  }
+  code = isa::utils::replace(code, "<%EXTENSION%>", extension_s, true);
+  code = isa::utils::replace(code, "<%SIGNATURE%>", signature_s, true);
+  code = isa::utils::replace(code, "<%STREAMING%>", streaming_s, true);
+  code = isa::utils::replace(code, "<%DEF%>", *def_s, true);
+  code = isa::utils::replace(code, "<%COMPUTE%>", *compute_s, true);
+  code = isa::utils::replace(code, "<%STORE%>", *store_s, true);
+  delete def_s;
+  delete compute_s;
+  delete store_s;
+
+  return code;
+}
+
+template<typename T> std::string * getSNRSamplesDMsSlicedOpenCL(const snrConf & conf, const std::string & dataName, const AstroData::Observation & observation, const unsigned int nrSamples, const unsigned int padding) {
+  unsigned int nrDMs = 0;
+  std::string * code = new std::string();
+
+  if ( conf.getSubbandDedispersion() ) {
+    nrDMs = observation.getNrDMs(true) * observation.getNrDMs();
+  } else {
+    nrDMs = observation.getNrDMs();
+  }
+  // Begin kernel's template
+  *code = "__kernel void snrSamplesDMsSliced" + std::to_string(nrDMs) + "(__global const " + dataName + " * const restrict input, __global float4 * const restrict partials, __global unsigned int * const restrict partialSamples) {\n"
+    "unsigned int dm = (get_group_id(0) * " + std::to_string(conf.getNrThreadsD0() * conf.getNrItemsD0()) + ") + get_local_id(0);\n"
+    "unsigned int slice = get_group_id(1);\n"
+    "unsigned int beam = get_group_id(2);\n"
+    "unsigned int firstSample = (slice * " + std::to_string(nrSamples) + ") / " + std::to_string(conf.getNrSlices()) + ";\n"
+    "unsigned int lastSample = ((slice + 1) * " + std::to_string(nrSamples) + ") / " + std::to_string(conf.getNrSlices()) + ";\n"
+    "float delta = 0.0f;\n"
+    "<%DEF%>"
+    "\n"
+    "for ( unsigned int sample = firstSample + 1; sample < lastSample; sample++ ) {\n"
+    "float item = 0.0f;\n"
+    "<%COMPUTE%>"
+    "}\n"
+    "<%STORE%>"
+    "}\n";
+  std::string def_sTemplate = "float counter<%NUM%> = 1.0f;\n"
+    "float max<%NUM%> = " + getSNRInputLoad(dataName, "input", "(beam * " + std::to_string(nrSamples * isa::utils::pad(nrDMs, padding / sizeof(T))) + ") + (firstSample * " + std::to_string(isa::utils::pad(nrDMs, padding / sizeof(T))) + ") + dm + <%OFFSET%>") + ";\n"
+    "unsigned int maxSample<%NUM%> = firstSample;\n"
+    "float variance<%NUM%> = 0.0f;\n"
+    "float mean<%NUM%> = max<%NUM%>;\n";
+  std::string compute_sTemplate = "item = " + getSNRInputLoad(dataName, "input", "(beam * " + std::to_string(nrSamples * isa::utils::pad(nrDMs, padding / sizeof(T))) + ") + (sample * " + std::to_string(isa::utils::pad(nrDMs, padding / sizeof(T))) + ") + dm + <%OFFSET%>") + ";\n"
+    "counter<%NUM%> += 1.0f;\n"
+    "delta = item - mean<%NUM%>;\n"
+    "mean<%NUM%> += delta / counter<%NUM%>;\n"
+    "variance<%NUM%> += delta * (item - mean<%NUM%>);\n"
+    "if ( item > max<%NUM%> ) {\n"
+    "max<%NUM%> = item;\n"
+    "maxSample<%NUM%> = sample;\n"
+    "}\n";
+  std::string store_sTemplate = "partials[(((beam * " + std::to_string(conf.getNrSlices()) + ") + slice) * " + std::to_string(nrDMs) + ") + dm + <%OFFSET%>] = (float4)(counter<%NUM%>, mean<%NUM%>, variance<%NUM%>, max<%NUM%>);\n"
+    "partialSamples[(((beam * " + std::to_string(conf.getNrSlices()) + ") + slice) * " + std::to_string(nrDMs) + ") + dm + <%OFFSET%>] = maxSample<%NUM%>;\n";
+  // End kernel's template
+
+  std::string * def_s = new std::string();
+  std::string * compute_s = new std::string();
+  std::string * store_s = new std::string();
+
+  for ( unsigned int dm = 0; dm < conf.getNrItemsD0(); dm++ ) {
+    std::string dm_s = std::to_string(dm);
+    std::string offset_s = std::to_string(conf.getNrThreadsD0() * dm);
+    std::string * temp = 0;
+
+    temp = isa::utils::replace(&def_sTemplate, "<%NUM%>", dm_s);
+    if ( dm == 0 ) {
+      std::string empty_s("");
+      temp = isa::utils::replace(temp, " + <%OFFSET%>", empty_s, true);
+    } else {
+      temp = isa::utils::replace(temp, "<%OFFSET%>", offset_s, true);
+    }
+    def_s->append(*temp);
+    delete temp;
+    temp = isa::utils::replace(&compute_sTemplate, "<%NUM%>", dm_s);
+    if ( dm == 0 ) {
+      std::string empty_s("");
+      temp = isa::utils::replace(temp, " + <%OFFSET%>", empty_s, true);
+    } else {
+      temp = isa::utils::replace(temp, "<%OFFSET%>", offset_s, true);
+    }
+    compute_s->append(*temp);
+    delete temp;
+    temp = isa::utils::replace(&store_sTemplate, "<%NUM%>", dm_s);
+    if ( dm == 0 ) {
+      std::string empty_s("");
+      temp = isa::utils::replace(temp, " + <%OFFSET%>", empty_s, true);
+    } else {
+      temp = isa::utils::replace(temp, "<%OFFSET%>", offset_s, true);
+    }
+    store_s->append(*temp);
+    delete temp;
+  }
+  code = isa::utils::replace(code, "<%DEF%>", *def_s, true);
+  code = isa::utils::replace(code, "<%COMPUTE%>", *compute_s, true);
+  code = isa::utils::replace(code, "<%STORE%>", *store_s, true);
+  delete def_s;
+  delete compute_s;
+  delete store_s;
+
+  return code;
+}
+
+template<typename T> std::string * getSNRSamplesDMsRuntimeOpenCL(const snrConf & conf, const std::string & dataName, const unsigned int padding) {
+  std::string * code = new std::string();
+
+  // Begin kernel's template
+  *code = "__kernel void snrSamplesDMsRuntime(__global const " + dataName + " * const restrict input, __global float * const restrict outputSNR, __global unsigned int * const restrict outputSample, const unsigned int nrSamples, const unsigned int nrDMs) {\n"
+    "unsigned int dm = (get_group_id(0) * " + std::to_string(conf.getNrThreadsD0() * conf.getNrItemsD0()) + ") + get_local_id(0);\n"
+    "unsigned int beam = get_group_id(1);\n"
+    "unsigned int inputStride = ((nrDMs + " + std::to_string((padding / sizeof(T)) - 1) + ") / " + std::to_string(padding / sizeof(T)) + ") * " + std::to_string(padding / sizeof(T)) + ";\n"
+    "unsigned int outputStride = ((nrDMs + " + std::to_string((padding / sizeof(float)) - 1) + ") / " + std::to_string(padding / sizeof(float)) + ") * " + std::to_string(padding / sizeof(float)) + ";\n"
+    "__global const " + dataName + " * const restrict beamInput = input + (beam * nrSamples * inputStride);\n"
+    "float delta = 0.0f;\n"
+    "<%DEF%>"
+    "\n"
+    "for ( unsigned int sample = 1; sample < nrSamples; sample++ ) {\n"
+    "float item = 0.0f;\n"
+    "<%COMPUTE%>"
+    "}\n"
+    "<%STORE%>"
+    "}\n";
+  std::string def_sTemplate = "float counter<%NUM%> = 1.0f;\n"
+    "float max<%NUM%> = " + getSNRInputLoad(dataName, "beamInput", "dm + <%OFFSET%>") + ";\n"
+    "unsigned int maxSample<%NUM%> = 0;\n"
+    "float variance<%NUM%> = 0.0f;\n"
+    "float mean<%NUM%> = max<%NUM%>;\n";
+  std::string compute_sTemplate = "item = " + getSNRInputLoad(dataName, "beamInput", "(sample * inputStride) + (dm + <%OFFSET%>)") + ";\n"
+    "counter<%NUM%> += 1.0f;\n"
+    "delta = item - mean<%NUM%>;\n"
+    "mean<%NUM%> += delta / counter<%NUM%>;\n"
+    "variance<%NUM%> += delta * (item - mean<%NUM%>);\n"
+    "if ( item > max<%NUM%> ) {\n"
+    "max<%NUM%> = item;\n"
+    "maxSample<%NUM%> = sample;\n"
+    "}\n";
+  std::string store_sTemplate = "outputSNR[(beam * outputStride) + dm + <%OFFSET%>] = (max<%NUM%> - mean<%NUM%>) / native_sqrt(variance<%NUM%> / (nrSamples - 1));\n"
+    "outputSample[(beam * outputStride) + dm + <%OFFSET%>] = maxSample<%NUM%>;\n";
+  // End kernel's template
+
+  std::string * def_s = new std::string();
+  std::string * compute_s = new std::string();
+  std::string * store_s = new std::string();
+
+  for ( unsigned int dm = 0; dm < conf.getNrItemsD0(); dm++ ) {
+    std::string dm_s = std::to_string(dm);
+    std::string offset_s = std::to_string(conf.getNrThreadsD0() * dm);
+    std::string * temp = 0;
+
+    temp = isa::utils::replace(&def_sTemplate, "<%NUM%>", dm_s);
+    if ( dm == 0 ) {
+      std::string empty_s("");
+      temp = isa::utils::replace(temp, " + <%OFFSET%>", empty_s, true);
+    } else {
+      temp = isa::utils::replace(temp, "<%OFFSET%>", offset_s, true);
+    }
+    def_s->append(*temp);
+    delete temp;
+    temp = isa::utils::replace(&compute_sTemplate, "<%NUM%>", dm_s);
+    if ( dm == 0 ) {
+      std::string empty_s("");
+      temp = isa::utils::replace(temp, " + <%OFFSET%>", empty_s, true);
+    } else {
+      temp = isa::utils::replace(temp, "<%OFFSET%>", offset_s, true);
+    }
+    compute_s->append(*temp);
+    delete temp;
+    temp = isa::utils::replace(&store_sTemplate, "<%NUM%>", dm_s);
+    if ( dm == 0 ) {
+      std::string empty_s("");
+      temp = isa::utils::replace(temp, " + <%OFFSET%>", empty_s, true);
+    } else {
+      temp = isa::utils::replace(temp, "<%OFFSET%>", offset_s, true);
+    }
+    store_s->append(*temp);
+    delete temp;
+  }
+
+  code = isa::utils::replace(code, "<%DEF%>", *def_s, true);
+  code = isa::utils::replace(code, "<%COMPUTE%>", *compute_s, true);
+  code = isa::utils::replace(code, "<%STORE%>", *store_s, true);
+  delete def_s;
+  delete compute_s;
+  delete store_s;
+
+  return code;
+}
+
+template<typename T> std::string * getSNRSamplesDMsTimeSeriesOpenCL(const snrConf & conf, const std::string & dataName, const AstroData::Observation & observation, const unsigned int nrSamples, const unsigned int padding, const float decay, const uint64_t maxLocalMemory) {
+  unsigned int nrDMs = 0;
+  unsigned int nrTreeThreads = 1;
+  uint64_t localMemory = isa::utils::pad(conf.getNrThreadsD0(), padding / sizeof(uint64_t)) * sizeof(uint64_t);
+  std::string * code = 0;
+  std::string extension_s;
+  std::string localReduce_s;
+
+  while ( nrTreeThreads < conf.getNrThreadsD0() ) {
+    nrTreeThreads *= 2;
+  }
+  if ( conf.getSubgroupReduction() ) {
+    extension_s = "#pragma OPENCL EXTENSION cl_khr_subgroups : enable\n";
+    localReduce_s = "best = sub_group_reduce_max(best);\n"
+      "if ( get_sub_group_local_id() == 0 ) {\n"
+      "atom_max(&reductionBEST[sample - chunk], best);\n"
+      "}\n";
+  } else {
+    // Works also if nrThreadsD0 is not a power of two
+    localMemory *= 2;
+    localReduce_s = "reductionKEY[get_local_id(0)] = best;\n"
+      "barrier(CLK_LOCAL_MEM_FENCE);\n"
+      "for ( unsigned int threshold = " + std::to_string(nrTreeThreads / 2) + "; threshold > 0; threshold /= 2 ) {\n"
+      "if ( (get_local_id(0) < threshold) && ((get_local_id(0) + threshold) < " + std::to_string(conf.getNrThreadsD0()) + ") ) {\n"
+      "reductionKEY[get_local_id(0)] = max(reductionKEY[get_local_id(0)], reductionKEY[get_local_id(0) + threshold]);\n"
+      "}\n"
+      "barrier(CLK_LOCAL_MEM_FENCE);\n"
+      "}\n"
+      "if ( get_local_id(0) == 0 ) {\n"
+      "reductionBEST[sample - chunk] = reductionKEY[0];\n"
+      "}\n";
+  }
+  if ( localMemory > maxLocalMemory ) {
+    throw std::invalid_argument("The time series kernel needs " + std::to_string(localMemory) + " bytes of local memory, the device has " + std::to_string(maxLocalMemory) + ".");
+  }
+  code = new std::string();
+  if ( conf.getSubbandDedispersion() ) {
+    nrDMs = observation.getNrDMs(true) * observation.getNrDMs();
+  } else {
+    nrDMs = observation.getNrDMs();
+  }
+  // Begin kernel's template
+  *code = "#pragma OPENCL EXTENSION cl_khr_int64_extended_atomics : enable\n"
+    + extension_s +
+    "__kernel void snrSamplesDMsTimeSeries" + std::to_string(nrDMs) + "(__global const " + dataName + " * const restrict input, __global float4 * const restrict state, __global float * const restrict outputSNR, __global unsigned int * const restrict outputSample, volatile __global ulong * const restrict timeSeries) {\n"
+    "unsigned int dm = (get_group_id(0) * " + std::to_string(conf.getNrThreadsD0() * conf.getNrItemsD0()) + ") + get_local_id(0);\n"
+    "unsigned int beam = get_group_id(1);\n"
+    "float delta = 0.0f;\n"
+    "float value = 0.0f;\n"
+    "unsigned int key = 0;\n"
+    "ulong best = 0;\n"
+    "float4 previous = (float4)(0.0f, 0.0f, 0.0f, 0.0f);\n"
+    "volatile __local ulong reductionBEST[" + std::to_string(isa::utils::pad(conf.getNrThreadsD0(), padding / sizeof(uint64_t))) + "];\n"
+    + (conf.getSubgroupReduction() ? "" : "__local ulong reductionKEY[" + std::to_string(isa::utils::pad(conf.getNrThreadsD0(), padding / sizeof(uint64_t))) + "];\n") +
+    "<%DEF%>"
+    "\n"
+    "for ( unsigned int chunk = 0; chunk < " + std::to_string(nrSamples) + "; chunk += " + std::to_string(conf.getNrThreadsD0()) + " ) {\n"
+    "reductionBEST[get_local_id(0)] = 0;\n"
+    "barrier(CLK_LOCAL_MEM_FENCE);\n"
+    "// One entry per sample of the chunk, the best key of the work-group\n"
+    "for ( unsigned int sample = chunk; sample < min(chunk + " + std::to_string(conf.getNrThreadsD0()) + ", " + std::to_string(nrSamples) + "u); sample++ ) {\n"
+    "float item = 0.0f;\n"
+    "best = 0;\n"
+    "<%COMPUTE%>"
+    + localReduce_s +
+    "}\n"
+    "barrier(CLK_LOCAL_MEM_FENCE);\n"
+    "// The work-groups are combined with a global atomic\n"
+    "if ( (chunk + get_local_id(0)) < " + std::to_string(nrSamples) + " ) {\n"
+    "atom_max(&timeSeries[(beam * " + std::to_string(isa::utils::pad(nrSamples, padding / sizeof(uint64_t))) + ") + chunk + get_local_id(0)], reductionBEST[get_local_id(0)]);\n"
+    "}\n"
+    "barrier(CLK_LOCAL_MEM_FENCE);\n"
+    "}\n"
+    "<%STORE%>"
+    "}\n";
+  // The normalization uses the state before this batch is merged
+  std::string def_sTemplate = "float counter<%NUM%> = 0.0f;\n"
+    "float max<%NUM%> = " + getSNRInputLoad(dataName, "input", "(beam * " + std::to_string(nrSamples * isa::utils::pad(nrDMs, padding / sizeof(T))) + ") + dm + <%OFFSET%>") + ";\n"
+    "unsigned int maxSample<%NUM%> = 0;\n"
+    "float variance<%NUM%> = 0.0f;\n"
+    "float mean<%NUM%> = 0.0f;\n"
+    "float4 state<%NUM%> = state[(beam * " + std::to_string(nrDMs) + ") + dm + <%OFFSET%>];\n"
+    "float center<%NUM%> = state<%NUM%>.y;\n"
+    "float normalization<%NUM%> = 0.0f;\n"
+    "if ( state<%NUM%>.x > 1.0f ) {\n"
+    "normalization<%NUM%> = native_rsqrt(state<%NUM%>.z / (state<%NUM%>.x - 1.0f));\n"
+    "}";
+  if ( nrSamples > 1 ) {
+    def_sTemplate += " else {\n"
+      "// First batch, normalized with its own mean and standard deviation\n"
+      "float4 first = (float4)(0.0f, 0.0f, 0.0f, 0.0f);\n"
+      "for ( unsigned int sample = 0; sample < " + std::to_string(nrSamples) + "; sample++ ) {\n"
+      "float item = " + getSNRInputLoad(dataName, "input", "(beam * " + std::to_string(nrSamples * isa::utils::pad(nrDMs, padding / sizeof(T))) + ") + (sample * " + std::to_string(isa::utils::pad(nrDMs, padding / sizeof(T))) + ") + (dm + <%OFFSET%>)") + ";\n"
+      "first.x += 1.0f;\n"
+      "delta = item - first.y;\n"
+      "first.y += delta / first.x;\n"
+      "first.z += delta * (item - first.y);\n"
+      "}\n"
+      "center<%NUM%> = first.y;\n"
+      "normalization<%NUM%> = native_rsqrt(first.z / (first.x - 1.0f));\n"
+      "}";
+  }
+  def_sTemplate += "\n";
+  // The key orders the normalized values as unsigned integers, and equal values by lower DM
+  std::string compute_sTemplate = "item = " + getSNRInputLoad(dataName, "input", "(beam * " + std::to_string(nrSamples * isa::utils::pad(nrDMs, padding / sizeof(T))) + ") + (sample * " + std::to_string(isa::utils::pad(nrDMs, padding / sizeof(T))) + ")  + (dm + <%OFFSET%>)") + ";\n"
+    "counter<%NUM%> += 1.0f;\n"
+    "delta = item - mean<%NUM%>;\n"
+    "mean<%NUM%> += delta / counter<%NUM%>;\n"
+    "variance<%NUM%> += delta * (item - mean<%NUM%>);\n"
+    "if ( item > max<%NUM%> ) {\n"
+    "max<%NUM%> = item;\n"
+    "maxSample<%NUM%> = sample;\n"
+    "}\n"
+    "value = (item - center<%NUM%>) * normalization<%NUM%>;\n"
+    "key = as_uint(value);\n"
+    "key = (key & 0x80000000) ? ~key : (key | 0x80000000);\n"
+    "best = max(best, (((ulong)(key)) << 32) | (0xFFFFFFFF - (dm + <%OFFSET%>)));\n";
+  std::string store_sTemplate = "previous = state<%NUM%>;\n";
+  if ( decay < 1.0f ) {
+    store_sTemplate += "previous.x *= " + std::to_string(decay) + "f;\n"
+      "previous.z *= " + std::to_string(decay) + "f;\n";
+  }
+  store_sTemplate += "if ( previous.x > 0.0f ) {\n"
+    "delta = mean<%NUM%> - previous.y;\n"
+    "counter<%NUM%> += previous.x;\n"
+    "mean<%NUM%> = ((previous.x * previous.y) + ((counter<%NUM%> - previous.x) * mean<%NUM%>)) / counter<%NUM%>;\n"
+    "variance<%NUM%> += previous.z + ((delta * delta) * ((previous.x * (counter<%NUM%> - previous.x)) / counter<%NUM%>));\n"
+    "}\n"
+    "state[(beam * " + std::to_string(nrDMs) + ") + dm + <%OFFSET%>] = (float4)(counter<%NUM%>, mean<%NUM%>, variance<%NUM%>, 0.0f);\n"
+    "outputSNR[(beam * " + std::to_string(isa::utils::pad(nrDMs, padding / sizeof(float))) + ") + dm + <%OFFSET%>] = (max<%NUM%> - mean<%NUM%>) / native_sqrt(variance<%NUM%> / (counter<%NUM%> - 1.0f));\n"
+    "outputSample[(beam * " + std::to_string(isa::utils::pad(nrDMs, padding / sizeof(unsigned int))) + ") + dm + <%OFFSET%>] = maxSample<%NUM%>;\n";
+  // End kernel's template
+
+  std::string * def_s = new std::string();
+  std::string * compute_s = new std::string();
+  std::string * store_s = new std::string();
+
+  for ( unsigned int dm = 0; dm < conf.getNrItemsD0(); dm++ ) {
+    std::string dm_s = std::to_string(dm);
+    std::string offset_s = std::to_string(conf.getNrThreadsD0() * dm);
+    std::string * temp = 0;
+
+    temp = isa::utils::replace(&def_sTemplate, "<%NUM%>", dm_s);
+    if ( dm == 0 ) {
+      std::string empty_s("");
+      temp = isa::utils::replace(temp, " + <%OFFSET%>", empty_s, true);
+    } else {
+      temp = isa::utils::replace(temp, "<%OFFSET%>", offset_s, true);
+    }
+    def_s->append(*temp);
+    delete temp;
+    temp = isa::utils::replace(&compute_sTemplate, "<%NUM%>", dm_s);
+    if ( dm == 0 ) {
+      std::string empty_s("");
+      temp = isa::utils::replace(temp, " + <%OFFSET%>", empty_s, true);
+    } else {
+      temp = isa::utils::replace(temp, "<%OFFSET%>", offset_s, true);
+    }
+    compute_s->append(*temp);
+    delete temp;
+    temp = isa::utils::replace(&store_sTemplate, "<%NUM%>", dm_s);
+    if ( dm == 0 ) {
+      std::string empty_s("");
+      temp = isa::utils::replace(temp, " + <%OFFSET%>", empty_s, true);
+    } else {
+      temp = isa::utils::replace(temp, "<%OFFSET%>", offset_s, true);
+    }
+    store_s->append(*temp);
+    delete temp;
+  }
+
+  code = isa::utils::replace(code, "<%DEF%>", *def_s, true);
+  code = isa::utils::replace(code, "<%COMPUTE%>", *compute_s, true);
+  code = isa::utils::replace(code, "<%STORE%>", *store_s, true);
+  delete def_s;
+  delete compute_s;
+  delete store_s;
+
+  return code;
+}
+
+template<typename T> std::string * getSNRSamplesDMsSigmaClipOpenCL(const snrConf & conf, const std::string & dataName, const AstroData::Observation & observation, const unsigned int nrSamples, const unsigned int padding, const unsigned int nrIterations, const float sigma) {
+  unsigned int nrDMs = 0;
+  std::string * code = new std::string();
+
+  if ( conf.getSubbandDedispersion() ) {
+    nrDMs = observation.getNrDMs(true) * observation.getNrDMs();
+  } else {
+    nrDMs = observation.getNrDMs();
+  }
+  // Begin kernel's template
+  *code = "__kernel void snrSamplesDMsSigmaClip" + std::to_string(nrDMs) + "(__global const " + dataName + " * const restrict input, __global float * const restrict outputSNR, __global unsigned int * const restrict outputSample) {\n"
+    "unsigned int dm = (get_group_id(0) * " + std::to_string(conf.getNrThreadsD0() * conf.getNrItemsD0()) + ") + get_local_id(0);\n"
+    "unsigned int beam = get_group_id(1);\n"
+    "float delta = 0.0f;\n"
+    "<%DEF%>"
+    "\n"
+    "for ( unsigned int iteration = 0; iteration <= " + std::to_string(nrIterations) + "; iteration++ ) {\n"
+    "<%RESET%>"
+    "for ( unsigned int sample = 0; sample < " + std::to_string(nrSamples) + "; sample++ ) {\n"
+    "float item = 0.0f;\n"
+    "<%COMPUTE%>"
+    "}\n"
+    "}\n"
+    "<%STORE%>"
+    "}\n";
+  std::string def_sTemplate = "float counter<%NUM%> = 0.0f;\n"
+    "float max<%NUM%> = " + getSNRInputLoad(dataName, "input", "(beam * " + std::to_string(nrSamples * isa::utils::pad(nrDMs, padding / sizeof(T))) + ") + dm + <%OFFSET%>") + ";\n"
+    "unsigned int maxSample<%NUM%> = 0;\n"
+    "float variance<%NUM%> = 0.0f;\n"
+    "float mean<%NUM%> = 0.0f;\n"
+    "float clipMean<%NUM%> = 0.0f;\n"
+    "float clipLimit<%NUM%> = INFINITY;\n";
+  // Statistics of the next iteration only include the samples within sigma standard deviations
+  std::string reset_sTemplate = "if ( iteration > 0 ) {\n"
+    "clipMean<%NUM%> = mean<%NUM%>;\n"
+    "clipLimit<%NUM%> = " + std::to_string(sigma) + "f * native_sqrt(variance<%NUM%> / (counter<%NUM%> - 1.0f));\n"
+    "}\n"
+    "counter<%NUM%> = 0.0f;\n"
+    "variance<%NUM%> = 0.0f;\n"
+    "mean<%NUM%> = 0.0f;\n";
+  std::string compute_sTemplate = "item = " + getSNRInputLoad(dataName, "input", "(beam * " + std::to_string(nrSamples * isa::utils::pad(nrDMs, padding / sizeof(T))) + ") + (sample * " + std::to_string(isa::utils::pad(nrDMs, padding / sizeof(T))) + ")  + (dm + <%OFFSET%>)") + ";\n"
+    "if ( fabs(item - clipMean<%NUM%>) <= clipLimit<%NUM%> ) {\n"
+    "counter<%NUM%> += 1.0f;\n"
+    "delta = item - mean<%NUM%>;\n"
+    "mean<%NUM%> += delta / counter<%NUM%>;\n"
+    "variance<%NUM%> += delta * (item - mean<%NUM%>);\n"
+    "}\n"
+    "if ( item > max<%NUM%> ) {\n"
+    "max<%NUM%> = item;\n"
+    "maxSample<%NUM%> = sample;\n"
+    "}\n";
+  std::string store_sTemplate = "outputSNR[(beam * " + std::to_string(isa::utils::pad(nrDMs, padding / sizeof(float))) + ") + dm + <%OFFSET%>] = (max<%NUM%> - mean<%NUM%>) / native_sqrt(variance<%NUM%> / (counter<%NUM%> - 1.0f));\n"
+    "outputSample[(beam * " + std::to_string(isa::utils::pad(nrDMs, padding / sizeof(unsigned int))) + ") + dm + <%OFFSET%>] = maxSample<%NUM%>;\n";
+  // End kernel's template
+
+  std::string * def_s = new std::string();
+  std::string * reset_s = new std::string();
+  std::string * compute_s = new std::string();
+  std::string * store_s = new std::string();
+
+  for ( unsigned int dm = 0; dm < conf.getNrItemsD0(); dm++ ) {
+    std::string dm_s = std::to_string(dm);
+    std::string offset_s = std::to_string(conf.getNrThreadsD0() * dm);
+    std::string * temp = 0;
+
+    temp = isa::utils::replace(&def_sTemplate, "<%NUM%>", dm_s);
+    if ( dm == 0 ) {
+      std::string empty_s("");
+      temp = isa::utils::replace(temp, " + <%OFFSET%>", empty_s, true);
+    } else {
+      temp = isa::utils::replace(temp, "<%OFFSET%>", offset_s, true);
+    }
+    def_s->append(*temp);
+    delete temp;
+    temp = isa::utils::replace(&reset_sTemplate, "<%NUM%>", dm_s);
+    reset_s->append(*temp);
+    delete temp;
+    temp = isa::utils::replace(&compute_sTemplate, "<%NUM%>", dm_s);
+    if ( dm == 0 ) {
+      std::string empty_s("");
+      temp = isa::utils::replace(temp, " + <%OFFSET%>", empty_s, true);
+    } else {
+      temp = isa::utils::replace(temp, "<%OFFSET%>", offset_s, true);
+    }
+    compute_s->append(*temp);
+    delete temp;
+    temp = isa::utils::replace(&store_sTemplate, "<%NUM%>", dm_s);
+    if ( dm == 0 ) {
+      std::string empty_s("");
+      temp = isa::utils::replace(temp, " + <%OFFSET%>", empty_s, true);
+    } else {
+      temp = isa::utils::replace(temp, "<%OFFSET%>", offset_s, true);
+    }
+    store_s->append(*temp);
+    delete temp;
+  }
+
+  code = isa::utils::replace(code, "<%DEF%>", *def_s, true);
+  code = isa::utils::replace(code, "<%RESET%>", *reset_s, true);
+  code = isa::utils::replace(code, "<%COMPUTE%>", *compute_s, true);
+  code = isa::utils::replace(code, "<%STORE%>", *store_s, true);
+  delete def_s;
+  delete reset_s;
+  delete compute_s;
+  delete store_s;
+
+  return code;
+}
+
+template<typename T> std::string * getSNRTransposeOpenCL(const snrConf & conf, const std::string & dataName, const AstroData::Observation & observation, const unsigned int nrSamples, const unsigned int padding, const bool DMsSamples) {
+  unsigned int nrDMs = 0;
+  unsigned int nrRows = 0;
+  unsigned int nrColumns = 0;
+  std::string * code = new std::string();
+  // Elements are only copied, so half is moved as its bits
+  std::string type_s = dataName;
+  std::string load_s;
+  std::string store_s;
+
+  if ( conf.getSubbandDedispersion() ) {
+    nrDMs = observation.getNrDMs(true) * observation.getNrDMs();
+  } else {
+    nrDMs = observation.getNrDMs();
+  }
+  if ( DMsSamples ) {
+    nrRows = nrDMs;
+    nrColumns = nrSamples;
+  } else {
+    nrRows = nrSamples;
+    nrColumns = nrDMs;
+  }
+  if ( dataName == "half" ) {
+    type_s = "ushort";
+  }
+  // Begin kernel's template
+  load_s = "tile[(get_local_id(1) * " + std::to_string(conf.getTransposeTile() + 1) + ") + get_local_id(0)] = input[(beam * " + std::to_string(nrRows * isa::utils::pad(nrColumns, padding / sizeof(T))) + ") + (row * " + std::to_string(isa::utils::pad(nrColumns, padding / sizeof(T))) + ") + column];\n";
+  store_s = "output[(beam * " + std::to_string(nrColumns * isa::utils::pad(nrRows, padding / sizeof(T))) + ") + (row * " + std::to_string(isa::utils::pad(nrRows, padding / sizeof(T))) + ") + column] = tile[(get_local_id(0) * " + std::to_string(conf.getTransposeTile() + 1) + ") + get_local_id(1)];\n";
+  // Only the tiles on the border are partially outside of the input
+  if ( (nrRows % conf.getTransposeTile() != 0) || (nrColumns % conf.getTransposeTile() != 0) ) {
+    load_s = "if ( (row < " + std::to_string(nrRows) + ") && (column < " + std::to_string(nrColumns) + ") ) {\n" + load_s + "}\n";
+    store_s = "if ( (row < " + std::to_string(nrColumns) + ") && (column < " + std::to_string(nrRows) + ") ) {\n" + store_s + "}\n";
+  }
+  // The rows of the tile are one element longer, so that the columns are read from different banks
+  *code = "__kernel void snrTranspose" + std::string(DMsSamples ? "DMsSamples" : "SamplesDMs") + std::to_string(nrSamples) + "(__global const " + type_s + " * const restrict input, __global " + type_s + " * const restrict output) {\n"
+    "unsigned int beam = get_group_id(2);\n"
+    "unsigned int row = (get_group_id(1) * " + std::to_string(conf.getTransposeTile()) + ") + get_local_id(1);\n"
+    "unsigned int column = (get_group_id(0) * " + std::to_string(conf.getTransposeTile()) + ") + get_local_id(0);\n"
+    "__local " + type_s + " tile[" + std::to_string(conf.getTransposeTile() * (conf.getTransposeTile() + 1)) + "];\n"
+    "\n"
+    "// Load phase\n"
+    + load_s +
+    "barrier(CLK_LOCAL_MEM_FENCE);\n"
+    "// Store phase\n"
+    "row = (get_group_id(0) * " + std::to_string(conf.getTransposeTile()) + ") + get_local_id(1);\n"
+    "column = (get_group_id(1) * " + std::to_string(conf.getTransposeTile()) + ") + get_local_id(0);\n"
+    + store_s +
+    "}\n";
+  // End kernel's template
+
+  return code;
+}
+
 } // SNR
 
@@ -0,0 +1,43 @@
+// Copyright 2017 Netherlands Institute for Radio Astronomy (ASTRON)
+// Copyright 2017 Netherlands eScience Center
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <vector>
+#include <string>
+#include <functional>
+
+#include <Observation.hpp>
+#include <SNR.hpp>
+
+#pragma once
+
+namespace SNR {
+
+// Native CPU SNR
+//
+// Same input layouts, padding and outputs as the OpenCL kernels; the configuration is interpreted as:
+//  - nrThreadsD0 : number of host threads
+//  - nrItemsD0   : number of DMs (DMsSamples) or of 16 DMs blocks (SamplesDMs) per task
+// The SIMD width (AVX-512, AVX2 or scalar) is selected at run-time.
+template<typename T> void snrDMsSamplesCPU(const snrConf & conf, const AstroData::Observation & observation, const unsigned int nrSamples, const unsigned int padding, const std::vector<T> & input, std::vector<float> & outputSNR, std::vector<unsigned int> & outputSample);
+template<typename T> void snrSamplesDMsCPU(const snrConf & conf, const AstroData::Observation & observation, const unsigned int nrSamples, const unsigned int padding, const std::vector<T> & input, std::vector<float> & outputSNR, std::vector<unsigned int> & outputSample);
+// Name of the instruction set used by the CPU kernels
+std::string getCPUInstructionSet();
+// Execute task(0) ... task(nrTasks - 1) on nrThreads host threads (0 for all the cores)
+// The threads are kept in a pool and reused, so a call costs a wake-up instead of thread creation; calls made while the pool is busy, from another thread or from inside a task, start and join their own threads
+// If a task throws, the remaining tasks are not started and the first exception is rethrown after every thread has returned
+void parallelFor(const unsigned int nrTasks, const unsigned int nrThreads, const std::function<void(unsigned int)> & task);
+
+} // SNR
+
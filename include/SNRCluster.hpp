@@ -0,0 +1,59 @@
+// Copyright 2017 Netherlands Institute for Radio Astronomy (ASTRON)
+// Copyright 2017 Netherlands eScience Center
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <vector>
+
+#include <Observation.hpp>
+#include <SNR.hpp>
+
+#pragma once
+
+namespace SNR {
+
+// Event found by clustering candidates, represented by its candidate with highest SNR
+struct snrCluster {
+  snrCandidate peak;
+  unsigned int nrMembers;
+  // Bounding box of the members, inclusive
+  unsigned int firstBeam;
+  unsigned int lastBeam;
+  unsigned int firstDM;
+  unsigned int lastDM;
+  unsigned int firstSample;
+  unsigned int lastSample;
+};
+
+// Maximum distance between two candidates of the same event, in every dimension
+struct snrClusterDistance {
+  unsigned int beams;
+  unsigned int dms;
+  unsigned int samples;
+};
+
+// Host-side candidate clustering
+//
+// Candidates are friends when they are within distance in beam, DM and sample at the same time, and an event is a connected group of friends (friends-of-friends).
+// The candidates are sorted in one row per beam, ordered by DM, so that only the rows within distance are searched, from the first DM within distance; the groups are merged with a lock-free union-find on nrThreads host threads (0 for all the cores).
+// The output does not depend on the number of threads: events are sorted by their first member in (beam, DM, sample) order, and ties in SNR go to the first member.
+
+// Candidates with SNR >= threshold from the outputs of the dense kernels, padded as the kernels write them, sorted by beam and DM
+std::vector<snrCandidate> getCandidates(const AstroData::Observation & observation, const unsigned int padding, const float threshold, const std::vector<float> & outputSNR, const std::vector<unsigned int> & outputSample, const unsigned int nrThreads);
+// Cluster candidates in any order, with beam < nrBeams and dm < nrDMs
+std::vector<snrCluster> clusterCandidates(const std::vector<snrCandidate> & candidates, const unsigned int nrBeams, const unsigned int nrDMs, const snrClusterDistance & distance, const unsigned int nrThreads);
+// Threshold and cluster the outputs of the dense kernels
+std::vector<snrCluster> clusterSNR(const AstroData::Observation & observation, const unsigned int padding, const float threshold, const std::vector<float> & outputSNR, const std::vector<unsigned int> & outputSample, const snrClusterDistance & distance, const unsigned int nrThreads);
+
+} // SNR
+
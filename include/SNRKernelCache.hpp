@@ -0,0 +1,172 @@
+// Copyright 2017 Netherlands Institute for Radio Astronomy (ASTRON)
+// Copyright 2017 Netherlands eScience Center
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <string>
+#include <vector>
+#include <atomic>
+#include <cstdint>
+
+#include <Kernel.hpp>
+#include <Observation.hpp>
+#include <SNR.hpp>
+#include <SNRCPU.hpp>
+
+#pragma once
+
+namespace SNR {
+
+// On disk cache of compiled program binaries
+//
+// The key of every entry contains device name, driver version, compiler flags, kernel name, a description of the configuration and a hash of the source code.
+// Entries that cannot be loaded or built are recompiled from source and overwritten.
+class snrKernelCache {
+public:
+  snrKernelCache(const std::string & directory);
+  ~snrKernelCache();
+  // Get
+  unsigned int getNrHits() const;
+  unsigned int getNrMisses() const;
+  // Load the kernel from disk, or compile it and store the binary
+  cl::Kernel * getKernel(const std::string & name, const std::string & code, const std::string & flags, const std::string & description, cl::Context & context, cl::Device & device);
+  // utils
+  static uint64_t hash(const std::string & data);
+
+private:
+  std::string directory;
+  std::atomic<unsigned int> nrHits;
+  std::atomic<unsigned int> nrMisses;
+
+  cl::Kernel * load(const std::string & path, const std::string & key, const std::string & name, const std::string & flags, cl::Context & context, cl::Device & device);
+  void store(const std::string & path, const std::string & key, cl::Kernel * kernel);
+};
+
+// Generate and compile, or load, the dense SNR kernel; throws isa::OpenCL::OpenCLError if the device does not support the configuration
+template<typename T> cl::Kernel * getSNRKernel(snrKernelCache & cache, const bool DMsSamples, const snrConf & conf, const std::string & dataName, const AstroData::Observation & observation, const unsigned int nrSamples, const unsigned int padding, cl::Context & context, cl::Device & device);
+// Generate and compile, or load, the sliced SNR kernel and its merge kernel
+template<typename T> cl::Kernel * getSNRSlicedKernel(snrKernelCache & cache, const snrConf & conf, const std::string & dataName, const AstroData::Observation & observation, const unsigned int nrSamples, const unsigned int padding, cl::Context & context, cl::Device & device, cl::Kernel ** mergeKernel);
+// Generate and compile, or load, the kernel transposing an input in the DMsSamples, or SamplesDMs, layout
+template<typename T> cl::Kernel * getSNRTransposeKernel(snrKernelCache & cache, const bool DMsSamples, const snrConf & conf, const std::string & dataName, const AstroData::Observation & observation, const unsigned int nrSamples, const unsigned int padding, cl::Context & context, cl::Device & device);
+// Compile, or load, the kernels of all configurations tuned for deviceName using nrThreads host threads
+//
+// DMsSamples is the layout of the input; configurations with a transpose tile also get the transpose kernel, and the dense kernel of the other layout.
+template<typename T> void prewarmSNRKernels(snrKernelCache & cache, const snrConfTable & tunedSNR, const std::string & deviceName, const bool DMsSamples, const std::string & dataName, const AstroData::Observation & observation, const unsigned int padding, cl::Context & context, cl::Device & device, const unsigned int nrThreads);
+
+
+// Implementations
+inline unsigned int snrKernelCache::getNrHits() const {
+  return nrHits;
+}
+
+inline unsigned int snrKernelCache::getNrMisses() const {
+  return nrMisses;
+}
+
+template<typename T> cl::Kernel * getSNRKernel(snrKernelCache & cache, const bool DMsSamples, const snrConf & conf, const std::string & dataName, const AstroData::Observation & observation, const unsigned int nrSamples, const unsigned int padding, cl::Context & context, cl::Device & device) {
+  std::string name;
+  std::string * code = 0;
+  std::string description = conf.print() + " " + dataName + " " + std::to_string(padding) + " " + std::to_string(observation.getNrSynthesizedBeams()) + " " + std::to_string(observation.getNrDMs(true)) + " " + std::to_string(observation.getNrDMs()) + " " + std::to_string(nrSamples);
+
+  if ( !isSupportedSNRConf(conf, device) ) {
+    throw isa::OpenCL::OpenCLError("The SNR configuration " + conf.print() + " is not supported by the device.");
+  }
+  if ( DMsSamples ) {
+    name = "snrDMsSamples" + std::to_string(nrSamples);
+    code = getSNRDMsSamplesOpenCL<T>(conf, dataName, observation, nrSamples, padding);
+  } else {
+    if ( conf.getSubbandDedispersion() ) {
+      name = "snrSamplesDMs" + std::to_string(observation.getNrDMs(true) * observation.getNrDMs());
+    } else {
+      name = "snrSamplesDMs" + std::to_string(observation.getNrDMs());
+    }
+    code = getSNRSamplesDMsOpenCL<T>(conf, dataName, observation, nrSamples, padding);
+  }
+  cl::Kernel * kernel = cache.getKernel(name, *code, getSNRBuildFlags(conf), description, context, device);
+  delete code;
+
+  return kernel;
+}
+
+template<typename T> cl::Kernel * getSNRSlicedKernel(snrKernelCache & cache, const snrConf & conf, const std::string & dataName, const AstroData::Observation & observation, const unsigned int nrSamples, const unsigned int padding, cl::Context & context, cl::Device & device, cl::Kernel ** mergeKernel) {
+  std::string description = conf.print() + " " + dataName + " " + std::to_string(padding) + " " + std::to_string(observation.getNrSynthesizedBeams()) + " " + std::to_string(observation.getNrDMs(true) * observation.getNrDMs()) + " " + std::to_string(nrSamples);
+  std::string * code = getSNRSamplesDMsSlicedOpenCL<T>(conf, dataName, observation, nrSamples, padding);
+  std::string * mergeCode = getSNRSamplesDMsMergeOpenCL(conf, observation, nrSamples, padding);
+  cl::Kernel * kernel = 0;
+
+  try {
+    kernel = cache.getKernel("snrSamplesDMsSliced" + std::to_string(observation.getNrDMs(true) * observation.getNrDMs()), *code, "-cl-mad-enable -Werror", description, context, device);
+    *mergeKernel = cache.getKernel("snrSamplesDMsMerge" + std::to_string(observation.getNrDMs(true) * observation.getNrDMs()), *mergeCode, "-cl-mad-enable -Werror", description, context, device);
+  } catch ( ... ) {
+    delete kernel;
+    delete code;
+    delete mergeCode;
+    throw;
+  }
+  delete code;
+  delete mergeCode;
+
+  return kernel;
+}
+
+template<typename T> cl::Kernel * getSNRTransposeKernel(snrKernelCache & cache, const bool DMsSamples, const snrConf & conf, const std::string & dataName, const AstroData::Observation & observation, const unsigned int nrSamples, const unsigned int padding, cl::Context & context, cl::Device & device) {
+  std::string description = std::to_string(conf.getTransposeTile()) + " " + dataName + " " + std::to_string(padding) + " " + std::to_string(observation.getNrSynthesizedBeams()) + " " + std::to_string(observation.getNrDMs(true) * observation.getNrDMs()) + " " + std::to_string(nrSamples);
+  std::string * code = getSNRTransposeOpenCL<T>(conf, dataName, observation, nrSamples, padding, DMsSamples);
+  cl::Kernel * kernel = 0;
+
+  try {
+    kernel = cache.getKernel("snrTranspose" + std::string(DMsSamples ? "DMsSamples" : "SamplesDMs") + std::to_string(nrSamples), *code, "-cl-mad-enable -Werror", description, context, device);
+  } catch ( ... ) {
+    delete code;
+    throw;
+  }
+  delete code;
+
+  return kernel;
+}
+
+template<typename T> void prewarmSNRKernels(snrKernelCache & cache, const snrConfTable & tunedSNR, const std::string & deviceName, const bool DMsSamples, const std::string & dataName, const AstroData::Observation & observation, const unsigned int padding, cl::Context & context, cl::Device & device, const unsigned int nrThreads) {
+  auto entries = tunedSNR.getEntries(deviceName);
+
+  parallelFor(entries.second - entries.first, nrThreads, [&](unsigned int entry) {
+    AstroData::Observation entryObservation = observation;
+    const snrConfTable::entry & item = *(entries.first + entry);
+
+    // The tuned number of DMs includes the subbanding DMs
+    if ( item.conf.getSubbandDedispersion() ) {
+      entryObservation.setDMRange(item.nrDMs / observation.getNrDMs(true), 0.0f, 0.0f);
+    } else {
+      entryObservation.setDMRange(item.nrDMs, 0.0f, 0.0f);
+    }
+    entryObservation.setNrSamplesPerBatch(item.nrSamples);
+    // Configurations that do not compile are skipped, they fail again when used
+    try {
+      if ( item.conf.getNrSlices() > 1 ) {
+        cl::Kernel * mergeKernel = 0;
+
+        delete getSNRSlicedKernel<T>(cache, item.conf, dataName, entryObservation, item.nrSamples, padding, context, device, &mergeKernel);
+        delete mergeKernel;
+      } else {
+        delete getSNRKernel<T>(cache, DMsSamples != (item.conf.getTransposeTile() > 0), item.conf, dataName, entryObservation, item.nrSamples, padding, context, device);
+      }
+      if ( item.conf.getTransposeTile() > 0 ) {
+        delete getSNRTransposeKernel<T>(cache, DMsSamples, item.conf, dataName, entryObservation, item.nrSamples, padding, context, device);
+      }
+    } catch ( isa::OpenCL::OpenCLError & err ) {
+    } catch ( cl::Error & err ) {
+    }
+  });
+}
+
+} // SNR
+
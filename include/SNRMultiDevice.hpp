@@ -0,0 +1,161 @@
+// Copyright 2017 Netherlands Institute for Radio Astronomy (ASTRON)
+// Copyright 2017 Netherlands eScience Center
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <string>
+#include <vector>
+#include <atomic>
+#include <functional>
+#include <algorithm>
+#include <cstdint>
+
+#include <Kernel.hpp>
+#include <Observation.hpp>
+#include <utils.hpp>
+#include <SNR.hpp>
+
+#pragma once
+
+namespace SNR {
+
+// Dense SNR over multiple OpenCL devices
+//
+// The synthesized beams are split in chunks of nrBeamsPerChunk beams.
+// Every device has its own context, queue, kernel, buffers and host thread, and takes the next chunk as soon as it is done with the previous one, so faster devices process more beams.
+// The outputs have the same layout as with a single device.
+class snrMultiDevice {
+public:
+  snrMultiDevice(const std::vector<cl::Device> & devices, const unsigned int nrBeamsPerChunk);
+  ~snrMultiDevice();
+  // Get
+  unsigned int getNrDevices() const;
+  unsigned int getNrBeamsPerChunk() const;
+  // Number of beams processed by every device in the last run
+  const std::vector<unsigned int> & getNrProcessedBeams() const;
+  // Generate and compile the kernel of every device, with configuration confs[device], and allocate its buffers
+  template<typename T> void setup(const bool DMsSamples, const std::vector<snrConf> & confs, const std::string & dataName, const AstroData::Observation & observation, const unsigned int padding);
+  // Process all the beams of the observation used in setup
+  template<typename T> void run(const std::vector<T> & input, std::vector<float> & outputSNR, std::vector<unsigned int> & outputSample);
+
+private:
+  struct partition {
+    cl::Device device;
+    cl::Context context;
+    cl::CommandQueue queue;
+    cl::Kernel * kernel;
+    cl::Buffer input_d;
+    cl::Buffer outputSNR_d;
+    cl::Buffer outputSample_d;
+    snrConf conf;
+  };
+  std::vector<partition> partitions;
+  unsigned int nrBeamsPerChunk;
+  std::vector<unsigned int> nrProcessedBeams;
+  bool DMsSamples;
+  unsigned int nrBeams;
+  unsigned int nrDMs;
+  // Elements per beam
+  uint64_t inputBeamSize;
+  uint64_t outputSNRBeamSize;
+  uint64_t outputSampleBeamSize;
+
+  // Execute body(partition, device) for every device, each in its own host thread; the first exception is rethrown
+  void parallel(const std::function<void(partition &, const unsigned int)> & body);
+  void allocate(partition & item, const uint64_t inputSize);
+  cl::NDRange getGlobal(const snrConf & conf, const unsigned int nrChunkBeams) const;
+  cl::NDRange getLocal(const snrConf & conf) const;
+};
+
+// One sub-device per NUMA node of device (device fission), or device itself when it cannot be partitioned
+std::vector<cl::Device> getNUMASubDevices(cl::Device & device);
+
+
+// Implementations
+inline unsigned int snrMultiDevice::getNrDevices() const {
+  return partitions.size();
+}
+
+inline unsigned int snrMultiDevice::getNrBeamsPerChunk() const {
+  return nrBeamsPerChunk;
+}
+
+inline const std::vector<unsigned int> & snrMultiDevice::getNrProcessedBeams() const {
+  return nrProcessedBeams;
+}
+
+template<typename T> void snrMultiDevice::setup(const bool DMsSamples, const std::vector<snrConf> & confs, const std::string & dataName, const AstroData::Observation & observation, const unsigned int padding) {
+  this->DMsSamples = DMsSamples;
+  nrBeams = observation.getNrSynthesizedBeams();
+  nrDMs = observation.getNrDMs(true) * observation.getNrDMs();
+  if ( DMsSamples ) {
+    inputBeamSize = static_cast<uint64_t>(nrDMs) * observation.getNrSamplesPerBatch(false, padding / sizeof(T));
+  } else {
+    inputBeamSize = static_cast<uint64_t>(observation.getNrSamplesPerBatch()) * observation.getNrDMs(true) * observation.getNrDMs(false, padding / sizeof(T));
+  }
+  outputSNRBeamSize = isa::utils::pad(nrDMs, padding / sizeof(float));
+  outputSampleBeamSize = isa::utils::pad(nrDMs, padding / sizeof(unsigned int));
+  parallel([&](partition & item, const unsigned int device) {
+    std::string * code = 0;
+    std::string name;
+
+    item.conf = confs.at(device);
+    if ( !isSupportedSNRConf(item.conf, item.device) ) {
+      throw isa::OpenCL::OpenCLError("The SNR configuration " + item.conf.print() + " is not supported by device " + std::to_string(device) + ".");
+    }
+    if ( DMsSamples ) {
+      code = getSNRDMsSamplesOpenCL<T>(item.conf, dataName, observation, observation.getNrSamplesPerBatch(), padding);
+      name = "snrDMsSamples" + std::to_string(observation.getNrSamplesPerBatch());
+    } else {
+      code = getSNRSamplesDMsOpenCL<T>(item.conf, dataName, observation, observation.getNrSamplesPerBatch(), padding);
+      name = "snrSamplesDMs" + std::to_string(nrDMs);
+    }
+    delete item.kernel;
+    item.kernel = 0;
+    try {
+      item.kernel = isa::OpenCL::compile(name, *code, getSNRBuildFlags(item.conf), item.context, item.device);
+    } catch ( ... ) {
+      delete code;
+      throw;
+    }
+    delete code;
+    allocate(item, std::min(nrBeamsPerChunk, nrBeams) * inputBeamSize * sizeof(T));
+    item.kernel->setArg(0, item.input_d);
+    item.kernel->setArg(1, item.outputSNR_d);
+    item.kernel->setArg(2, item.outputSample_d);
+  });
+}
+
+template<typename T> void snrMultiDevice::run(const std::vector<T> & input, std::vector<float> & outputSNR, std::vector<unsigned int> & outputSample) {
+  const unsigned int nrChunks = (nrBeams + nrBeamsPerChunk - 1) / nrBeamsPerChunk;
+  std::atomic<unsigned int> nextChunk(0);
+
+  std::fill(nrProcessedBeams.begin(), nrProcessedBeams.end(), 0);
+  parallel([&](partition & item, const unsigned int device) {
+    unsigned int chunk = 0;
+
+    while ( (chunk = nextChunk++) < nrChunks ) {
+      const unsigned int firstBeam = chunk * nrBeamsPerChunk;
+      const unsigned int nrChunkBeams = std::min(nrBeamsPerChunk, nrBeams - firstBeam);
+
+      item.queue.enqueueWriteBuffer(item.input_d, CL_FALSE, 0, nrChunkBeams * inputBeamSize * sizeof(T), reinterpret_cast<const void *>(input.data() + (firstBeam * inputBeamSize)));
+      item.queue.enqueueNDRangeKernel(*item.kernel, cl::NullRange, getGlobal(item.conf, nrChunkBeams), getLocal(item.conf));
+      item.queue.enqueueReadBuffer(item.outputSNR_d, CL_FALSE, 0, nrChunkBeams * outputSNRBeamSize * sizeof(float), reinterpret_cast<void *>(outputSNR.data() + (firstBeam * outputSNRBeamSize)));
+      item.queue.enqueueReadBuffer(item.outputSample_d, CL_TRUE, 0, nrChunkBeams * outputSampleBeamSize * sizeof(unsigned int), reinterpret_cast<void *>(outputSample.data() + (firstBeam * outputSampleBeamSize)));
+      nrProcessedBeams.at(device) += nrChunkBeams;
+    }
+  });
+}
+
+} // SNR
+
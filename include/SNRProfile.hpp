@@ -0,0 +1,73 @@
+// Copyright 2017 Netherlands Institute for Radio Astronomy (ASTRON)
+// Copyright 2017 Netherlands eScience Center
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <string>
+#include <vector>
+#include <array>
+
+#include <Kernel.hpp>
+
+#pragma once
+
+namespace SNR {
+
+// Timing of the iterations of a kernel from OpenCL profiling events, in seconds
+//
+// For every event the kernel time (end - start), the submission delay (submit - queued) and the launch delay (start - submit) are recorded,
+// together with the raw QUEUED, SUBMIT, START and END timestamps in nanoseconds.
+class snrProfile {
+public:
+  snrProfile();
+  ~snrProfile();
+  // Get
+  unsigned int getNrIterations() const;
+  const std::vector<double> & getKernelTimes() const;
+  const std::vector<std::array<cl_ulong, 4> > & getTimestamps() const;
+  double getMeanKernelTime() const;
+  // Add a completed event of a queue created with CL_QUEUE_PROFILING_ENABLE
+  void addEvent(const cl::Event & event);
+  // Add the commands from first to last, enqueued in order, as one iteration
+  void addEvent(const cl::Event & first, const cl::Event & last);
+  void reset();
+  // JSON object with iterations, mean, min, p50, p90, p99, max of the kernel, submit and launch times, and the [queued, submit, start, end] timestamps of every iteration
+  std::string getJSON() const;
+  // utils
+  // Percentile in [0, 100] with linear interpolation between the closest ranks, 0 for no values
+  static double getPercentile(std::vector<double> values, const double percentile);
+  static std::string getJSONStatistics(const std::vector<double> & values);
+
+private:
+  std::vector<double> kernelTimes;
+  std::vector<double> submitTimes;
+  std::vector<double> launchTimes;
+  std::vector<std::array<cl_ulong, 4> > timestamps;
+};
+
+
+// Implementations
+inline unsigned int snrProfile::getNrIterations() const {
+  return kernelTimes.size();
+}
+
+inline const std::vector<double> & snrProfile::getKernelTimes() const {
+  return kernelTimes;
+}
+
+inline const std::vector<std::array<cl_ulong, 4> > & snrProfile::getTimestamps() const {
+  return timestamps;
+}
+
+} // SNR
+
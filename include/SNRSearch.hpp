@@ -0,0 +1,142 @@
+// Copyright 2017 Netherlands Institute for Radio Astronomy (ASTRON)
+// Copyright 2017 Netherlands eScience Center
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <string>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <deque>
+
+#include <SNR.hpp>
+
+#pragma once
+
+namespace SNR {
+
+// Search strategy for the tuning space
+//
+// The configurations are visited at most once, in an order decided by the strategy, until the space or the budget are exhausted.
+// The performance of every configuration is reported back to the strategy; failing configurations are reported with zero performance.
+// Multiple configurations can be requested before reporting, their performance is then reported in the same order.
+// With the same configurations, seed and reported performance the order is always the same.
+class snrSearch {
+public:
+  snrSearch(const std::vector<snrConf> & configurations, const unsigned int seed);
+  virtual ~snrSearch();
+  // Get
+  unsigned int getNrEvaluations() const;
+  // Set
+  void setMaxEvaluations(const unsigned int evaluations);
+  void setMaxTime(const double seconds);
+  // Store in conf the next configuration to evaluate, false when the space or the budget are exhausted
+  bool next(snrConf & conf);
+  // Performance of the oldest configuration returned by next and not reported yet
+  void report(const double performance);
+
+protected:
+  std::vector<snrConf> configurations;
+  // Position of every configuration in the (threads, items) grid
+  std::vector<std::pair<unsigned int, unsigned int> > coordinates;
+  std::vector<bool> evaluated;
+  std::vector<double> performance;
+  std::mt19937 generator;
+
+  // Index of the next configuration, false if there is none left
+  virtual bool select(unsigned int & index) = 0;
+  virtual void update(const unsigned int index, const double performance);
+  // Indices of the configurations not evaluated yet, at grid distance at most radius from index
+  std::vector<unsigned int> getCandidates(const unsigned int index, const unsigned int radius) const;
+  unsigned int getDistance(const unsigned int first, const unsigned int second) const;
+  unsigned int getRandomCandidate();
+
+private:
+  unsigned int nrEvaluations;
+  unsigned int maxEvaluations;
+  double maxTime;
+  std::deque<unsigned int> pending;
+  std::chrono::steady_clock::time_point start;
+};
+
+// Same order as the tuning loops
+class snrExhaustiveSearch : public snrSearch {
+public:
+  snrExhaustiveSearch(const std::vector<snrConf> & configurations, const unsigned int seed);
+  ~snrExhaustiveSearch();
+
+private:
+  bool select(unsigned int & index);
+};
+
+// Uniform sampling without replacement
+class snrRandomSearch : public snrSearch {
+public:
+  snrRandomSearch(const std::vector<snrConf> & configurations, const unsigned int seed);
+  ~snrRandomSearch();
+
+private:
+  bool select(unsigned int & index);
+};
+
+// Simulated annealing on the (threads, items) grid; with temperature zero only improvements are accepted (hill climbing)
+//
+// The temperature is relative to the performance of the current configuration, and multiplied by cooling after every step.
+class snrAnnealingSearch : public snrSearch {
+public:
+  snrAnnealingSearch(const std::vector<snrConf> & configurations, const unsigned int seed, const double temperature, const double cooling);
+  ~snrAnnealingSearch();
+
+private:
+  double temperature;
+  double cooling;
+  bool started;
+  unsigned int current;
+  double currentPerformance;
+
+  bool select(unsigned int & index);
+  void update(const unsigned int index, const double performance);
+};
+
+// After nrSamples random configurations, evaluate the configuration with the highest performance predicted by inverse distance weighting of the evaluated ones
+class snrModelSearch : public snrSearch {
+public:
+  snrModelSearch(const std::vector<snrConf> & configurations, const unsigned int seed, const unsigned int nrSamples);
+  ~snrModelSearch();
+
+private:
+  unsigned int nrSamples;
+
+  bool select(unsigned int & index);
+  double predict(const unsigned int index) const;
+};
+
+// Strategies: exhaustive, random, hill_climbing, annealing, model; returns 0 for an unknown strategy
+snrSearch * getSNRSearch(const std::string & strategy, const std::vector<snrConf> & configurations, const unsigned int seed);
+
+
+// Implementations
+inline unsigned int snrSearch::getNrEvaluations() const {
+  return nrEvaluations;
+}
+
+inline void snrSearch::setMaxEvaluations(const unsigned int evaluations) {
+  maxEvaluations = evaluations;
+}
+
+inline void snrSearch::setMaxTime(const double seconds) {
+  maxTime = seconds;
+}
+
+} // SNR
+
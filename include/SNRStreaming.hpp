@@ -0,0 +1,157 @@
+// Copyright 2017 Netherlands Institute for Radio Astronomy (ASTRON)
+// Copyright 2017 Netherlands eScience Center
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+#include <cstdint>
+
+#include <Kernel.hpp>
+#include <Observation.hpp>
+#include <utils.hpp>
+#include <SNR.hpp>
+
+#pragma once
+
+namespace SNR {
+
+// Asynchronous batch processing with the dense SNR kernel
+//
+// nrBuffers sets of input and output buffers are used in rotation.
+// Transfers to the device, kernels and transfers to the host are enqueued on three command queues and ordered with events, so the copy of batch n + 1, the kernel of batch n and the copy back of batch n - 1 overlap.
+// The callback is called, in batch order and from a thread of the driver, as soon as the outputs of a batch are on the host.
+class snrStreamingDriver {
+public:
+  typedef std::function<void(const uint64_t batch)> callback;
+
+  snrStreamingDriver(cl::Context & context, cl::Device & device, const unsigned int nrBuffers);
+  ~snrStreamingDriver();
+  // Get
+  unsigned int getNrBuffers() const;
+  uint64_t getNrBatches() const;
+  // Set
+  void setCallback(const callback & function);
+  // Generate and compile the kernel, and allocate the buffer sets
+  template<typename T> void setup(const bool DMsSamples, const snrConf & conf, const std::string & dataName, const AstroData::Observation & observation, const unsigned int padding);
+  // Enqueue a batch and return its number; the input must not change, and the outputs must not be accessed, until its callback
+  // Blocks while all buffer sets are in use
+  template<typename T> uint64_t enqueue(const std::vector<T> & input, std::vector<float> & outputSNR, std::vector<unsigned int> & outputSample);
+  // Wait until the callbacks of all enqueued batches are done
+  void finish();
+
+private:
+  struct bufferSet {
+    cl::Buffer input_d;
+    cl::Buffer outputSNR_d;
+    cl::Buffer outputSample_d;
+    // Completion of the last transfer to the host using this set
+    cl::Event done;
+    bool used;
+  };
+  cl::Context & context;
+  cl::Device & device;
+  cl::CommandQueue writeQueue;
+  cl::CommandQueue kernelQueue;
+  cl::CommandQueue readQueue;
+  cl::Kernel * kernel;
+  std::vector<bufferSet> sets;
+  cl::NDRange global;
+  cl::NDRange local;
+  uint64_t inputSize;
+  uint64_t outputSNRSize;
+  uint64_t outputSampleSize;
+  uint64_t nrBatches;
+  callback function;
+  // Batches waiting for completion
+  std::deque<std::pair<uint64_t, cl::Event> > pending;
+  bool stop;
+  std::exception_ptr error;
+  std::mutex pendingMutex;
+  std::condition_variable pendingCondition;
+  std::thread completion;
+
+  void allocate();
+  // Wait until buffer set can be reused, rethrowing the errors of the completion thread
+  void acquire(bufferSet & set);
+  void submit(bufferSet & set, const void * input, float * outputSNR, unsigned int * outputSample);
+  // Body of the completion thread
+  void complete();
+};
+
+
+// Implementations
+inline unsigned int snrStreamingDriver::getNrBuffers() const {
+  return sets.size();
+}
+
+inline uint64_t snrStreamingDriver::getNrBatches() const {
+  return nrBatches;
+}
+
+inline void snrStreamingDriver::setCallback(const callback & function) {
+  this->function = function;
+}
+
+template<typename T> void snrStreamingDriver::setup(const bool DMsSamples, const snrConf & conf, const std::string & dataName, const AstroData::Observation & observation, const unsigned int padding) {
+  std::string * code = 0;
+  std::string name;
+  const unsigned int nrDMs = observation.getNrDMs(true) * observation.getNrDMs();
+
+  finish();
+  if ( !isSupportedSNRConf(conf, device) ) {
+    throw isa::OpenCL::OpenCLError("The SNR configuration " + conf.print() + " is not supported by the device.");
+  }
+  if ( DMsSamples ) {
+    code = getSNRDMsSamplesOpenCL<T>(conf, dataName, observation, observation.getNrSamplesPerBatch(), padding);
+    name = "snrDMsSamples" + std::to_string(observation.getNrSamplesPerBatch());
+    inputSize = observation.getNrSynthesizedBeams() * static_cast<uint64_t>(nrDMs) * observation.getNrSamplesPerBatch(false, padding / sizeof(T)) * sizeof(T);
+    global = cl::NDRange(conf.getNrThreadsD0(), nrDMs / conf.getNrItemsD1(), observation.getNrSynthesizedBeams());
+    local = cl::NDRange(conf.getNrThreadsD0(), conf.getNrThreadsD1(), 1);
+  } else {
+    code = getSNRSamplesDMsOpenCL<T>(conf, dataName, observation, observation.getNrSamplesPerBatch(), padding);
+    name = "snrSamplesDMs" + std::to_string(nrDMs);
+    inputSize = observation.getNrSynthesizedBeams() * static_cast<uint64_t>(observation.getNrSamplesPerBatch()) * observation.getNrDMs(true) * observation.getNrDMs(false, padding / sizeof(T)) * sizeof(T);
+    global = cl::NDRange(nrDMs / conf.getNrItemsD0(), observation.getNrSynthesizedBeams());
+    local = cl::NDRange(conf.getNrThreadsD0(), 1);
+  }
+  outputSNRSize = observation.getNrSynthesizedBeams() * isa::utils::pad(nrDMs, padding / sizeof(float)) * sizeof(float);
+  outputSampleSize = observation.getNrSynthesizedBeams() * isa::utils::pad(nrDMs, padding / sizeof(unsigned int)) * sizeof(unsigned int);
+  delete kernel;
+  kernel = 0;
+  try {
+    kernel = isa::OpenCL::compile(name, *code, getSNRBuildFlags(conf), context, device);
+  } catch ( ... ) {
+    delete code;
+    throw;
+  }
+  delete code;
+  allocate();
+}
+
+template<typename T> uint64_t snrStreamingDriver::enqueue(const std::vector<T> & input, std::vector<float> & outputSNR, std::vector<unsigned int> & outputSample) {
+  bufferSet & set = sets.at(nrBatches % sets.size());
+
+  acquire(set);
+  submit(set, reinterpret_cast<const void *>(input.data()), outputSNR.data(), outputSample.data());
+  return nrBatches++;
+}
+
+} // SNR
+
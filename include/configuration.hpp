@@ -15,7 +15,23 @@
 
 #pragma once
 
-// Define the data types
+#include <string>
+#include <cstdint>
+
+#include <SNR.hpp>
+
+// Define the data types, the input type is selected with SNR_INPUT_HALF, SNR_INPUT_SHORT or SNR_INPUT_UCHAR
+#if defined(SNR_INPUT_HALF)
+typedef SNR::snrHalf inputDataType;
+std::string inputDataName("half");
+#elif defined(SNR_INPUT_SHORT)
+typedef int16_t inputDataType;
+std::string inputDataName("short");
+#elif defined(SNR_INPUT_UCHAR)
+typedef uint8_t inputDataType;
+std::string inputDataName("uchar");
+#else
 typedef float inputDataType;
 std::string inputDataName("float");
+#endif
 
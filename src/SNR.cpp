@@ -13,16 +13,590 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <cstring>
+#include <cstdlib>
+#include <cctype>
+#include <limits>
+#include <tuple>
+#include <iterator>
+#include <stdexcept>
+
 #include <SNR.hpp>
 
 namespace SNR {
 
-snrConf::snrConf() : KernelConf(), subbandDedispersion(false) {}
+snrConf::snrConf() : KernelConf(), subbandDedispersion(false), subgroupReduction(false), nrSlices(1), vectorWidth(1), transposeTile(0) {}
 
 snrConf::~snrConf() {}
 
 std::string snrConf::print() const {
-  return std::to_string(subbandDedispersion) + " " + isa::OpenCL::KernelConf::print();
+  return print(false);
+}
+
+std::string snrConf::print(const bool allFields) const {
+  std::string fields = std::to_string(subbandDedispersion) + " " + isa::OpenCL::KernelConf::print();
+
+  if ( allFields || subgroupReduction || nrSlices != 1 || vectorWidth != 1 || transposeTile != 0 ) {
+    fields += " " + std::to_string(subgroupReduction) + " " + std::to_string(nrSlices) + " " + std::to_string(vectorWidth) + " " + std::to_string(transposeTile);
+  }
+  return fields;
+}
+
+snrHalf::snrHalf(const float value) {
+  uint32_t bits = 0;
+  uint32_t sign = 0;
+  int32_t exponent = 0;
+  uint32_t mantissa = 0;
+
+  std::memcpy(&bits, &value, sizeof(float));
+  sign = (bits >> 16) & 0x8000;
+  exponent = static_cast<int32_t>((bits >> 23) & 0xFF) - 127 + 15;
+  mantissa = bits & 0x7FFFFF;
+  if ( ((bits >> 23) & 0xFF) == 0xFF ) {
+    // Infinity and NaN
+    this->value = sign | 0x7C00 | (mantissa ? 0x200 : 0);
+  } else if ( exponent >= 31 ) {
+    this->value = sign | 0x7C00;
+  } else if ( exponent <= 0 ) {
+    // Subnormal or zero
+    if ( exponent < -10 ) {
+      this->value = sign;
+    } else {
+      uint32_t shift = 14 - exponent;
+      uint32_t halfMantissa = 0;
+
+      mantissa |= 0x800000;
+      halfMantissa = mantissa >> shift;
+      if ( (mantissa & ((1u << shift) - 1)) > (1u << (shift - 1)) || ((mantissa & ((1u << shift) - 1)) == (1u << (shift - 1)) && (halfMantissa & 1)) ) {
+        halfMantissa++;
+      }
+      this->value = sign | halfMantissa;
+    }
+  } else {
+    uint32_t halfValue = (static_cast<uint32_t>(exponent) << 10) | (mantissa >> 13);
+
+    if ( (mantissa & 0x1FFF) > 0x1000 || ((mantissa & 0x1FFF) == 0x1000 && (halfValue & 1)) ) {
+      // The carry can propagate into the exponent, up to infinity
+      halfValue++;
+    }
+    this->value = sign | halfValue;
+  }
+}
+
+snrHalf::operator float() const {
+  uint32_t sign = static_cast<uint32_t>(value & 0x8000) << 16;
+  uint32_t exponent = (value >> 10) & 0x1F;
+  uint32_t mantissa = value & 0x3FF;
+  uint32_t bits = 0;
+  float result = 0.0f;
+
+  if ( exponent == 0x1F ) {
+    bits = sign | 0x7F800000 | (mantissa << 13);
+  } else if ( exponent == 0 ) {
+    if ( mantissa == 0 ) {
+      bits = sign;
+    } else {
+      // Subnormal, normalize the mantissa
+      exponent = 127 - 15 + 1;
+      while ( (mantissa & 0x400) == 0 ) {
+        mantissa <<= 1;
+        exponent--;
+      }
+      bits = sign | (exponent << 23) | ((mantissa & 0x3FF) << 13);
+    }
+  } else {
+    bits = sign | ((exponent - 15 + 127) << 23) | (mantissa << 13);
+  }
+  std::memcpy(&result, &bits, sizeof(float));
+  return result;
+}
+
+std::string getSNRInputLoad(const std::string & dataName, const std::string & pointer, const std::string & index) {
+  if ( dataName == "float" ) {
+    return pointer + "[" + index + "]";
+  } else if ( dataName == "half" ) {
+    return "vload_half(" + index + ", " + pointer + ")";
+  }
+  return "convert_float(" + pointer + "[" + index + "])";
+}
+
+std::string getSNRInputLoad(const std::string & dataName, const std::string & pointer, const std::string & index, const unsigned int width) {
+  if ( width == 1 ) {
+    return getSNRInputLoad(dataName, pointer, index);
+  } else if ( dataName == "float" ) {
+    return "vload" + std::to_string(width) + "(0, " + pointer + " + " + index + ")";
+  } else if ( dataName == "half" ) {
+    return "vload_half" + std::to_string(width) + "(0, " + pointer + " + " + index + ")";
+  }
+  return "convert_float" + std::to_string(width) + "(vload" + std::to_string(width) + "(0, " + pointer + " + " + index + "))";
+}
+
+std::string getSNRItemCode(const std::string & code, const std::string & num, const std::string & offset, const std::string & vector, const std::string & component) {
+  std::string item = code;
+  std::string * temp = isa::utils::replace(&item, "<%NUM%>", num);
+
+  if ( offset == "0" ) {
+    std::string empty_s("");
+    temp = isa::utils::replace(temp, " + <%OFFSET%>", empty_s, true);
+  }
+  temp = isa::utils::replace(temp, "<%OFFSET%>", offset, true);
+  temp = isa::utils::replace(temp, "<%VECTOR%>", vector, true);
+  temp = isa::utils::replace(temp, "<%COMPONENT%>", component, true);
+  item = *temp;
+  delete temp;
+  return item;
+}
+
+snrConfTable::snrConfTable() {}
+
+snrConfTable::~snrConfTable() {}
+
+std::pair<std::vector<snrConfTable::entry>::const_iterator, std::vector<snrConfTable::entry>::const_iterator> snrConfTable::getEntries(const std::string & deviceName) const {
+  auto device = std::find(devices.begin(), devices.end(), deviceName);
+
+  if ( device == devices.end() ) {
+    return std::make_pair(entries.end(), entries.end());
+  }
+  unsigned int index = device - devices.begin();
+  return std::make_pair(std::lower_bound(entries.begin(), entries.end(), index, [](const entry & item, const unsigned int value) {
+    return item.device < value;
+  }), std::upper_bound(entries.begin(), entries.end(), index, [](const unsigned int value, const entry & item) {
+    return value < item.device;
+  }));
+}
+
+void snrConfTable::insert(const std::string & deviceName, const unsigned int nrDMs, const unsigned int nrSamples, const snrConf & conf) {
+  entry item = {getDevice(deviceName), nrDMs, nrSamples, conf};
+  auto position = std::lower_bound(entries.begin(), entries.end(), item, [](const entry & first, const entry & second) {
+    return std::make_tuple(first.device, first.nrDMs, first.nrSamples) < std::make_tuple(second.device, second.nrDMs, second.nrSamples);
+  });
+
+  if ( position != entries.end() && position->device == item.device && position->nrDMs == nrDMs && position->nrSamples == nrSamples ) {
+    position->conf = conf;
+  } else {
+    entries.insert(position, item);
+  }
+}
+
+bool snrConfTable::contains(const std::string & deviceName, const unsigned int nrDMs, const unsigned int nrSamples) const {
+  auto range = getEntries(deviceName);
+  auto position = std::lower_bound(range.first, range.second, std::make_pair(nrDMs, nrSamples), [](const entry & item, const std::pair<unsigned int, unsigned int> & value) {
+    return std::make_pair(item.nrDMs, item.nrSamples) < value;
+  });
+
+  return position != range.second && position->nrDMs == nrDMs && position->nrSamples == nrSamples;
+}
+
+const snrConf & snrConfTable::getConf(const std::string & deviceName, const bool DMsSamples, const unsigned int nrDMs, const unsigned int nrSamples) const {
+  auto range = getEntries(deviceName);
+  auto position = std::lower_bound(range.first, range.second, std::make_pair(nrDMs, nrSamples), [](const entry & item, const std::pair<unsigned int, unsigned int> & value) {
+    return std::make_pair(item.nrDMs, item.nrSamples) < value;
+  });
+  double bestDistance = std::numeric_limits<double>::max();
+  std::vector<entry>::const_iterator best = range.second;
+
+  if ( range.first == range.second ) {
+    throw std::out_of_range("No tuned SNR configurations for " + deviceName);
+  }
+  if ( position != range.second && position->nrDMs == nrDMs && position->nrSamples == nrSamples && isValidSNRConf(position->conf, DMsSamples != (position->conf.getTransposeTile() > 0), nrDMs, nrSamples) ) {
+    return position->conf;
+  }
+  // Untuned shape, or tuned for the other layout
+  for ( auto item = range.first; item != range.second; ++item ) {
+    double distance = std::abs(std::log2(static_cast<double>(item->nrDMs) / std::max(nrDMs, 1u))) + std::abs(std::log2(static_cast<double>(item->nrSamples) / std::max(nrSamples, 1u)));
+
+    if ( distance < bestDistance && isValidSNRConf(item->conf, DMsSamples != (item->conf.getTransposeTile() > 0), nrDMs, nrSamples) ) {
+      bestDistance = distance;
+      best = item;
+    }
+  }
+  if ( best == range.second ) {
+    throw std::out_of_range("No valid tuned SNR configuration for " + deviceName + " " + std::to_string(nrDMs) + " " + std::to_string(nrSamples));
+  }
+  return best->conf;
+}
+
+void snrConfTable::read(const std::string & filename) {
+  std::ifstream file(filename, std::ios::binary);
+  std::string content;
+
+  if ( !file ) {
+    throw AstroData::FileError("Impossible to open " + filename);
+  }
+  content.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+  file.close();
+  // Parse in place: device nrDMs nrSamples subband threadsD0 threadsD1 threadsD2 itemsD0 itemsD1 itemsD2 [subgroup [slices [vector [transpose]]]]
+  for ( const char * line = content.c_str(); *line != '\0'; ) {
+    const char * end = std::strchr(line, '\n');
+    const char * field = line;
+    char * next = 0;
+    unsigned int values[9];
+    unsigned int optional[4] = {0, 1, 1, 0};
+    snrConf conf;
+
+    if ( end == 0 ) {
+      end = line + std::strlen(line);
+    }
+    if ( !std::isalpha(static_cast<unsigned char>(*line)) ) {
+      line = (*end == '\0') ? end : end + 1;
+      continue;
+    }
+    while ( field < end && *field != ' ' ) {
+      field++;
+    }
+    std::string deviceName(line, field);
+    for ( unsigned int value = 0; value < 9; value++ ) {
+      values[value] = std::strtoul(field, &next, 10);
+      if ( next == field || next > end ) {
+        throw AstroData::FileError("Malformed line in " + filename + ": " + std::string(line, end));
+      }
+      field = next;
+    }
+    // The fields added later are missing in older files
+    for ( unsigned int value = 0; value < 4; value++ ) {
+      unsigned int item = std::strtoul(field, &next, 10);
+
+      if ( next == field || next > end ) {
+        break;
+      }
+      optional[value] = item;
+      field = next;
+    }
+    conf.setSubbandDedispersion(values[2] != 0);
+    conf.setSubgroupReduction(optional[0] != 0);
+    conf.setNrSlices(std::max(optional[1], 1u));
+    conf.setVectorWidth(std::max(optional[2], 1u));
+    conf.setTransposeTile(optional[3]);
+    conf.setNrThreadsD0(values[3]);
+    conf.setNrThreadsD1(values[4]);
+    conf.setNrThreadsD2(values[5]);
+    conf.setNrItemsD0(values[6]);
+    conf.setNrItemsD1(values[7]);
+    conf.setNrItemsD2(values[8]);
+    entries.push_back({getDevice(deviceName), values[0], values[1], conf});
+    line = (*end == '\0') ? end : end + 1;
+  }
+  sort();
+}
+
+void snrConfTable::readBinary(const std::string & filename) {
+  std::ifstream file(filename, std::ios::binary);
+  char magic[4];
+  uint32_t header[3];
+  uint64_t fileSize = 0;
+  std::vector<std::string> deviceNames;
+  std::vector<uint32_t> values;
+
+  if ( !file ) {
+    throw AstroData::FileError("Impossible to open " + filename);
+  }
+  file.seekg(0, std::ios::end);
+  fileSize = file.tellg();
+  file.seekg(0, std::ios::beg);
+  // Header: "SNRT", version, number of devices, number of entries
+  file.read(magic, 4);
+  file.read(reinterpret_cast<char *>(header), sizeof(header));
+  if ( !file || std::strncmp(magic, "SNRT", 4) != 0 ) {
+    throw AstroData::FileError("Not a tuned SNR configuration file: " + filename);
+  } else if ( header[0] != binaryVersion ) {
+    throw AstroData::FileError("Unsupported version " + std::to_string(header[0]) + " of tuned SNR configuration file " + filename + ", convert its text file again");
+  }
+  // Every device takes at least the length of its name, and every entry binaryEntrySize values
+  if ( (4 + sizeof(header) + (header[1] * static_cast<uint64_t>(sizeof(uint32_t))) + (header[2] * static_cast<uint64_t>(binaryEntrySize * sizeof(uint32_t)))) > fileSize ) {
+    throw AstroData::FileError("Truncated tuned SNR configuration file: " + filename);
+  }
+  for ( uint32_t device = 0; device < header[1]; device++ ) {
+    uint32_t length = 0;
+    std::string deviceName;
+
+    file.read(reinterpret_cast<char *>(&length), sizeof(uint32_t));
+    if ( !file || length > maxDeviceNameLength ) {
+      throw AstroData::FileError("Malformed tuned SNR configuration file: " + filename);
+    }
+    deviceName.resize(length);
+    file.read(&deviceName[0], length);
+    if ( !file ) {
+      throw AstroData::FileError("Truncated tuned SNR configuration file: " + filename);
+    }
+    deviceNames.push_back(deviceName);
+  }
+  values.resize(header[2] * static_cast<uint64_t>(binaryEntrySize));
+  file.read(reinterpret_cast<char *>(values.data()), values.size() * sizeof(uint32_t));
+  if ( !file ) {
+    throw AstroData::FileError("Truncated tuned SNR configuration file: " + filename);
+  }
+  file.close();
+  // The table is modified only when the whole file is valid
+  for ( uint32_t item = 0; item < header[2]; item++ ) {
+    if ( values[item * binaryEntrySize] >= deviceNames.size() ) {
+      throw AstroData::FileError("Malformed tuned SNR configuration file: " + filename);
+    }
+  }
+  for ( uint32_t item = 0; item < header[2]; item++ ) {
+    const uint32_t * value = &(values[item * binaryEntrySize]);
+    snrConf conf;
+
+    conf.setSubbandDedispersion((value[3] & 1) != 0);
+    conf.setSubgroupReduction((value[3] & 2) != 0);
+    conf.setNrThreadsD0(value[4]);
+    conf.setNrThreadsD1(value[5]);
+    conf.setNrThreadsD2(value[6]);
+    conf.setNrItemsD0(value[7]);
+    conf.setNrItemsD1(value[8]);
+    conf.setNrItemsD2(value[9]);
+    conf.setNrSlices(std::max(value[10], 1u));
+    conf.setVectorWidth(std::max(value[11], 1u));
+    conf.setTransposeTile(value[12]);
+    entries.push_back({getDevice(deviceNames[value[0]]), value[1], value[2], conf});
+  }
+  sort();
+}
+
+void snrConfTable::writeBinary(const std::string & filename) const {
+  std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+  uint32_t header[3] = {binaryVersion, static_cast<uint32_t>(devices.size()), static_cast<uint32_t>(entries.size())};
+
+  if ( !file ) {
+    throw AstroData::FileError("Impossible to open " + filename);
+  }
+  file.write("SNRT", 4);
+  file.write(reinterpret_cast<const char *>(header), sizeof(header));
+  for ( auto device = devices.begin(); device != devices.end(); ++device ) {
+    uint32_t length = device->size();
+
+    file.write(reinterpret_cast<const char *>(&length), sizeof(uint32_t));
+    file.write(device->data(), length);
+  }
+  for ( auto item = entries.begin(); item != entries.end(); ++item ) {
+    uint32_t values[binaryEntrySize] = {item->device, item->nrDMs, item->nrSamples, static_cast<uint32_t>(item->conf.getSubbandDedispersion()) | (static_cast<uint32_t>(item->conf.getSubgroupReduction()) << 1), item->conf.getNrThreadsD0(), item->conf.getNrThreadsD1(), item->conf.getNrThreadsD2(), item->conf.getNrItemsD0(), item->conf.getNrItemsD1(), item->conf.getNrItemsD2(), item->conf.getNrSlices(), item->conf.getVectorWidth(), item->conf.getTransposeTile()};
+
+    file.write(reinterpret_cast<const char *>(values), sizeof(values));
+  }
+  file.close();
+  if ( !file ) {
+    throw AstroData::FileError("Impossible to write " + filename);
+  }
+}
+
+unsigned int snrConfTable::getDevice(const std::string & deviceName) {
+  auto device = std::find(devices.begin(), devices.end(), deviceName);
+
+  if ( device != devices.end() ) {
+    return device - devices.begin();
+  }
+  devices.push_back(deviceName);
+  return devices.size() - 1;
+}
+
+void snrConfTable::sort() {
+  // Stable, so that the last of the entries with the same key is kept
+  std::stable_sort(entries.begin(), entries.end(), [](const entry & first, const entry & second) {
+    return std::make_tuple(first.device, first.nrDMs, first.nrSamples) < std::make_tuple(second.device, second.nrDMs, second.nrSamples);
+  });
+  std::vector<entry> unique;
+  for ( auto item = entries.begin(); item != entries.end(); ++item ) {
+    if ( !unique.empty() && unique.back().device == item->device && unique.back().nrDMs == item->nrDMs && unique.back().nrSamples == item->nrSamples ) {
+      unique.back() = *item;
+    } else {
+      unique.push_back(*item);
+    }
+  }
+  entries.swap(unique);
+}
+
+std::string * getSNRTopKOpenCL(const snrConf & conf, const AstroData::Observation & observation, const unsigned int nrCandidates, const unsigned int padding) {
+  unsigned int nrDMs = 0;
+  std::string * code = new std::string();
+
+  if ( conf.getSubbandDedispersion() ) {
+    nrDMs = observation.getNrDMs(true) * observation.getNrDMs();
+  } else {
+    nrDMs = observation.getNrDMs();
+  }
+  // Candidates are selected in order of decreasing SNR, ties are broken by lower DM
+  *code = "__kernel void snrTopK" + std::to_string(nrCandidates) + "(__global const float * const restrict snrs, __global const unsigned int * const restrict samples, __global unsigned int * const restrict candidates) {\n"
+    "unsigned int beam = get_group_id(1);\n"
+    "float previousSNR = INFINITY;\n"
+    "unsigned int previousDM = 0xFFFFFFFF;\n"
+    "__local float reductionSNR[" + std::to_string(isa::utils::pad(conf.getNrThreadsD0(), padding / sizeof(float))) + "];\n"
+    "__local unsigned int reductionDM[" + std::to_string(isa::utils::pad(conf.getNrThreadsD0(), padding / sizeof(unsigned int))) + "];\n"
+    "\n"
+    "for ( unsigned int candidate = 0; candidate < " + std::to_string(nrCandidates) + "; candidate++ ) {\n"
+    "float bestSNR = -INFINITY;\n"
+    "unsigned int bestDM = 0xFFFFFFFF;\n"
+    "// Selection phase\n"
+    "for ( unsigned int dm = get_local_id(0); dm < " + std::to_string(nrDMs) + "; dm += " + std::to_string(conf.getNrThreadsD0()) + " ) {\n"
+    "float snr = snrs[(beam * " + std::to_string(isa::utils::pad(nrDMs, padding / sizeof(float))) + ") + dm];\n"
+    "if ( ((snr < previousSNR) || ((snr == previousSNR) && (dm > previousDM))) && ((snr > bestSNR) || ((snr == bestSNR) && (dm < bestDM))) ) {\n"
+    "bestSNR = snr;\n"
+    "bestDM = dm;\n"
+    "}\n"
+    "}\n"
+    "reductionSNR[get_local_id(0)] = bestSNR;\n"
+    "reductionDM[get_local_id(0)] = bestDM;\n"
+    "barrier(CLK_LOCAL_MEM_FENCE);\n"
+    "// Reduce phase\n"
+    "unsigned int threshold = " + std::to_string(conf.getNrThreadsD0() / 2) + ";\n"
+    "for ( unsigned int item = get_local_id(0); threshold > 0; threshold /= 2 ) {\n"
+    "if ( item < threshold ) {\n"
+    "if ( (reductionSNR[item + threshold] > bestSNR) || ((reductionSNR[item + threshold] == bestSNR) && (reductionDM[item + threshold] < bestDM)) ) {\n"
+    "bestSNR = reductionSNR[item + threshold];\n"
+    "bestDM = reductionDM[item + threshold];\n"
+    "}\n"
+    "reductionSNR[item] = bestSNR;\n"
+    "reductionDM[item] = bestDM;\n"
+    "}\n"
+    "barrier(CLK_LOCAL_MEM_FENCE);\n"
+    "}\n"
+    "previousSNR = reductionSNR[0];\n"
+    "previousDM = reductionDM[0];\n"
+    "// Store\n"
+    "if ( get_local_id(0) == 0 ) {\n"
+    "candidates[(((beam * " + std::to_string(nrCandidates) + ") + candidate) * 4)] = beam;\n"
+    "candidates[(((beam * " + std::to_string(nrCandidates) + ") + candidate) * 4) + 1] = previousDM;\n"
+    "candidates[(((beam * " + std::to_string(nrCandidates) + ") + candidate) * 4) + 2] = (previousDM < " + std::to_string(nrDMs) + ") ? samples[(beam * " + std::to_string(isa::utils::pad(nrDMs, padding / sizeof(unsigned int))) + ") + previousDM] : 0;\n"
+    "candidates[(((beam * " + std::to_string(nrCandidates) + ") + candidate) * 4) + 3] = as_uint(previousSNR);\n"
+    "}\n"
+    "barrier(CLK_LOCAL_MEM_FENCE);\n"
+    "}\n"
+    "}\n";
+
+  return code;
+}
+
+std::string * getSNRSamplesDMsMergeOpenCL(const snrConf & conf, const AstroData::Observation & observation, const unsigned int nrSamples, const unsigned int padding) {
+  unsigned int nrDMs = 0;
+  std::string * code = new std::string();
+
+  if ( conf.getSubbandDedispersion() ) {
+    nrDMs = observation.getNrDMs(true) * observation.getNrDMs();
+  } else {
+    nrDMs = observation.getNrDMs();
+  }
+  // Begin kernel's template
+  *code = "__kernel void snrSamplesDMsMerge" + std::to_string(nrDMs) + "(__global const float4 * const restrict partials, __global const unsigned int * const restrict partialSamples, __global float * const restrict outputSNR, __global unsigned int * const restrict outputSample) {\n"
+    "unsigned int dm = (get_group_id(0) * " + std::to_string(conf.getNrThreadsD0() * conf.getNrItemsD0()) + ") + get_local_id(0);\n"
+    "unsigned int beam = get_group_id(1);\n"
+    "float delta = 0.0f;\n"
+    "float4 partial = (float4)(0.0f, 0.0f, 0.0f, 0.0f);\n"
+    "<%DEF%>"
+    "\n"
+    "// The slices are merged in order, so that the first of equal maxima is kept\n"
+    "for ( unsigned int slice = 1; slice < " + std::to_string(conf.getNrSlices()) + "; slice++ ) {\n"
+    "<%COMPUTE%>"
+    "}\n"
+    "<%STORE%>"
+    "}\n";
+  std::string def_sTemplate = "float4 statistics<%NUM%> = partials[(beam * " + std::to_string(conf.getNrSlices() * nrDMs) + ") + dm + <%OFFSET%>];\n"
+    "unsigned int maxSample<%NUM%> = partialSamples[(beam * " + std::to_string(conf.getNrSlices() * nrDMs) + ") + dm + <%OFFSET%>];\n";
+  std::string compute_sTemplate = "partial = partials[(((beam * " + std::to_string(conf.getNrSlices()) + ") + slice) * " + std::to_string(nrDMs) + ") + dm + <%OFFSET%>];\n"
+    "delta = partial.y - statistics<%NUM%>.y;\n"
+    "statistics<%NUM%>.x += partial.x;\n"
+    "statistics<%NUM%>.y = (((statistics<%NUM%>.x - partial.x) * statistics<%NUM%>.y) + (partial.x * partial.y)) / statistics<%NUM%>.x;\n"
+    "statistics<%NUM%>.z += partial.z + ((delta * delta) * (((statistics<%NUM%>.x - partial.x) * partial.x) / statistics<%NUM%>.x));\n"
+    "if ( partial.w > statistics<%NUM%>.w ) {\n"
+    "statistics<%NUM%>.w = partial.w;\n"
+    "maxSample<%NUM%> = partialSamples[(((beam * " + std::to_string(conf.getNrSlices()) + ") + slice) * " + std::to_string(nrDMs) + ") + dm + <%OFFSET%>];\n"
+    "}\n";
+  std::string store_sTemplate = "outputSNR[(beam * " + std::to_string(isa::utils::pad(nrDMs, padding / sizeof(float))) + ") + dm + <%OFFSET%>] = (statistics<%NUM%>.w - statistics<%NUM%>.y) / native_sqrt(statistics<%NUM%>.z * " + std::to_string(1.0f / (nrSamples - 1)) + "f);\n"
+    "outputSample[(beam * " + std::to_string(isa::utils::pad(nrDMs, padding / sizeof(unsigned int))) + ") + dm + <%OFFSET%>] = maxSample<%NUM%>;\n";
+  // End kernel's template
+
+  std::string * def_s = new std::string();
+  std::string * compute_s = new std::string();
+  std::string * store_s = new std::string();
+
+  for ( unsigned int dm = 0; dm < conf.getNrItemsD0(); dm++ ) {
+    std::string dm_s = std::to_string(dm);
+    std::string offset_s = std::to_string(conf.getNrThreadsD0() * dm);
+    std::string * temp = 0;
+
+    temp = isa::utils::replace(&def_sTemplate, "<%NUM%>", dm_s);
+    if ( dm == 0 ) {
+      std::string empty_s("");
+      temp = isa::utils::replace(temp, " + <%OFFSET%>", empty_s, true);
+    } else {
+      temp = isa::utils::replace(temp, "<%OFFSET%>", offset_s, true);
+    }
+    def_s->append(*temp);
+    delete temp;
+    temp = isa::utils::replace(&compute_sTemplate, "<%NUM%>", dm_s);
+    if ( dm == 0 ) {
+      std::string empty_s("");
+      temp = isa::utils::replace(temp, " + <%OFFSET%>", empty_s, true);
+    } else {
+      temp = isa::utils::replace(temp, "<%OFFSET%>", offset_s, true);
+    }
+    compute_s->append(*temp);
+    delete temp;
+    temp = isa::utils::replace(&store_sTemplate, "<%NUM%>", dm_s);
+    if ( dm == 0 ) {
+      std::string empty_s("");
+      temp = isa::utils::replace(temp, " + <%OFFSET%>", empty_s, true);
+    } else {
+      temp = isa::utils::replace(temp, "<%OFFSET%>", offset_s, true);
+    }
+    store_s->append(*temp);
+    delete temp;
+  }
+  code = isa::utils::replace(code, "<%DEF%>", *def_s, true);
+  code = isa::utils::replace(code, "<%COMPUTE%>", *compute_s, true);
+  code = isa::utils::replace(code, "<%STORE%>", *store_s, true);
+  delete def_s;
+  delete compute_s;
+  delete store_s;
+
+  return code;
+}
+
+std::string * getBandwidthOpenCL(const unsigned int nrItemsPerThread) {
+  std::string * code = new std::string();
+
+  *code = "__kernel void bandwidthCopy(__global const float4 * const restrict input, __global float4 * const restrict output) {\n"
+    "output[get_global_id(0)] = input[get_global_id(0)];\n"
+    "}\n"
+    "__kernel void bandwidthRead(__global const float4 * const restrict input, __global float4 * const restrict output) {\n"
+    "float4 sum = (float4)(0.0f);\n"
+    "\n"
+    "for ( unsigned int item = 0; item < " + std::to_string(nrItemsPerThread) + "; item++ ) {\n"
+    "sum += input[(item * get_global_size(0)) + get_global_id(0)];\n"
+    "}\n"
+    "// The store is never executed with finite input, but the compiler cannot remove the loads\n"
+    "if ( isnan(sum.x + sum.y + sum.z + sum.w) ) {\n"
+    "output[get_global_id(0)] = sum;\n"
+    "}\n"
+    "}\n";
+
+  return code;
+}
+
+float getTimeSeriesValue(const uint64_t key) {
+  uint32_t value = static_cast< uint32_t >(key >> 32);
+  float snr = 0.0f;
+
+  if ( value & 0x80000000 ) {
+    value &= 0x7FFFFFFF;
+  } else {
+    value = ~value;
+  }
+  std::memcpy(&snr, &value, sizeof(float));
+  return snr;
+}
+
+unsigned int getTimeSeriesDM(const uint64_t key) {
+  return 0xFFFFFFFF - static_cast< uint32_t >(key & 0xFFFFFFFF);
+}
+
+float getBestSNR(const uint64_t key) {
+  return getTimeSeriesValue(key);
+}
+
+unsigned int getBestDM(const uint64_t key, const unsigned int nrSamples) {
+  return getTimeSeriesDM(key) / nrSamples;
+}
+
+unsigned int getBestSample(const uint64_t key, const unsigned int nrSamples) {
+  return getTimeSeriesDM(key) % nrSamples;
 }
 
 void readTunedSNRConf(tunedSNRConf & tunedSNR, const std::string & snrFilename) {
@@ -73,7 +647,23 @@ void readTunedSNRConf(tunedSNRConf & tunedSNR, const std::string & snrFilename)
     splitPoint = temp.find(" ");
     parameters->setNrItemsD1(isa::utils::castToType< std::string, unsigned int >(temp.substr(0, splitPoint)));
     temp = temp.substr(splitPoint + 1);
-    parameters->setNrItemsD2(isa::utils::castToType< std::string, unsigned int >(temp));
+    parameters->setNrItemsD2(isa::utils::castToType< std::string, unsigned int >(temp.substr(0, temp.find(" "))));
+    if ( temp.find(" ") != std::string::npos ) {
+      temp = temp.substr(temp.find(" ") + 1);
+      parameters->setSubgroupReduction(isa::utils::castToType< std::string, bool >(temp.substr(0, temp.find(" "))));
+    }
+    if ( temp.find(" ") != std::string::npos ) {
+      temp = temp.substr(temp.find(" ") + 1);
+      parameters->setNrSlices(std::max(isa::utils::castToType< std::string, unsigned int >(temp.substr(0, temp.find(" "))), 1u));
+    }
+    if ( temp.find(" ") != std::string::npos ) {
+      temp = temp.substr(temp.find(" ") + 1);
+      parameters->setVectorWidth(std::max(isa::utils::castToType< std::string, unsigned int >(temp.substr(0, temp.find(" "))), 1u));
+    }
+    if ( temp.find(" ") != std::string::npos ) {
+      temp = temp.substr(temp.find(" ") + 1);
+      parameters->setTransposeTile(isa::utils::castToType< std::string, unsigned int >(temp));
+    }
 
     if ( tunedSNR.count(deviceName) == 0 ) {
       std::map< unsigned int, std::map< unsigned int, SNR::snrConf * > * > * externalContainer = new std::map< unsigned int, std::map< unsigned int, SNR::snrConf * > * >();
@@ -94,5 +684,43 @@ void readTunedSNRConf(tunedSNRConf & tunedSNR, const std::string & snrFilename)
   snrFile.close();
 }
 
+void readTunedSNRConf(snrConfTable & tunedSNR, const std::string & snrFilename) {
+  std::ifstream file(snrFilename, std::ios::binary);
+  char magic[4] = {0, 0, 0, 0};
+
+  file.read(magic, 4);
+  file.close();
+  if ( std::strncmp(magic, "SNRT", 4) == 0 ) {
+    tunedSNR.readBinary(snrFilename);
+  } else {
+    tunedSNR.read(snrFilename);
+  }
+}
+
+std::string getSNRBuildFlags(const snrConf & conf) {
+  if ( conf.getSubgroupReduction() ) {
+    return "-cl-mad-enable -Werror -cl-std=CL2.0";
+  }
+  return "-cl-mad-enable -Werror";
+}
+
+bool isSupportedSNRConf(const snrConf & conf, const cl::Device & device) {
+  if ( conf.getSubgroupReduction() ) {
+    return device.getInfo<CL_DEVICE_EXTENSIONS>().find("cl_khr_subgroups") != std::string::npos;
+  }
+  return true;
+}
+
+bool isValidSNRConf(const snrConf & conf, const bool DMsSamples, const unsigned int nrDMs, const unsigned int nrSamples) {
+  if ( conf.getNrThreadsD0() == 0 || conf.getNrItemsD0() == 0 || conf.getNrThreadsD1() == 0 || conf.getNrItemsD1() == 0 ) {
+    return false;
+  } else if ( (conf.getNrItemsD0() % conf.getVectorWidth()) != 0 || (conf.getTransposeTile() > 0 && conf.getNrSlices() > 1) ) {
+    return false;
+  } else if ( DMsSamples ) {
+    return (nrSamples % conf.getNrItemsD0()) == 0 && (nrSamples % conf.getVectorWidth()) == 0 && (nrDMs % (conf.getNrThreadsD1() * conf.getNrItemsD1())) == 0 && conf.getNrSlices() == 1;
+  }
+  return (nrDMs % (conf.getNrThreadsD0() * conf.getNrItemsD0())) == 0 && conf.getNrSlices() <= nrSamples && !conf.getSubgroupReduction() && conf.getNrThreadsD1() == 1 && conf.getNrItemsD1() == 1;
+}
+
 } // SNR
 
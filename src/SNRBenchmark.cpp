@@ -0,0 +1,616 @@
+// Copyright 2017 Netherlands Institute for Radio Astronomy (ASTRON)
+// Copyright 2017 Netherlands eScience Center
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <exception>
+#include <iomanip>
+#include <algorithm>
+#include <cstdlib>
+#include <cstdint>
+
+#include <configuration.hpp>
+
+#include <ArgumentList.hpp>
+#include <Observation.hpp>
+#include <InitializeOpenCL.hpp>
+#include <Kernel.hpp>
+#include <utils.hpp>
+#include <Timer.hpp>
+#include <SNR.hpp>
+#include <SNRCPU.hpp>
+#include <SNRProfile.hpp>
+
+
+// Input shape of a benchmark; with subbanding nrDMs is the number of DMs per subbanding DM step
+struct scenario {
+  std::string name;
+  bool DMsSamples;
+  bool subband;
+  unsigned int nrBeams;
+  unsigned int nrSubbandingDMs;
+  unsigned int nrDMs;
+  unsigned int nrSamples;
+};
+
+// Presets: the same small, medium and large shapes in both layouts, with and without subbanding
+const std::vector< scenario > presets = {
+  {"small_dms_samples", true, false, 1, 1, 256, 1024},
+  {"small_dms_samples_subband", true, true, 1, 32, 8, 1024},
+  {"small_samples_dms", false, false, 1, 1, 256, 1024},
+  {"small_samples_dms_subband", false, true, 1, 32, 8, 1024},
+  {"medium_dms_samples", true, false, 12, 1, 1024, 2048},
+  {"medium_dms_samples_subband", true, true, 12, 32, 32, 2048},
+  {"medium_samples_dms", false, false, 12, 1, 1024, 2048},
+  {"medium_samples_dms_subband", false, true, 12, 32, 32, 2048},
+  {"large_dms_samples", true, false, 12, 1, 2048, 4096},
+  {"large_dms_samples_subband", true, true, 12, 32, 64, 4096},
+  {"large_samples_dms", false, false, 12, 1, 2048, 4096},
+  {"large_samples_dms_subband", false, true, 12, 32, 64, 4096}
+};
+
+// Check the constraints of the dense kernels on the shape and on the device
+bool isValid(const SNR::snrConf & conf, const bool DMsSamples, const unsigned int nrDMs, const unsigned int nrSamples, const size_t maxWorkGroupSize);
+// Input in the layout of the scenario, reproducible between runs; every DM has one maximum
+void generateInput(const scenario & shape, const AstroData::Observation & observation, const unsigned int padding, std::vector< inputDataType > & input);
+// Kernel time of every scenario in a JSON file written by SNRBenchmark
+std::map< std::string, double > readBaseline(const std::string & filename);
+// Content of a JSON string, with quotes, backslashes and control characters escaped
+std::string escapeJSON(const std::string & value);
+
+int main(int argc, char * argv[]) {
+  bool tunedMode = false;
+  bool regression = false;
+  unsigned int padding = 0;
+  unsigned int nrIterations = 0;
+  unsigned int clPlatformID = 0;
+  unsigned int clDeviceID = 0;
+  float tolerance = 0.0f;
+  std::string deviceName;
+  std::string outputFilename;
+  std::string baselineFilename;
+  std::vector< scenario > scenarios;
+  std::map< std::string, double > baseline;
+  SNR::snrConf givenConf;
+  SNR::snrConfTable tunedConf;
+
+  try {
+    isa::utils::ArgumentList args(argc, argv);
+    if ( args.getSwitch("-list") ) {
+      for ( auto preset = presets.begin(); preset != presets.end(); ++preset ) {
+        std::cout << preset->name << ": beams " << preset->nrBeams << ", DMs " << preset->nrSubbandingDMs * preset->nrDMs << ", samples " << preset->nrSamples << std::endl;
+      }
+      return 0;
+    }
+    std::string scenarios_s = args.getSwitchArgument< std::string >("-scenarios");
+    std::string::size_type splitPoint = 0;
+    std::vector< std::string > names;
+
+    while ( (splitPoint = scenarios_s.find(",")) != std::string::npos ) {
+      names.push_back(scenarios_s.substr(0, splitPoint));
+      scenarios_s = scenarios_s.substr(splitPoint + 1);
+    }
+    names.push_back(scenarios_s);
+    for ( auto name = names.begin(); name != names.end(); ++name ) {
+      auto preset = std::find_if(presets.begin(), presets.end(), [&name](const scenario & item) { return item.name == *name; });
+
+      if ( *name == "all" ) {
+        scenarios.insert(scenarios.end(), presets.begin(), presets.end());
+      } else if ( preset == presets.end() ) {
+        std::cerr << "Unknown scenario: " << *name << "." << std::endl;
+        return 1;
+      } else {
+        scenarios.push_back(*preset);
+      }
+    }
+    nrIterations = args.getSwitchArgument< unsigned int >("-iterations");
+    clPlatformID = args.getSwitchArgument< unsigned int >("-opencl_platform");
+    clDeviceID = args.getSwitchArgument< unsigned int >("-opencl_device");
+    padding = args.getSwitchArgument< unsigned int >("-padding");
+    tunedMode = args.getSwitch("-tuned");
+    if ( tunedMode ) {
+      SNR::readTunedSNRConf(tunedConf, args.getSwitchArgument< std::string >("-tuned_file"));
+      deviceName = args.getSwitchArgument< std::string >("-device_name");
+    } else {
+      givenConf.setNrThreadsD0(args.getSwitchArgument< unsigned int >("-threadsD0"));
+      givenConf.setNrItemsD0(args.getSwitchArgument< unsigned int >("-itemsD0"));
+    }
+    outputFilename = args.getSwitchArgument< std::string >("-output");
+    if ( args.getSwitch("-baseline") ) {
+      baselineFilename = args.getSwitchArgument< std::string >("-baseline_file");
+      tolerance = args.getSwitchArgument< float >("-tolerance");
+      baseline = readBaseline(baselineFilename);
+    }
+    if ( nrIterations == 0 ) {
+      std::cerr << "-iterations must be larger than zero." << std::endl;
+      return 1;
+    }
+  } catch ( isa::utils::EmptyCommandLine & err ) {
+    std::cerr << argv[0] << " [-list] -scenarios ... (comma separated list, or all) -iterations ... -opencl_platform ... -opencl_device ... -padding ... [-tuned | -threadsD0 ... -itemsD0 ...] -output ... [-baseline]" << std::endl;
+    std::cerr << "\t -tuned : -tuned_file ... -device_name ..." << std::endl;
+    std::cerr << "\t -baseline : -baseline_file ... -tolerance ... (fraction of the baseline time)" << std::endl;
+    return 1;
+  } catch ( std::exception & err ) {
+    std::cerr << err.what() << std::endl;
+    return 1;
+  }
+
+  // Initialize OpenCL, with a profiling queue
+  cl::Context clContext;
+  std::vector< cl::Platform > * clPlatforms = new std::vector< cl::Platform >();
+  std::vector< cl::Device > * clDevices = new std::vector< cl::Device >();
+  std::vector< std::vector< cl::CommandQueue > > * clQueues = new std::vector< std::vector< cl::CommandQueue > >();
+  cl_device_type deviceType = 0;
+  size_t maxWorkGroupSize = 0;
+
+  isa::OpenCL::initializeOpenCL(clPlatformID, 1, clPlatforms, &clContext, clDevices, clQueues);
+  clQueues->at(clDeviceID)[0] = cl::CommandQueue(clContext, clDevices->at(clDeviceID), CL_QUEUE_PROFILING_ENABLE);
+  clDevices->at(clDeviceID).getInfo(CL_DEVICE_TYPE, &deviceType);
+  clDevices->at(clDeviceID).getInfo(CL_DEVICE_MAX_WORK_GROUP_SIZE, &maxWorkGroupSize);
+
+  std::stringstream json;
+  unsigned int nrFailed = 0;
+  unsigned int nrRegressions = 0;
+
+  json << "{\"device\": \"" << escapeJSON(clDevices->at(clDeviceID).getInfo< CL_DEVICE_NAME >()) << "\", \"device_type\": \"" << ((deviceType & CL_DEVICE_TYPE_CPU) ? "CPU" : ((deviceType & CL_DEVICE_TYPE_GPU) ? "GPU" : "other")) << "\", ";
+  json << "\"driver\": \"" << escapeJSON(clDevices->at(clDeviceID).getInfo< CL_DRIVER_VERSION >()) << "\", \"input_type\": \"" << inputDataName << "\", \"padding\": " << padding << ", \"iterations\": " << nrIterations << ", ";
+  if ( !baselineFilename.empty() ) {
+    json << "\"baseline\": \"" << escapeJSON(baselineFilename) << "\", \"tolerance\": " << tolerance << ", ";
+  }
+  json << "\"scenarios\": [" << std::endl;
+  for ( auto shape = scenarios.begin(); shape != scenarios.end(); ++shape ) {
+    AstroData::Observation observation;
+    SNR::snrConf conf = givenConf;
+    std::string status = "ok";
+    std::vector< inputDataType > input;
+    std::vector< float > outputSNR, referenceSNR;
+    std::vector< unsigned int > outputSample, referenceSample;
+    cl::Kernel * kernel = 0;
+    cl::Kernel * mergeKernel = 0;
+    cl::Kernel * transposeKernel = 0;
+    cl::Buffer input_d, transposed_d, partials_d, partialSamples_d, outputSNR_d, outputSample_d;
+    cl::Event firstEvent, event;
+    isa::utils::Timer timer;
+    SNR::snrProfile profile;
+
+    observation.setNrSynthesizedBeams(shape->nrBeams);
+    observation.setNrSamplesPerBatch(shape->nrSamples);
+    observation.setDMRange(shape->nrSubbandingDMs, 0.0f, 0.0f, true);
+    observation.setDMRange(shape->nrDMs, 0.0, 0.0);
+    const unsigned int nrDMs = observation.getNrDMs(true) * observation.getNrDMs();
+    // The transpose changes the layout of the kernel, not the one of the input
+    bool layoutDMsSamples = shape->DMsSamples;
+
+    if ( tunedMode ) {
+      try {
+        conf = tunedConf.getConf(deviceName, shape->DMsSamples, nrDMs, shape->nrSamples);
+      } catch ( std::out_of_range & err ) {
+        status = "no_configuration";
+      }
+    }
+    conf.setSubbandDedispersion(shape->subband);
+    layoutDMsSamples = shape->DMsSamples != (conf.getTransposeTile() > 0);
+    if ( status == "ok" && !isValid(conf, layoutDMsSamples, nrDMs, shape->nrSamples, maxWorkGroupSize) ) {
+      status = "invalid_configuration";
+    } else if ( status == "ok" && !SNR::isSupportedSNRConf(conf, clDevices->at(clDeviceID)) ) {
+      status = "unsupported_configuration";
+    }
+
+    // Input and native CPU reference
+    if ( status == "ok" ) {
+      SNR::snrConf referenceConf = conf;
+
+      generateInput(*shape, observation, padding, input);
+      outputSNR.resize(shape->nrBeams * isa::utils::pad(nrDMs, padding / sizeof(float)));
+      outputSample.resize(shape->nrBeams * isa::utils::pad(nrDMs, padding / sizeof(unsigned int)));
+      referenceSNR.resize(outputSNR.size());
+      referenceSample.resize(outputSample.size());
+      referenceConf.setNrThreadsD0(0);
+      referenceConf.setNrItemsD0(1);
+      if ( shape->DMsSamples ) {
+        SNR::snrDMsSamplesCPU< inputDataType >(referenceConf, observation, shape->nrSamples, padding, input, referenceSNR, referenceSample);
+      } else {
+        SNR::snrSamplesDMsCPU< inputDataType >(referenceConf, observation, shape->nrSamples, padding, input, referenceSNR, referenceSample);
+      }
+    }
+
+    // Generate and compile the kernels
+    if ( status == "ok" ) {
+      std::string * code = 0;
+      std::string * mergeCode = 0;
+      std::string * transposeCode = 0;
+
+      if ( layoutDMsSamples ) {
+        code = SNR::getSNRDMsSamplesOpenCL< inputDataType >(conf, inputDataName, observation, shape->nrSamples, padding);
+      } else if ( conf.getNrSlices() > 1 ) {
+        code = SNR::getSNRSamplesDMsSlicedOpenCL< inputDataType >(conf, inputDataName, observation, shape->nrSamples, padding);
+        mergeCode = SNR::getSNRSamplesDMsMergeOpenCL(conf, observation, shape->nrSamples, padding);
+      } else {
+        code = SNR::getSNRSamplesDMsOpenCL< inputDataType >(conf, inputDataName, observation, shape->nrSamples, padding);
+      }
+      if ( conf.getTransposeTile() > 0 ) {
+        transposeCode = SNR::getSNRTransposeOpenCL< inputDataType >(conf, inputDataName, observation, shape->nrSamples, padding, shape->DMsSamples);
+      }
+      try {
+        if ( layoutDMsSamples ) {
+          kernel = isa::OpenCL::compile("snrDMsSamples" + std::to_string(shape->nrSamples), *code, SNR::getSNRBuildFlags(conf), clContext, clDevices->at(clDeviceID));
+        } else if ( mergeCode != 0 ) {
+          kernel = isa::OpenCL::compile("snrSamplesDMsSliced" + std::to_string(nrDMs), *code, "-cl-mad-enable -Werror", clContext, clDevices->at(clDeviceID));
+          mergeKernel = isa::OpenCL::compile("snrSamplesDMsMerge" + std::to_string(nrDMs), *mergeCode, "-cl-mad-enable -Werror", clContext, clDevices->at(clDeviceID));
+        } else {
+          kernel = isa::OpenCL::compile("snrSamplesDMs" + std::to_string(nrDMs), *code, SNR::getSNRBuildFlags(conf), clContext, clDevices->at(clDeviceID));
+        }
+        if ( transposeCode != 0 ) {
+          transposeKernel = isa::OpenCL::compile("snrTranspose" + std::string(shape->DMsSamples ? "DMsSamples" : "SamplesDMs") + std::to_string(shape->nrSamples), *transposeCode, "-cl-mad-enable -Werror", clContext, clDevices->at(clDeviceID));
+        }
+      } catch ( isa::OpenCL::OpenCLError & err ) {
+        std::cerr << err.what() << std::endl;
+        status = "compile_error";
+      }
+      delete code;
+      delete mergeCode;
+      delete transposeCode;
+    }
+
+    // Warm-up run and benchmark runs
+    if ( status == "ok" ) {
+      cl::NDRange global, local, sliceGlobal, sliceLocal, transposeGlobal, transposeLocal;
+
+      if ( layoutDMsSamples ) {
+        global = cl::NDRange(conf.getNrThreadsD0(), nrDMs / conf.getNrItemsD1(), shape->nrBeams);
+        local = cl::NDRange(conf.getNrThreadsD0(), conf.getNrThreadsD1(), 1);
+      } else {
+        global = cl::NDRange(nrDMs / conf.getNrItemsD0(), shape->nrBeams);
+        local = cl::NDRange(conf.getNrThreadsD0(), 1);
+        sliceGlobal = cl::NDRange(nrDMs / conf.getNrItemsD0(), conf.getNrSlices(), shape->nrBeams);
+        sliceLocal = cl::NDRange(conf.getNrThreadsD0(), 1, 1);
+      }
+      if ( conf.getTransposeTile() > 0 && shape->DMsSamples ) {
+        transposeGlobal = cl::NDRange(isa::utils::pad(shape->nrSamples, conf.getTransposeTile()), isa::utils::pad(nrDMs, conf.getTransposeTile()), shape->nrBeams);
+        transposeLocal = cl::NDRange(conf.getTransposeTile(), conf.getTransposeTile(), 1);
+      } else if ( conf.getTransposeTile() > 0 ) {
+        transposeGlobal = cl::NDRange(isa::utils::pad(nrDMs, conf.getTransposeTile()), isa::utils::pad(shape->nrSamples, conf.getTransposeTile()), shape->nrBeams);
+        transposeLocal = cl::NDRange(conf.getTransposeTile(), conf.getTransposeTile(), 1);
+      }
+      try {
+        input_d = cl::Buffer(clContext, CL_MEM_READ_ONLY, input.size() * sizeof(inputDataType), 0, 0);
+        outputSNR_d = cl::Buffer(clContext, CL_MEM_WRITE_ONLY, outputSNR.size() * sizeof(float), 0, 0);
+        outputSample_d = cl::Buffer(clContext, CL_MEM_WRITE_ONLY, outputSample.size() * sizeof(unsigned int), 0, 0);
+        clQueues->at(clDeviceID)[0].enqueueWriteBuffer(input_d, CL_FALSE, 0, input.size() * sizeof(inputDataType), reinterpret_cast< void * >(input.data()));
+        if ( transposeKernel != 0 ) {
+          uint64_t transposedSize = 0;
+
+          if ( shape->DMsSamples ) {
+            transposedSize = shape->nrBeams * static_cast< uint64_t >(shape->nrSamples) * isa::utils::pad(nrDMs, padding / sizeof(inputDataType));
+          } else {
+            transposedSize = shape->nrBeams * static_cast< uint64_t >(nrDMs) * observation.getNrSamplesPerBatch(false, padding / sizeof(inputDataType));
+          }
+          transposed_d = cl::Buffer(clContext, CL_MEM_READ_WRITE, transposedSize * sizeof(inputDataType), 0, 0);
+          transposeKernel->setArg(0, input_d);
+          transposeKernel->setArg(1, transposed_d);
+          kernel->setArg(0, transposed_d);
+        } else {
+          kernel->setArg(0, input_d);
+        }
+        if ( mergeKernel != 0 ) {
+          partials_d = cl::Buffer(clContext, CL_MEM_READ_WRITE, shape->nrBeams * conf.getNrSlices() * static_cast< uint64_t >(nrDMs) * 4 * sizeof(float), 0, 0);
+          partialSamples_d = cl::Buffer(clContext, CL_MEM_READ_WRITE, shape->nrBeams * conf.getNrSlices() * static_cast< uint64_t >(nrDMs) * sizeof(unsigned int), 0, 0);
+          kernel->setArg(1, partials_d);
+          kernel->setArg(2, partialSamples_d);
+          mergeKernel->setArg(0, partials_d);
+          mergeKernel->setArg(1, partialSamples_d);
+          mergeKernel->setArg(2, outputSNR_d);
+          mergeKernel->setArg(3, outputSample_d);
+        } else {
+          kernel->setArg(1, outputSNR_d);
+          kernel->setArg(2, outputSample_d);
+        }
+        clQueues->at(clDeviceID)[0].finish();
+        for ( unsigned int iteration = 0; iteration <= nrIterations; iteration++ ) {
+          // The first run is the warm-up, and is not timed
+          if ( iteration > 0 ) {
+            timer.start();
+          }
+          if ( transposeKernel != 0 ) {
+            clQueues->at(clDeviceID)[0].enqueueNDRangeKernel(*transposeKernel, cl::NullRange, transposeGlobal, transposeLocal, 0, &firstEvent);
+          }
+          if ( mergeKernel != 0 ) {
+            clQueues->at(clDeviceID)[0].enqueueNDRangeKernel(*kernel, cl::NullRange, sliceGlobal, sliceLocal, 0, &firstEvent);
+            clQueues->at(clDeviceID)[0].enqueueNDRangeKernel(*mergeKernel, cl::NullRange, global, local, 0, &event);
+          } else {
+            clQueues->at(clDeviceID)[0].enqueueNDRangeKernel(*kernel, cl::NullRange, global, local, 0, &event);
+          }
+          event.wait();
+          if ( iteration == 0 ) {
+            continue;
+          }
+          timer.stop();
+          if ( transposeKernel != 0 || mergeKernel != 0 ) {
+            profile.addEvent(firstEvent, event);
+          } else {
+            profile.addEvent(event);
+          }
+        }
+        clQueues->at(clDeviceID)[0].enqueueReadBuffer(outputSNR_d, CL_TRUE, 0, outputSNR.size() * sizeof(float), reinterpret_cast< void * >(outputSNR.data()));
+        clQueues->at(clDeviceID)[0].enqueueReadBuffer(outputSample_d, CL_TRUE, 0, outputSample.size() * sizeof(unsigned int), reinterpret_cast< void * >(outputSample.data()));
+      } catch ( cl::Error & err ) {
+        std::cerr << "OpenCL error (" << shape->name << "): " << std::to_string(err.err()) << "." << std::endl;
+        status = "run_error";
+      }
+    }
+    delete kernel;
+    delete mergeKernel;
+    delete transposeKernel;
+
+    // Check the outputs against the native CPU code
+    if ( status == "ok" ) {
+      for ( unsigned int beam = 0; beam < shape->nrBeams; beam++ ) {
+        for ( unsigned int dm = 0; dm < nrDMs; dm++ ) {
+          const uint64_t item = (beam * static_cast< uint64_t >(isa::utils::pad(nrDMs, padding / sizeof(float)))) + dm;
+          const uint64_t sampleItem = (beam * static_cast< uint64_t >(isa::utils::pad(nrDMs, padding / sizeof(unsigned int)))) + dm;
+
+          if ( !isa::utils::same(outputSNR[item], referenceSNR[item], static_cast< float >(1e-2)) || outputSample[sampleItem] != referenceSample[sampleItem] ) {
+            status = "wrong_results";
+          }
+        }
+      }
+    }
+
+    // Record
+    json << "{\"name\": \"" << shape->name << "\", \"layout\": \"" << (shape->DMsSamples ? "dms_samples" : "samples_dms") << "\", \"subband\": " << (shape->subband ? "true" : "false") << ", ";
+    json << "\"beams\": " << shape->nrBeams << ", \"dms\": " << nrDMs << ", \"samples\": " << shape->nrSamples << ", ";
+    json << "\"configuration\": \"" << conf.print() << "\", \"status\": \"" << status << "\"";
+    if ( status == "ok" ) {
+      double gbs = isa::utils::giga((shape->nrBeams * static_cast< uint64_t >(nrDMs) * shape->nrSamples * sizeof(inputDataType)) + (shape->nrBeams * static_cast< uint64_t >(nrDMs) * sizeof(float)) + (shape->nrBeams * static_cast< uint64_t >(nrDMs) * sizeof(unsigned int)));
+      // The median of the kernel times is less sensitive to outliers, the host time is kept if the events have no timestamps
+      double time = SNR::snrProfile::getPercentile(profile.getKernelTimes(), 50.0);
+      auto reference = baseline.find(shape->name);
+
+      if ( time <= 0.0 ) {
+        time = timer.getAverageTime();
+      }
+      json << std::setprecision(9);
+      json << ", \"gbs\": " << gbs / time << ", \"time\": " << time << ", \"host_time\": " << timer.getAverageTime() << ", \"profile\": " << profile.getJSON();
+      if ( reference != baseline.end() ) {
+        bool slower = time > reference->second * (1.0 + tolerance);
+
+        json << ", \"baseline_time\": " << reference->second << ", \"change\": " << (time - reference->second) / reference->second << ", \"regression\": " << (slower ? "true" : "false");
+        if ( slower ) {
+          nrRegressions++;
+          std::cerr << "Regression (" << shape->name << "): " << time << " s, baseline " << reference->second << " s." << std::endl;
+        }
+      }
+    } else {
+      nrFailed++;
+      std::cerr << "Failed (" << shape->name << "): " << status << "." << std::endl;
+    }
+    json << "}" << ((shape + 1 != scenarios.end()) ? "," : "") << std::endl;
+  }
+  json << "]}" << std::endl;
+
+  if ( outputFilename == "-" ) {
+    std::cout << json.str();
+  } else {
+    std::ofstream output(outputFilename);
+
+    output << json.str();
+    if ( !output ) {
+      std::cerr << "Impossible to write " << outputFilename << "." << std::endl;
+      return 1;
+    }
+  }
+  if ( nrFailed > 0 || nrRegressions > 0 ) {
+    std::cerr << "Failed scenarios: " << nrFailed << ", regressions: " << nrRegressions << " of " << scenarios.size() << "." << std::endl;
+    regression = true;
+  }
+
+  return regression ? 1 : 0;
+}
+
+bool isValid(const SNR::snrConf & conf, const bool DMsSamples, const unsigned int nrDMs, const unsigned int nrSamples, const size_t maxWorkGroupSize) {
+  if ( (conf.getNrThreadsD0() * conf.getNrThreadsD1()) > maxWorkGroupSize || (conf.getTransposeTile() * conf.getTransposeTile()) > maxWorkGroupSize ) {
+    return false;
+  }
+  return SNR::isValidSNRConf(conf, DMsSamples, nrDMs, nrSamples);
+}
+
+void generateInput(const scenario & shape, const AstroData::Observation & observation, const unsigned int padding, std::vector< inputDataType > & input) {
+  const unsigned int nrDMs = observation.getNrDMs(true) * observation.getNrDMs();
+  const uint64_t nrPaddedSamples = observation.getNrSamplesPerBatch(false, padding / sizeof(inputDataType));
+  const uint64_t nrPaddedDMs = isa::utils::pad(nrDMs, padding / sizeof(inputDataType));
+  // Multiplicative hash of the position, so that the input does not depend on the C library
+  auto hash = [](const uint64_t position) {
+    return static_cast< unsigned int >(((position + 1) * 2654435761u) >> 8);
+  };
+
+  if ( shape.DMsSamples ) {
+    input.assign(shape.nrBeams * nrDMs * nrPaddedSamples, static_cast< inputDataType >(0));
+  } else {
+    input.assign(shape.nrBeams * shape.nrSamples * nrPaddedDMs, static_cast< inputDataType >(0));
+  }
+  for ( unsigned int beam = 0; beam < shape.nrBeams; beam++ ) {
+    for ( unsigned int dm = 0; dm < nrDMs; dm++ ) {
+      const uint64_t trial = (beam * static_cast< uint64_t >(nrDMs)) + dm;
+      const unsigned int peakSample = hash(trial) % shape.nrSamples;
+
+      for ( unsigned int sample = 0; sample < shape.nrSamples; sample++ ) {
+        const unsigned int value = (sample == peakSample) ? 10 + (hash(trial) % 10) : hash((trial * shape.nrSamples) + sample) % 10;
+
+        if ( shape.DMsSamples ) {
+          input[(trial * nrPaddedSamples) + sample] = static_cast< inputDataType >(value);
+        } else {
+          input[(((beam * static_cast< uint64_t >(shape.nrSamples)) + sample) * nrPaddedDMs) + dm] = static_cast< inputDataType >(value);
+        }
+      }
+    }
+  }
+}
+
+std::map< std::string, double > readBaseline(const std::string & filename) {
+  std::map< std::string, double > baseline;
+  std::ifstream input(filename);
+  std::string line;
+  // Parse the JSON string starting at position, and move position after it
+  auto readString = [](const std::string & line, std::string::size_type & position, std::string & value) {
+    value.clear();
+    if ( position >= line.size() || line[position] != '"' ) {
+      return false;
+    }
+    for ( position++; position < line.size() && line[position] != '"'; position++ ) {
+      if ( line[position] == '\\' ) {
+        position++;
+        if ( position >= line.size() ) {
+          return false;
+        } else if ( line[position] == 'u' ) {
+          if ( position + 4 >= line.size() ) {
+            return false;
+          }
+          value += static_cast< char >(std::strtoul(line.substr(position + 1, 4).c_str(), 0, 16));
+          position += 4;
+        } else {
+          const std::string escaped = "\"\\/bfnrt";
+          const std::string::size_type character = escaped.find(line[position]);
+
+          if ( character == std::string::npos ) {
+            return false;
+          }
+          value += std::string("\"\\/\b\f\n\r\t")[character];
+        }
+      } else {
+        value += line[position];
+      }
+    }
+    if ( position >= line.size() ) {
+      return false;
+    }
+    position++;
+    return true;
+  };
+  auto skipSpaces = [](const std::string & line, std::string::size_type & position) {
+    while ( position < line.size() && (line[position] == ' ' || line[position] == '\t' || line[position] == '\r') ) {
+      position++;
+    }
+  };
+
+  if ( !input ) {
+    throw AstroData::FileError("Impossible to open " + filename);
+  }
+  // One scenario per line, as an object with the name and, only with status ok, the time among its top level keys
+  while ( std::getline(input, line) ) {
+    std::string::size_type position = 0;
+    std::string key, name, value;
+    double time = 0.0;
+    bool hasTime = false;
+    bool valid = false;
+
+    skipSpaces(line, position);
+    if ( position >= line.size() || line[position] != '{' ) {
+      continue;
+    }
+    position++;
+    while ( true ) {
+      skipSpaces(line, position);
+      if ( !readString(line, position, key) ) {
+        break;
+      }
+      skipSpaces(line, position);
+      if ( position >= line.size() || line[position] != ':' ) {
+        break;
+      }
+      position++;
+      skipSpaces(line, position);
+      if ( position >= line.size() ) {
+        break;
+      } else if ( line[position] == '"' ) {
+        if ( !readString(line, position, value) ) {
+          break;
+        }
+        if ( key == "name" ) {
+          name = value;
+        }
+      } else if ( line[position] == '{' || line[position] == '[' ) {
+        // Nested objects and arrays, e.g. the profile, are skipped
+        unsigned int depth = 0;
+
+        while ( position < line.size() ) {
+          if ( line[position] == '"' ) {
+            if ( !readString(line, position, value) ) {
+              position = line.size();
+            }
+            continue;
+          } else if ( line[position] == '{' || line[position] == '[' ) {
+            depth++;
+          } else if ( line[position] == '}' || line[position] == ']' ) {
+            depth--;
+          }
+          position++;
+          if ( depth == 0 ) {
+            break;
+          }
+        }
+        if ( depth > 0 ) {
+          break;
+        }
+      } else {
+        const std::string::size_type end = line.find_first_of(",}", position);
+
+        if ( end == std::string::npos ) {
+          break;
+        }
+        if ( key == "time" ) {
+          char * last = 0;
+          const std::string number = line.substr(position, end - position);
+
+          time = std::strtod(number.c_str(), &last);
+          hasTime = last != number.c_str();
+        }
+        position = end;
+      }
+      skipSpaces(line, position);
+      if ( position < line.size() && line[position] == ',' ) {
+        position++;
+      } else {
+        valid = (position < line.size()) && (line[position] == '}');
+        break;
+      }
+    }
+    if ( valid && !name.empty() && hasTime ) {
+      baseline[name] = time;
+    }
+  }
+  return baseline;
+}
+
+std::string escapeJSON(const std::string & value) {
+  std::stringstream escaped;
+
+  for ( auto character = value.begin(); character != value.end(); ++character ) {
+    if ( *character == '"' || *character == '\\' ) {
+      escaped << '\\' << *character;
+    } else if ( *character == '\0' ) {
+      // Some OpenCL headers keep the terminator in the strings of getInfo
+      continue;
+    } else if ( static_cast< unsigned char >(*character) < 0x20 ) {
+      escaped << "\\u" << std::hex << std::setw(4) << std::setfill('0') << static_cast< unsigned int >(static_cast< unsigned char >(*character)) << std::dec << std::setfill(' ');
+    } else {
+      escaped << *character;
+    }
+  }
+  return escaped.str();
+}
@@ -0,0 +1,581 @@
+// Copyright 2017 Netherlands Institute for Radio Astronomy (ASTRON)
+// Copyright 2017 Netherlands eScience Center
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+#include <algorithm>
+#include <limits>
+#include <cmath>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define SNR_CPU_X86
+#include <immintrin.h>
+#endif
+
+#include <SNRCPU.hpp>
+
+namespace SNR {
+
+namespace {
+
+// Granularity, in DMs, of the vectorized SamplesDMs kernels
+const unsigned int nrDMsPerBlock = 16;
+
+enum class InstructionSet { Scalar, AVX2, AVX512 };
+
+// Welford statistics and maximum of one DM
+struct snrState {
+  float counter;
+  float mean;
+  float variance;
+  float max;
+  unsigned int maxSample;
+};
+
+inline snrState emptyState() {
+  return snrState{0.0f, 0.0f, 0.0f, -std::numeric_limits<float>::infinity(), 0};
+}
+
+inline void update(snrState & state, const float item, const unsigned int sample) {
+  float delta = item - state.mean;
+
+  state.counter += 1.0f;
+  state.mean += delta / state.counter;
+  state.variance += delta * (item - state.mean);
+  if ( item > state.max ) {
+    state.max = item;
+    state.maxSample = sample;
+  }
+}
+
+// Same parallel merge used in the reduction phase of the OpenCL kernels
+inline void merge(snrState & state, const snrState & other) {
+  if ( other.counter == 0.0f ) {
+    return;
+  } else if ( state.counter == 0.0f ) {
+    state = other;
+    return;
+  }
+  float counter = state.counter + other.counter;
+  float delta = other.mean - state.mean;
+
+  state.mean = ((state.counter * state.mean) + (other.counter * other.mean)) / counter;
+  state.variance += other.variance + ((delta * delta) * ((state.counter * other.counter) / counter));
+  state.counter = counter;
+  if ( (other.max > state.max) || ((other.max == state.max) && (other.maxSample < state.maxSample)) ) {
+    state.max = other.max;
+    state.maxSample = other.maxSample;
+  }
+}
+
+inline float getSNR(const snrState & state) {
+  return (state.max - state.mean) / std::sqrt(state.variance / (state.counter - 1.0f));
+}
+
+InstructionSet detectInstructionSet() {
+#ifdef SNR_CPU_X86
+  __builtin_cpu_init();
+  if ( __builtin_cpu_supports("avx512f") ) {
+    return InstructionSet::AVX512;
+  } else if ( __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma") ) {
+    return InstructionSet::AVX2;
+  }
+#endif
+  return InstructionSet::Scalar;
+}
+
+InstructionSet getInstructionSet() {
+  static const InstructionSet instructionSet = detectInstructionSet();
+
+  return instructionSet;
+}
+
+// Scalar kernels, also used for non float data types
+template<typename T> snrState rowScalar(const T * row, const unsigned int nrSamples) {
+  snrState state = emptyState();
+
+  for ( unsigned int sample = 0; sample < nrSamples; sample++ ) {
+    update(state, static_cast<float>(row[sample]), sample);
+  }
+  return state;
+}
+
+template<typename T> void columnsScalar(const T * input, const uint64_t stride, const unsigned int nrSamples, const unsigned int nrDMs, snrState * states) {
+  for ( unsigned int dm = 0; dm < nrDMs; dm++ ) {
+    states[dm] = emptyState();
+  }
+  for ( unsigned int sample = 0; sample < nrSamples; sample++ ) {
+    for ( unsigned int dm = 0; dm < nrDMs; dm++ ) {
+      update(states[dm], static_cast<float>(input[(sample * stride) + dm]), sample);
+    }
+  }
+}
+
+#ifdef SNR_CPU_X86
+// AVX2 kernels: two interleaved sets of 8 lanes to hide the latency of the Welford update
+__attribute__((target("avx2,fma"))) snrState rowAVX2(const float * row, const unsigned int nrSamples) {
+  const unsigned int nrSets = 2;
+  snrState state = emptyState();
+  unsigned int sample = 0;
+
+  if ( nrSamples >= nrSets * 8 ) {
+    float counter = 1.0f;
+    __m256 mean[nrSets], variance[nrSets], max[nrSets];
+    __m256i maxSample[nrSets], current[nrSets];
+    const __m256i step = _mm256_set1_epi32(nrSets * 8);
+
+    for ( unsigned int set = 0; set < nrSets; set++ ) {
+      mean[set] = _mm256_loadu_ps(row + (set * 8));
+      variance[set] = _mm256_setzero_ps();
+      max[set] = mean[set];
+      current[set] = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+      current[set] = _mm256_add_epi32(current[set], _mm256_set1_epi32(set * 8));
+      maxSample[set] = current[set];
+    }
+    for ( sample = nrSets * 8; sample + (nrSets * 8) <= nrSamples; sample += nrSets * 8 ) {
+      counter += 1.0f;
+      const __m256 reciprocal = _mm256_set1_ps(1.0f / counter);
+
+      for ( unsigned int set = 0; set < nrSets; set++ ) {
+        __m256 item = _mm256_loadu_ps(row + sample + (set * 8));
+        __m256 delta = _mm256_sub_ps(item, mean[set]);
+
+        current[set] = _mm256_add_epi32(current[set], step);
+        mean[set] = _mm256_fmadd_ps(delta, reciprocal, mean[set]);
+        variance[set] = _mm256_fmadd_ps(delta, _mm256_sub_ps(item, mean[set]), variance[set]);
+        __m256 greater = _mm256_cmp_ps(item, max[set], _CMP_GT_OQ);
+        max[set] = _mm256_blendv_ps(max[set], item, greater);
+        maxSample[set] = _mm256_castps_si256(_mm256_blendv_ps(_mm256_castsi256_ps(maxSample[set]), _mm256_castsi256_ps(current[set]), greater));
+      }
+    }
+    for ( unsigned int set = 0; set < nrSets; set++ ) {
+      alignas(32) float laneMean[8], laneVariance[8], laneMax[8];
+      alignas(32) unsigned int laneSample[8];
+
+      _mm256_store_ps(laneMean, mean[set]);
+      _mm256_store_ps(laneVariance, variance[set]);
+      _mm256_store_ps(laneMax, max[set]);
+      _mm256_store_si256(reinterpret_cast<__m256i *>(laneSample), maxSample[set]);
+      for ( unsigned int lane = 0; lane < 8; lane++ ) {
+        merge(state, snrState{counter, laneMean[lane], laneVariance[lane], laneMax[lane], laneSample[lane]});
+      }
+    }
+  }
+  for ( ; sample < nrSamples; sample++ ) {
+    update(state, row[sample], sample);
+  }
+  return state;
+}
+
+__attribute__((target("avx2,fma"))) void columnsAVX2(const float * input, const uint64_t stride, const unsigned int nrSamples, const unsigned int nrDMs, snrState * states) {
+  // State is kept in memory, so that every sample reads a contiguous slice of the task's DMs
+  std::vector<float> mean(input, input + nrDMs), variance(nrDMs, 0.0f), max(input, input + nrDMs);
+  std::vector<unsigned int> maxSample(nrDMs, 0);
+  float counter = 1.0f;
+
+  for ( unsigned int sample = 1; sample < nrSamples; sample++ ) {
+    const __m256i current = _mm256_set1_epi32(sample);
+    counter += 1.0f;
+    const __m256 reciprocal = _mm256_set1_ps(1.0f / counter);
+
+    for ( unsigned int dm = 0; dm < nrDMs; dm += 8 ) {
+      __m256 item = _mm256_loadu_ps(input + (sample * stride) + dm);
+      __m256 itemMean = _mm256_loadu_ps(mean.data() + dm);
+      __m256 itemMax = _mm256_loadu_ps(max.data() + dm);
+      __m256 delta = _mm256_sub_ps(item, itemMean);
+
+      itemMean = _mm256_fmadd_ps(delta, reciprocal, itemMean);
+      _mm256_storeu_ps(mean.data() + dm, itemMean);
+      _mm256_storeu_ps(variance.data() + dm, _mm256_fmadd_ps(delta, _mm256_sub_ps(item, itemMean), _mm256_loadu_ps(variance.data() + dm)));
+      __m256 greater = _mm256_cmp_ps(item, itemMax, _CMP_GT_OQ);
+      _mm256_storeu_ps(max.data() + dm, _mm256_blendv_ps(itemMax, item, greater));
+      __m256 itemSample = _mm256_castsi256_ps(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(maxSample.data() + dm)));
+      _mm256_storeu_si256(reinterpret_cast<__m256i *>(maxSample.data() + dm), _mm256_castps_si256(_mm256_blendv_ps(itemSample, _mm256_castsi256_ps(current), greater)));
+    }
+  }
+  for ( unsigned int dm = 0; dm < nrDMs; dm++ ) {
+    states[dm] = snrState{counter, mean[dm], variance[dm], max[dm], maxSample[dm]};
+  }
+}
+
+// AVX-512 kernels: two interleaved sets of 16 lanes for the rows
+__attribute__((target("avx512f"))) snrState rowAVX512(const float * row, const unsigned int nrSamples) {
+  const unsigned int nrSets = 2;
+  snrState state = emptyState();
+  unsigned int sample = 0;
+
+  if ( nrSamples >= nrSets * 16 ) {
+    float counter = 1.0f;
+    __m512 mean[nrSets], variance[nrSets], max[nrSets];
+    __m512i maxSample[nrSets], current[nrSets];
+    const __m512i step = _mm512_set1_epi32(nrSets * 16);
+
+    for ( unsigned int set = 0; set < nrSets; set++ ) {
+      mean[set] = _mm512_loadu_ps(row + (set * 16));
+      variance[set] = _mm512_setzero_ps();
+      max[set] = mean[set];
+      current[set] = _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+      current[set] = _mm512_add_epi32(current[set], _mm512_set1_epi32(set * 16));
+      maxSample[set] = current[set];
+    }
+    for ( sample = nrSets * 16; sample + (nrSets * 16) <= nrSamples; sample += nrSets * 16 ) {
+      counter += 1.0f;
+      const __m512 reciprocal = _mm512_set1_ps(1.0f / counter);
+
+      for ( unsigned int set = 0; set < nrSets; set++ ) {
+        __m512 item = _mm512_loadu_ps(row + sample + (set * 16));
+        __m512 delta = _mm512_sub_ps(item, mean[set]);
+
+        current[set] = _mm512_add_epi32(current[set], step);
+        mean[set] = _mm512_fmadd_ps(delta, reciprocal, mean[set]);
+        variance[set] = _mm512_fmadd_ps(delta, _mm512_sub_ps(item, mean[set]), variance[set]);
+        __mmask16 greater = _mm512_cmp_ps_mask(item, max[set], _CMP_GT_OQ);
+        max[set] = _mm512_mask_blend_ps(greater, max[set], item);
+        maxSample[set] = _mm512_mask_blend_epi32(greater, maxSample[set], current[set]);
+      }
+    }
+    for ( unsigned int set = 0; set < nrSets; set++ ) {
+      alignas(64) float laneMean[16], laneVariance[16], laneMax[16];
+      alignas(64) unsigned int laneSample[16];
+
+      _mm512_store_ps(laneMean, mean[set]);
+      _mm512_store_ps(laneVariance, variance[set]);
+      _mm512_store_ps(laneMax, max[set]);
+      _mm512_store_si512(laneSample, maxSample[set]);
+      for ( unsigned int lane = 0; lane < 16; lane++ ) {
+        merge(state, snrState{counter, laneMean[lane], laneVariance[lane], laneMax[lane], laneSample[lane]});
+      }
+    }
+  }
+  for ( ; sample < nrSamples; sample++ ) {
+    update(state, row[sample], sample);
+  }
+  return state;
+}
+
+__attribute__((target("avx512f"))) void columnsAVX512(const float * input, const uint64_t stride, const unsigned int nrSamples, const unsigned int nrDMs, snrState * states) {
+  std::vector<float> mean(input, input + nrDMs), variance(nrDMs, 0.0f), max(input, input + nrDMs);
+  std::vector<unsigned int> maxSample(nrDMs, 0);
+  float counter = 1.0f;
+
+  for ( unsigned int sample = 1; sample < nrSamples; sample++ ) {
+    const __m512i current = _mm512_set1_epi32(sample);
+    counter += 1.0f;
+    const __m512 reciprocal = _mm512_set1_ps(1.0f / counter);
+
+    for ( unsigned int dm = 0; dm < nrDMs; dm += 16 ) {
+      __m512 item = _mm512_loadu_ps(input + (sample * stride) + dm);
+      __m512 itemMean = _mm512_loadu_ps(mean.data() + dm);
+      __m512 itemMax = _mm512_loadu_ps(max.data() + dm);
+      __m512 delta = _mm512_sub_ps(item, itemMean);
+
+      itemMean = _mm512_fmadd_ps(delta, reciprocal, itemMean);
+      _mm512_storeu_ps(mean.data() + dm, itemMean);
+      _mm512_storeu_ps(variance.data() + dm, _mm512_fmadd_ps(delta, _mm512_sub_ps(item, itemMean), _mm512_loadu_ps(variance.data() + dm)));
+      __mmask16 greater = _mm512_cmp_ps_mask(item, itemMax, _CMP_GT_OQ);
+      _mm512_storeu_ps(max.data() + dm, _mm512_mask_blend_ps(greater, itemMax, item));
+      _mm512_mask_storeu_epi32(maxSample.data() + dm, greater, current);
+    }
+  }
+  for ( unsigned int dm = 0; dm < nrDMs; dm++ ) {
+    states[dm] = snrState{counter, mean[dm], variance[dm], max[dm], maxSample[dm]};
+  }
+}
+#endif // SNR_CPU_X86
+
+// Dispatch on data type and instruction set
+template<typename T> snrState row(const T * row, const unsigned int nrSamples) {
+  return rowScalar<T>(row, nrSamples);
+}
+
+template<> snrState row<float>(const float * row, const unsigned int nrSamples) {
+#ifdef SNR_CPU_X86
+  switch ( getInstructionSet() ) {
+    case InstructionSet::AVX512:
+      return rowAVX512(row, nrSamples);
+    case InstructionSet::AVX2:
+      return rowAVX2(row, nrSamples);
+    default:
+      break;
+  }
+#endif
+  return rowScalar<float>(row, nrSamples);
+}
+
+template<typename T> void columns(const T * input, const uint64_t stride, const unsigned int nrSamples, const unsigned int nrDMs, snrState * states) {
+  columnsScalar<T>(input, stride, nrSamples, nrDMs, states);
+}
+
+template<> void columns<float>(const float * input, const uint64_t stride, const unsigned int nrSamples, const unsigned int nrDMs, snrState * states) {
+  unsigned int nrVectorDMs = 0;
+
+#ifdef SNR_CPU_X86
+  nrVectorDMs = (nrDMs / nrDMsPerBlock) * nrDMsPerBlock;
+  if ( nrVectorDMs > 0 ) {
+    switch ( getInstructionSet() ) {
+      case InstructionSet::AVX512:
+        columnsAVX512(input, stride, nrSamples, nrVectorDMs, states);
+        break;
+      case InstructionSet::AVX2:
+        columnsAVX2(input, stride, nrSamples, nrVectorDMs, states);
+        break;
+      default:
+        nrVectorDMs = 0;
+        break;
+    }
+  }
+#endif
+  if ( nrVectorDMs < nrDMs ) {
+    columnsScalar<float>(input + nrVectorDMs, stride, nrSamples, nrDMs - nrVectorDMs, states + nrVectorDMs);
+  }
+}
+
+unsigned int getNrDMs(const snrConf & conf, const AstroData::Observation & observation) {
+  if ( conf.getSubbandDedispersion() ) {
+    return observation.getNrDMs(true) * observation.getNrDMs();
+  }
+  return observation.getNrDMs();
+}
+
+// Host threads of parallelFor, started on first use and kept waiting between calls
+class threadPool {
+public:
+  ~threadPool();
+  // Run worker on the calling thread and on nrWorkers - 1 pool threads; false, without running it, if the pool is in use
+  // The first exception thrown by worker is rethrown once every thread is done with it
+  bool run(const unsigned int nrWorkers, const std::function<void()> & worker);
+
+private:
+  void loop(const unsigned int id);
+
+  std::mutex inUse;
+  std::mutex mutex;
+  std::condition_variable started;
+  std::condition_variable finished;
+  std::vector<std::thread> threads;
+  const std::function<void()> * job = 0;
+  std::exception_ptr error;
+  unsigned int nrJobThreads = 0;
+  unsigned int nrRunning = 0;
+  uint64_t generation = 0;
+  bool stopped = false;
+};
+
+threadPool::~threadPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    stopped = true;
+  }
+  started.notify_all();
+  for ( auto & thread : threads ) {
+    thread.join();
+  }
+}
+
+bool threadPool::run(const unsigned int nrWorkers, const std::function<void()> & worker) {
+  // Concurrent calls, and calls from inside a task, do not wait for the pool
+  std::unique_lock<std::mutex> inUseLock(inUse, std::try_to_lock);
+
+  if ( !inUseLock.owns_lock() ) {
+    return false;
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    while ( threads.size() < nrWorkers - 1 ) {
+      threads.emplace_back(&threadPool::loop, this, threads.size());
+    }
+    job = &worker;
+    nrJobThreads = nrWorkers - 1;
+    nrRunning = nrJobThreads;
+    generation++;
+  }
+  started.notify_all();
+  std::exception_ptr workerError;
+
+  try {
+    worker();
+  } catch ( ... ) {
+    workerError = std::current_exception();
+  }
+  std::unique_lock<std::mutex> lock(mutex);
+
+  // The pool threads may still use worker, and what it refers to, until they are done
+  finished.wait(lock, [this]() { return nrRunning == 0; });
+  job = 0;
+  if ( !workerError ) {
+    workerError = error;
+  }
+  error = nullptr;
+  lock.unlock();
+  if ( workerError ) {
+    std::rethrow_exception(workerError);
+  }
+  return true;
+}
+
+void threadPool::loop(const unsigned int id) {
+  uint64_t seen = 0;
+  std::unique_lock<std::mutex> lock(mutex);
+
+  while ( true ) {
+    started.wait(lock, [&]() { return stopped || generation != seen; });
+    if ( stopped ) {
+      return;
+    }
+    seen = generation;
+    if ( id >= nrJobThreads ) {
+      continue;
+    }
+    const std::function<void()> * current = job;
+
+    lock.unlock();
+    try {
+      (*current)();
+      lock.lock();
+    } catch ( ... ) {
+      lock.lock();
+      if ( !error ) {
+        error = std::current_exception();
+      }
+    }
+    if ( --nrRunning == 0 ) {
+      finished.notify_one();
+    }
+  }
+}
+
+threadPool & getThreadPool() {
+  static threadPool pool;
+
+  return pool;
+}
+
+} // anonymous
+
+template<typename T> void snrDMsSamplesCPU(const snrConf & conf, const AstroData::Observation & observation, const unsigned int nrSamples, const unsigned int padding, const std::vector<T> & input, std::vector<float> & outputSNR, std::vector<unsigned int> & outputSample) {
+  const unsigned int nrDMs = getNrDMs(conf, observation);
+  const unsigned int nrDMsPerTask = std::max(conf.getNrItemsD0(), 1u);
+  const unsigned int nrTasksPerBeam = (nrDMs + nrDMsPerTask - 1) / nrDMsPerTask;
+
+  parallelFor(observation.getNrSynthesizedBeams() * nrTasksPerBeam, conf.getNrThreadsD0(), [&](unsigned int task) {
+    const unsigned int beam = task / nrTasksPerBeam;
+    const unsigned int firstDM = (task % nrTasksPerBeam) * nrDMsPerTask;
+
+    for ( unsigned int dm = firstDM; dm < std::min(firstDM + nrDMsPerTask, nrDMs); dm++ ) {
+      snrState state = row<T>(input.data() + (beam * static_cast<uint64_t>(nrDMs) * isa::utils::pad(nrSamples, padding / sizeof(T))) + (dm * static_cast<uint64_t>(isa::utils::pad(nrSamples, padding / sizeof(T)))), nrSamples);
+
+      outputSNR[(beam * isa::utils::pad(nrDMs, padding / sizeof(float))) + dm] = getSNR(state);
+      outputSample[(beam * isa::utils::pad(nrDMs, padding / sizeof(unsigned int))) + dm] = state.maxSample;
+    }
+  });
+}
+
+template<typename T> void snrSamplesDMsCPU(const snrConf & conf, const AstroData::Observation & observation, const unsigned int nrSamples, const unsigned int padding, const std::vector<T> & input, std::vector<float> & outputSNR, std::vector<unsigned int> & outputSample) {
+  const unsigned int nrDMs = getNrDMs(conf, observation);
+  const unsigned int nrDMsPerTask = std::max(conf.getNrItemsD0(), 1u) * nrDMsPerBlock;
+  const unsigned int nrTasksPerBeam = (nrDMs + nrDMsPerTask - 1) / nrDMsPerTask;
+  const uint64_t stride = isa::utils::pad(nrDMs, padding / sizeof(T));
+
+  parallelFor(observation.getNrSynthesizedBeams() * nrTasksPerBeam, conf.getNrThreadsD0(), [&](unsigned int task) {
+    const unsigned int beam = task / nrTasksPerBeam;
+    const unsigned int firstDM = (task % nrTasksPerBeam) * nrDMsPerTask;
+    const unsigned int nrTaskDMs = std::min(nrDMsPerTask, nrDMs - firstDM);
+    std::vector<snrState> states(nrTaskDMs);
+
+    columns<T>(input.data() + (beam * nrSamples * stride) + firstDM, stride, nrSamples, nrTaskDMs, states.data());
+    for ( unsigned int dm = 0; dm < nrTaskDMs; dm++ ) {
+      outputSNR[(beam * isa::utils::pad(nrDMs, padding / sizeof(float))) + firstDM + dm] = getSNR(states[dm]);
+      outputSample[(beam * isa::utils::pad(nrDMs, padding / sizeof(unsigned int))) + firstDM + dm] = states[dm].maxSample;
+    }
+  });
+}
+
+std::string getCPUInstructionSet() {
+  switch ( getInstructionSet() ) {
+    case InstructionSet::AVX512:
+      return "AVX-512";
+    case InstructionSet::AVX2:
+      return "AVX2";
+    default:
+      return "scalar";
+  }
+}
+
+void parallelFor(const unsigned int nrTasks, const unsigned int nrThreads, const std::function<void(unsigned int)> & task) {
+  std::atomic<unsigned int> nextTask(0);
+  unsigned int nrWorkers = nrThreads;
+  const std::function<void()> worker = [&]() {
+    try {
+      for ( unsigned int current = nextTask++; current < nrTasks; current = nextTask++ ) {
+        task(current);
+      }
+    } catch ( ... ) {
+      // The other workers stop after their current task
+      nextTask = nrTasks;
+      throw;
+    }
+  };
+
+  if ( nrWorkers == 0 ) {
+    nrWorkers = std::max(std::thread::hardware_concurrency(), 1u);
+  }
+  nrWorkers = std::max(std::min(nrWorkers, nrTasks), 1u);
+  if ( nrWorkers == 1 ) {
+    worker();
+  } else if ( !getThreadPool().run(nrWorkers, worker) ) {
+    std::vector<std::thread> threads;
+    std::mutex errorMutex;
+    std::exception_ptr error;
+    const std::function<void()> guardedWorker = [&]() {
+      try {
+        worker();
+      } catch ( ... ) {
+        std::lock_guard<std::mutex> lock(errorMutex);
+
+        if ( !error ) {
+          error = std::current_exception();
+        }
+      }
+    };
+
+    for ( unsigned int thread = 1; thread < nrWorkers; thread++ ) {
+      threads.emplace_back(guardedWorker);
+    }
+    guardedWorker();
+    for ( auto & thread : threads ) {
+      thread.join();
+    }
+    if ( error ) {
+      std::rethrow_exception(error);
+    }
+  }
+}
+
+template void snrDMsSamplesCPU<float>(const snrConf & conf, const AstroData::Observation & observation, const unsigned int nrSamples, const unsigned int padding, const std::vector<float> & input, std::vector<float> & outputSNR, std::vector<unsigned int> & outputSample);
+template void snrSamplesDMsCPU<float>(const snrConf & conf, const AstroData::Observation & observation, const unsigned int nrSamples, const unsigned int padding, const std::vector<float> & input, std::vector<float> & outputSNR, std::vector<unsigned int> & outputSample);
+template void snrDMsSamplesCPU<snrHalf>(const snrConf & conf, const AstroData::Observation & observation, const unsigned int nrSamples, const unsigned int padding, const std::vector<snrHalf> & input, std::vector<float> & outputSNR, std::vector<unsigned int> & outputSample);
+template void snrSamplesDMsCPU<snrHalf>(const snrConf & conf, const AstroData::Observation & observation, const unsigned int nrSamples, const unsigned int padding, const std::vector<snrHalf> & input, std::vector<float> & outputSNR, std::vector<unsigned int> & outputSample);
+template void snrDMsSamplesCPU<int16_t>(const snrConf & conf, const AstroData::Observation & observation, const unsigned int nrSamples, const unsigned int padding, const std::vector<int16_t> & input, std::vector<float> & outputSNR, std::vector<unsigned int> & outputSample);
+template void snrSamplesDMsCPU<int16_t>(const snrConf & conf, const AstroData::Observation & observation, const unsigned int nrSamples, const unsigned int padding, const std::vector<int16_t> & input, std::vector<float> & outputSNR, std::vector<unsigned int> & outputSample);
+template void snrDMsSamplesCPU<uint8_t>(const snrConf & conf, const AstroData::Observation & observation, const unsigned int nrSamples, const unsigned int padding, const std::vector<uint8_t> & input, std::vector<float> & outputSNR, std::vector<unsigned int> & outputSample);
+template void snrSamplesDMsCPU<uint8_t>(const snrConf & conf, const AstroData::Observation & observation, const unsigned int nrSamples, const unsigned int padding, const std::vector<uint8_t> & input, std::vector<float> & outputSNR, std::vector<unsigned int> & outputSample);
+
+} // SNR
+
@@ -0,0 +1,209 @@
+// Copyright 2017 Netherlands Institute for Radio Astronomy (ASTRON)
+// Copyright 2017 Netherlands eScience Center
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <string>
+#include <atomic>
+#include <algorithm>
+#include <stdexcept>
+#include <cstdint>
+
+#include <utils.hpp>
+#include <SNRCPU.hpp>
+#include <SNRCluster.hpp>
+
+namespace SNR {
+
+namespace {
+
+// Granularity of the parallel tasks, in DMs for the threshold and in candidates for the clustering
+const unsigned int nrDMsPerTask = 4096;
+const unsigned int nrCandidatesPerTask = 4096;
+
+// Root of the set of item, halving the path on the way
+unsigned int find(std::vector<std::atomic<unsigned int> > & parent, unsigned int item) {
+  unsigned int next = parent[item].load();
+
+  while ( next != item ) {
+    unsigned int grandParent = parent[next].load();
+
+    if ( grandParent != next ) {
+      unsigned int expected = next;
+
+      parent[item].compare_exchange_weak(expected, grandParent);
+    }
+    item = next;
+    next = parent[item].load();
+  }
+  return item;
+}
+
+// The larger root is linked to the smaller one, so the root of a set is its first member
+void unite(std::vector<std::atomic<unsigned int> > & parent, unsigned int first, unsigned int second) {
+  while ( true ) {
+    first = find(parent, first);
+    second = find(parent, second);
+    if ( first == second ) {
+      return;
+    } else if ( first < second ) {
+      std::swap(first, second);
+    }
+    unsigned int expected = first;
+
+    // Fails if first stopped being a root in the meantime
+    if ( parent[first].compare_exchange_strong(expected, second) ) {
+      return;
+    }
+  }
+}
+
+inline bool isBefore(const snrCandidate & first, const snrCandidate & second) {
+  if ( first.dm != second.dm ) {
+    return first.dm < second.dm;
+  } else if ( first.sample != second.sample ) {
+    return first.sample < second.sample;
+  }
+  return first.snr > second.snr;
+}
+
+inline unsigned int getDistance(const unsigned int first, const unsigned int second) {
+  return (first > second) ? first - second : second - first;
+}
+
+} // namespace
+
+std::vector<snrCandidate> getCandidates(const AstroData::Observation & observation, const unsigned int padding, const float threshold, const std::vector<float> & outputSNR, const std::vector<unsigned int> & outputSample, const unsigned int nrThreads) {
+  const unsigned int nrDMs = observation.getNrDMs(true) * observation.getNrDMs();
+  const unsigned int nrBlocks = (nrDMs + nrDMsPerTask - 1) / nrDMsPerTask;
+  const uint64_t nrSNRDMs = isa::utils::pad(nrDMs, padding / sizeof(float));
+  const uint64_t nrSampleDMs = isa::utils::pad(nrDMs, padding / sizeof(unsigned int));
+  std::vector<std::vector<snrCandidate> > blocks(observation.getNrSynthesizedBeams() * nrBlocks);
+  std::vector<snrCandidate> candidates;
+
+  parallelFor(blocks.size(), nrThreads, [&](const unsigned int task) {
+    const unsigned int beam = task / nrBlocks;
+    const unsigned int lastDM = std::min(((task % nrBlocks) + 1) * nrDMsPerTask, nrDMs);
+
+    for ( unsigned int dm = (task % nrBlocks) * nrDMsPerTask; dm < lastDM; dm++ ) {
+      if ( outputSNR[(beam * nrSNRDMs) + dm] >= threshold ) {
+        blocks[task].push_back(snrCandidate{beam, dm, outputSample[(beam * nrSampleDMs) + dm], outputSNR[(beam * nrSNRDMs) + dm]});
+      }
+    }
+  });
+  for ( auto block = blocks.begin(); block != blocks.end(); ++block ) {
+    candidates.insert(candidates.end(), block->begin(), block->end());
+  }
+  return candidates;
+}
+
+std::vector<snrCluster> clusterCandidates(const std::vector<snrCandidate> & candidates, const unsigned int nrBeams, const unsigned int nrDMs, const snrClusterDistance & distance, const unsigned int nrThreads) {
+  std::vector<unsigned int> beams(nrBeams + 1, 0);
+  std::vector<snrCandidate> members(candidates.size());
+  std::vector<std::atomic<unsigned int> > parent(candidates.size());
+  std::vector<unsigned int> labels(candidates.size());
+  std::vector<snrCluster> clusters;
+
+  // Rows of candidates: counting sort by beam, then every beam sorted by DM and sample
+  for ( auto candidate = candidates.begin(); candidate != candidates.end(); ++candidate ) {
+    if ( candidate->beam >= nrBeams || candidate->dm >= nrDMs ) {
+      throw std::out_of_range("Candidate outside of " + std::to_string(nrBeams) + " beams and " + std::to_string(nrDMs) + " DMs.");
+    }
+    beams[candidate->beam + 1]++;
+  }
+  for ( unsigned int beam = 1; beam <= nrBeams; beam++ ) {
+    beams[beam] += beams[beam - 1];
+  }
+  {
+    std::vector<unsigned int> next(beams.begin(), beams.end() - 1);
+
+    for ( auto candidate = candidates.begin(); candidate != candidates.end(); ++candidate ) {
+      members[next[candidate->beam]++] = *candidate;
+    }
+  }
+  parallelFor(nrBeams, nrThreads, [&](const unsigned int beam) {
+    // The candidates from the dense outputs are already in order
+    if ( !std::is_sorted(members.begin() + beams[beam], members.begin() + beams[beam + 1], isBefore) ) {
+      std::sort(members.begin() + beams[beam], members.begin() + beams[beam + 1], isBefore);
+    }
+    for ( unsigned int member = beams[beam]; member < beams[beam + 1]; member++ ) {
+      parent[member].store(member);
+    }
+  });
+
+  // Friends-of-friends; every pair is visited once, from the member that comes first in (beam, DM) order
+  parallelFor((members.size() + nrCandidatesPerTask - 1) / nrCandidatesPerTask, nrThreads, [&](const unsigned int task) {
+    const unsigned int last = std::min((task + 1) * static_cast<uint64_t>(nrCandidatesPerTask), static_cast<uint64_t>(members.size()));
+
+    for ( unsigned int member = task * nrCandidatesPerTask; member < last; member++ ) {
+      const snrCandidate & candidate = members[member];
+      const unsigned int lastBeam = candidate.beam + std::min(distance.beams, nrBeams - 1 - candidate.beam);
+
+      for ( unsigned int beam = candidate.beam; beam <= lastBeam; beam++ ) {
+        const unsigned int lastDM = candidate.dm + std::min(distance.dms, nrDMs - 1 - candidate.dm);
+        unsigned int friendMember = member + 1;
+
+        if ( beam > candidate.beam ) {
+          const unsigned int firstDM = candidate.dm - std::min(candidate.dm, distance.dms);
+
+          friendMember = std::lower_bound(members.begin() + beams[beam], members.begin() + beams[beam + 1], firstDM, [](const snrCandidate & item, const unsigned int dm) {
+            return item.dm < dm;
+          }) - members.begin();
+        }
+        for ( ; friendMember < beams[beam + 1] && members[friendMember].dm <= lastDM; friendMember++ ) {
+          if ( getDistance(members[friendMember].sample, candidate.sample) <= distance.samples ) {
+            unite(parent, member, friendMember);
+          }
+        }
+      }
+    }
+  });
+  parallelFor((members.size() + nrCandidatesPerTask - 1) / nrCandidatesPerTask, nrThreads, [&](const unsigned int task) {
+    const unsigned int last = std::min((task + 1) * static_cast<uint64_t>(nrCandidatesPerTask), static_cast<uint64_t>(members.size()));
+
+    for ( unsigned int member = task * nrCandidatesPerTask; member < last; member++ ) {
+      labels[member] = find(parent, member);
+    }
+  });
+
+  // The root comes before the other members, so every event is created by its first member
+  for ( unsigned int member = 0; member < members.size(); member++ ) {
+    const snrCandidate & candidate = members[member];
+
+    if ( labels[member] == member ) {
+      labels[member] = clusters.size();
+      clusters.push_back(snrCluster{candidate, 1, candidate.beam, candidate.beam, candidate.dm, candidate.dm, candidate.sample, candidate.sample});
+      continue;
+    }
+    labels[member] = labels[labels[member]];
+    snrCluster & cluster = clusters[labels[member]];
+
+    cluster.nrMembers++;
+    if ( candidate.snr > cluster.peak.snr ) {
+      cluster.peak = candidate;
+    }
+    cluster.lastBeam = std::max(cluster.lastBeam, candidate.beam);
+    cluster.firstDM = std::min(cluster.firstDM, candidate.dm);
+    cluster.lastDM = std::max(cluster.lastDM, candidate.dm);
+    cluster.firstSample = std::min(cluster.firstSample, candidate.sample);
+    cluster.lastSample = std::max(cluster.lastSample, candidate.sample);
+  }
+  return clusters;
+}
+
+std::vector<snrCluster> clusterSNR(const AstroData::Observation & observation, const unsigned int padding, const float threshold, const std::vector<float> & outputSNR, const std::vector<unsigned int> & outputSample, const snrClusterDistance & distance, const unsigned int nrThreads) {
+  return clusterCandidates(getCandidates(observation, padding, threshold, outputSNR, outputSample, nrThreads), observation.getNrSynthesizedBeams(), observation.getNrDMs(true) * observation.getNrDMs(), distance, nrThreads);
+}
+
+} // SNR
+
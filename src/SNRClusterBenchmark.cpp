@@ -0,0 +1,295 @@
+// Copyright 2017 Netherlands Institute for Radio Astronomy (ASTRON)
+// Copyright 2017 Netherlands eScience Center
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <exception>
+#include <iomanip>
+#include <algorithm>
+#include <ctime>
+#include <cstdlib>
+
+#include <ArgumentList.hpp>
+#include <Observation.hpp>
+#include <SNR.hpp>
+#include <SNRCluster.hpp>
+#include <utils.hpp>
+#include <Timer.hpp>
+
+// Event planted in the synthetic outputs, on the trials from firstBeam to lastBeam and from peakDM - width to peakDM + width
+struct plantedEvent {
+  unsigned int firstBeam;
+  unsigned int lastBeam;
+  unsigned int peakDM;
+  unsigned int width;
+};
+
+// Friends-of-friends comparing every pair of candidates, in the order and with the ties of SNR::clusterCandidates; label[candidate] is the index of its cluster
+std::vector< SNR::snrCluster > clusterSerial(const std::vector< SNR::snrCandidate > & candidates, const SNR::snrClusterDistance & distance, std::vector< unsigned int > & label);
+
+int main(int argc, char * argv[]) {
+  bool printResults = false;
+  bool checkReference = true;
+  unsigned int padding = 0;
+  unsigned int nrIterations = 0;
+  unsigned int minThreads = 0;
+  unsigned int maxThreads = 0;
+  unsigned int nrEvents = 0;
+  float threshold = 0.0f;
+  float noiseRate = 0.0f;
+  SNR::snrClusterDistance distance;
+  AstroData::Observation observation;
+
+  try {
+    isa::utils::ArgumentList args(argc, argv);
+    printResults = args.getSwitch("-print_results");
+    checkReference = !args.getSwitch("-no_reference");
+    nrIterations = args.getSwitchArgument< unsigned int >("-iterations");
+    padding = args.getSwitchArgument< unsigned int >("-padding");
+    minThreads = args.getSwitchArgument< unsigned int >("-min_threads");
+    maxThreads = args.getSwitchArgument< unsigned int >("-max_threads");
+    threshold = args.getSwitchArgument< float >("-threshold");
+    noiseRate = args.getSwitchArgument< float >("-noise");
+    nrEvents = args.getSwitchArgument< unsigned int >("-events");
+    distance.beams = args.getSwitchArgument< unsigned int >("-beam_distance");
+    distance.dms = args.getSwitchArgument< unsigned int >("-dm_distance");
+    distance.samples = args.getSwitchArgument< unsigned int >("-sample_distance");
+    observation.setNrSynthesizedBeams(args.getSwitchArgument< unsigned int >("-beams"));
+    observation.setNrSamplesPerBatch(args.getSwitchArgument< unsigned int >("-samples"));
+    if ( args.getSwitch("-subband") ) {
+      observation.setDMRange(args.getSwitchArgument< unsigned int >("-subbanding_dms"), 0.0f, 0.0f, true);
+    } else {
+      observation.setDMRange(1, 0.0f, 0.0f, true);
+    }
+    observation.setDMRange(args.getSwitchArgument< unsigned int >("-dms"), 0.0, 0.0);
+    if ( nrIterations == 0 || minThreads == 0 || maxThreads < minThreads ) {
+      std::cerr << "-iterations and -min_threads must be larger than zero, and -max_threads at least -min_threads." << std::endl;
+      return 1;
+    } else if ( noiseRate < 0.0f || noiseRate > 1.0f ) {
+      std::cerr << "-noise must be between 0 and 1." << std::endl;
+      return 1;
+    }
+  } catch ( isa::utils::EmptyCommandLine & err ) {
+    std::cerr << argv[0] << " [-print_results] [-no_reference] -iterations ... -padding ... -min_threads ... -max_threads ... -threshold ... -noise ... -events ... -beam_distance ... -dm_distance ... -sample_distance ... [-subband] -beams ... -dms ... -samples ..." << std::endl;
+    std::cerr << "\t -subband : -subbanding_dms ..." << std::endl;
+    std::cerr << "\t -noise : fraction of the trials above -threshold without an event" << std::endl;
+    std::cerr << "\t -no_reference : skip the serial O(n^2) clustering and the check of the events" << std::endl;
+    return 1;
+  } catch ( std::exception & err ) {
+    std::cerr << err.what() << std::endl;
+    return 1;
+  }
+
+  // Outputs of the dense kernels, with noise and events spread over neighbouring beams and DMs
+  const unsigned int nrDMs = observation.getNrDMs(true) * observation.getNrDMs();
+  const uint64_t nrInputs = observation.getNrSynthesizedBeams() * static_cast< uint64_t >(nrDMs);
+  std::vector< float > outputSNR(observation.getNrSynthesizedBeams() * static_cast< uint64_t >(isa::utils::pad(nrDMs, padding / sizeof(float))));
+  std::vector< unsigned int > outputSample(observation.getNrSynthesizedBeams() * static_cast< uint64_t >(isa::utils::pad(nrDMs, padding / sizeof(unsigned int))));
+
+  srand(time(0));
+  for ( unsigned int beam = 0; beam < observation.getNrSynthesizedBeams(); beam++ ) {
+    for ( unsigned int dm = 0; dm < nrDMs; dm++ ) {
+      const uint64_t item = (beam * static_cast< uint64_t >(isa::utils::pad(nrDMs, padding / sizeof(float)))) + dm;
+
+      if ( (rand() / static_cast< float >(RAND_MAX)) < noiseRate ) {
+        outputSNR[item] = threshold * (1.0f + (rand() / static_cast< float >(RAND_MAX)));
+      } else {
+        outputSNR[item] = threshold * (rand() / (static_cast< float >(RAND_MAX) + 1.0f));
+      }
+      outputSample[(beam * static_cast< uint64_t >(isa::utils::pad(nrDMs, padding / sizeof(unsigned int)))) + dm] = rand() % observation.getNrSamplesPerBatch();
+    }
+  }
+  // The events do not share trials, so that every event keeps its samples
+  std::vector< plantedEvent > events;
+  for ( unsigned int event = 0; event < nrEvents; event++ ) {
+    const unsigned int firstBeam = rand() % observation.getNrSynthesizedBeams();
+    const unsigned int lastBeam = std::min(firstBeam + (rand() % (distance.beams + 1)), observation.getNrSynthesizedBeams() - 1);
+    const unsigned int peakDM = rand() % nrDMs;
+    const unsigned int width = 1 + (rand() % (4 * (distance.dms + 1)));
+    const unsigned int sample = rand() % observation.getNrSamplesPerBatch();
+    const float peakSNR = 2.0f * threshold * (1.0f + (rand() / static_cast< float >(RAND_MAX)));
+
+    if ( std::any_of(events.begin(), events.end(), [&](const plantedEvent & other) {
+        return firstBeam <= other.lastBeam && other.firstBeam <= lastBeam && (peakDM + width) >= (other.peakDM - std::min(other.peakDM, other.width)) && (other.peakDM + other.width) >= (peakDM - std::min(peakDM, width));
+      }) ) {
+      continue;
+    }
+    events.push_back({firstBeam, lastBeam, peakDM, width});
+    for ( unsigned int beam = firstBeam; beam <= lastBeam; beam++ ) {
+      for ( unsigned int dm = peakDM - std::min(peakDM, width); dm <= std::min(peakDM + width, nrDMs - 1); dm++ ) {
+        const unsigned int offset = (dm > peakDM) ? dm - peakDM : peakDM - dm;
+        const uint64_t item = (beam * static_cast< uint64_t >(isa::utils::pad(nrDMs, padding / sizeof(float)))) + dm;
+
+        // The SNR decreases away from the peak DM, and stays above threshold
+        outputSNR[item] = std::max(outputSNR[item], threshold + ((peakSNR - threshold) * (width - offset)) / width);
+        outputSample[(beam * static_cast< uint64_t >(isa::utils::pad(nrDMs, padding / sizeof(unsigned int)))) + dm] = std::min(sample + (offset / (distance.dms + 1)), observation.getNrSamplesPerBatch() - 1);
+      }
+    }
+  }
+
+  std::cout << std::fixed << std::endl;
+  std::cout << "# nrBeams nrDMs nrInputs nrCandidates nrClusters threads time stdDeviation COV Minputs/s" << std::endl << std::endl;
+
+  // The clusters do not depend on the number of threads, so the first run is the reference for the others
+  std::vector< SNR::snrCluster > reference;
+  for ( unsigned int threads = minThreads; threads <= maxThreads; threads *= 2 ) {
+    std::vector< SNR::snrCluster > clusters;
+    unsigned int nrCandidates = 0;
+    isa::utils::Timer timer;
+
+    // Warm-up run and benchmark runs
+    for ( unsigned int iteration = 0; iteration <= nrIterations; iteration++ ) {
+      if ( iteration > 0 ) {
+        timer.start();
+      }
+      clusters = SNR::clusterSNR(observation, padding, threshold, outputSNR, outputSample, distance, threads);
+      if ( iteration > 0 ) {
+        timer.stop();
+      }
+    }
+    for ( auto cluster = clusters.begin(); cluster != clusters.end(); ++cluster ) {
+      nrCandidates += cluster->nrMembers;
+    }
+    if ( threads == minThreads ) {
+      reference = clusters;
+    } else if ( clusters.size() != reference.size() || !std::equal(clusters.begin(), clusters.end(), reference.begin(), [](const SNR::snrCluster & first, const SNR::snrCluster & second) {
+        return first.peak.beam == second.peak.beam && first.peak.dm == second.peak.dm && first.peak.sample == second.peak.sample && first.nrMembers == second.nrMembers;
+      }) ) {
+      std::cerr << "The clusters with " << threads << " threads differ from the ones with " << minThreads << " threads." << std::endl;
+      return 1;
+    }
+    std::cout << observation.getNrSynthesizedBeams() << " " << nrDMs << " " << nrInputs << " " << nrCandidates << " " << clusters.size() << " " << threads << " ";
+    std::cout << std::setprecision(6);
+    std::cout << timer.getAverageTime() << " " << timer.getStandardDeviation() << " " << timer.getCoefficientOfVariation() << " ";
+    std::cout << std::setprecision(3);
+    std::cout << (nrInputs / timer.getAverageTime()) * 1.0e-06 << std::endl;
+  }
+
+  // Same clusters as the serial friends-of-friends, and every planted event is in one cluster with its peak
+  if ( checkReference ) {
+    std::vector< SNR::snrCandidate > candidates = SNR::getCandidates(observation, padding, threshold, outputSNR, outputSample, 1);
+    std::vector< unsigned int > label;
+    std::vector< SNR::snrCluster > serial = clusterSerial(candidates, distance, label);
+    unsigned int nrWrongEvents = 0;
+
+    if ( serial.size() != reference.size() || !std::equal(serial.begin(), serial.end(), reference.begin(), [](const SNR::snrCluster & first, const SNR::snrCluster & second) {
+        return first.peak.beam == second.peak.beam && first.peak.dm == second.peak.dm && first.peak.sample == second.peak.sample && first.nrMembers == second.nrMembers && first.firstBeam == second.firstBeam && first.lastBeam == second.lastBeam && first.firstDM == second.firstDM && first.lastDM == second.lastDM && first.firstSample == second.firstSample && first.lastSample == second.lastSample;
+      }) ) {
+      std::cerr << "The clusters differ from the ones of the serial friends-of-friends (" << reference.size() << " and " << serial.size() << " clusters)." << std::endl;
+      return 1;
+    }
+    // Trials of one event are friends only if neighbouring DMs and samples are
+    for ( auto event = events.begin(); distance.dms > 0 && distance.samples > 0 && event != events.end(); ++event ) {
+      // Index of the candidate of a trial, candidates.size() if the trial is below threshold
+      auto getCandidate = [&candidates](const unsigned int beam, const unsigned int dm) {
+        auto candidate = std::lower_bound(candidates.begin(), candidates.end(), std::make_pair(beam, dm), [](const SNR::snrCandidate & item, const std::pair< unsigned int, unsigned int > & value) {
+          return std::make_pair(item.beam, item.dm) < value;
+        });
+
+        if ( candidate == candidates.end() || candidate->beam != beam || candidate->dm != dm ) {
+          return static_cast< unsigned int >(candidates.size());
+        }
+        return static_cast< unsigned int >(candidate - candidates.begin());
+      };
+      const unsigned int peak = getCandidate(event->firstBeam, event->peakDM);
+      bool wrong = (peak == candidates.size()) || (serial.at(label.at(peak)).peak.snr < candidates.at(peak).snr);
+
+      for ( unsigned int beam = event->firstBeam; !wrong && beam <= event->lastBeam; beam++ ) {
+        for ( unsigned int dm = event->peakDM - std::min(event->peakDM, event->width); !wrong && dm <= std::min(event->peakDM + event->width, nrDMs - 1); dm++ ) {
+          const unsigned int candidate = getCandidate(beam, dm);
+
+          wrong = (candidate == candidates.size()) || (label.at(candidate) != label.at(peak));
+        }
+      }
+      if ( wrong ) {
+        nrWrongEvents++;
+      }
+    }
+    if ( nrWrongEvents > 0 ) {
+      std::cerr << nrWrongEvents << " of " << events.size() << " planted events are not in one cluster with their peak." << std::endl;
+      return 1;
+    }
+  }
+
+  if ( printResults ) {
+    std::cout << std::endl;
+    std::cout << "# beam DM sample SNR members beams DMs samples" << std::endl;
+    for ( auto cluster = reference.begin(); cluster != reference.end(); ++cluster ) {
+      std::cout << cluster->peak.beam << " " << cluster->peak.dm << " " << cluster->peak.sample << " ";
+      std::cout << std::setprecision(3);
+      std::cout << cluster->peak.snr << " " << cluster->nrMembers << " ";
+      std::cout << cluster->firstBeam << "-" << cluster->lastBeam << " " << cluster->firstDM << "-" << cluster->lastDM << " " << cluster->firstSample << "-" << cluster->lastSample << std::endl;
+    }
+  }
+
+  return 0;
+}
+
+
+std::vector< SNR::snrCluster > clusterSerial(const std::vector< SNR::snrCandidate > & candidates, const SNR::snrClusterDistance & distance, std::vector< unsigned int > & label) {
+  std::vector< unsigned int > parent(candidates.size());
+  std::vector< SNR::snrCluster > clusters;
+  auto find = [&parent](unsigned int item) {
+    while ( parent[item] != item ) {
+      parent[item] = parent[parent[item]];
+      item = parent[item];
+    }
+    return item;
+  };
+  auto isFriend = [](const unsigned int first, const unsigned int second, const unsigned int maxDistance) {
+    return ((first > second) ? first - second : second - first) <= maxDistance;
+  };
+
+  for ( unsigned int item = 0; item < candidates.size(); item++ ) {
+    parent[item] = item;
+  }
+  for ( unsigned int first = 0; first < candidates.size(); first++ ) {
+    for ( unsigned int second = first + 1; second < candidates.size(); second++ ) {
+      if ( isFriend(candidates[first].beam, candidates[second].beam, distance.beams) && isFriend(candidates[first].dm, candidates[second].dm, distance.dms) && isFriend(candidates[first].sample, candidates[second].sample, distance.samples) ) {
+        unsigned int firstRoot = find(first);
+        unsigned int secondRoot = find(second);
+
+        // The root of a set is its first member
+        parent[std::max(firstRoot, secondRoot)] = std::min(firstRoot, secondRoot);
+      }
+    }
+  }
+  // Clusters in the order of their first member, the first of the members with the highest SNR is the peak
+  label.assign(candidates.size(), 0);
+  for ( unsigned int item = 0; item < candidates.size(); item++ ) {
+    const unsigned int root = find(item);
+    const SNR::snrCandidate & candidate = candidates[item];
+
+    if ( root == item ) {
+      label[item] = clusters.size();
+      clusters.push_back({candidate, 1, candidate.beam, candidate.beam, candidate.dm, candidate.dm, candidate.sample, candidate.sample});
+      continue;
+    }
+    label[item] = label[root];
+    SNR::snrCluster & cluster = clusters[label[item]];
+    if ( candidate.snr > cluster.peak.snr ) {
+      cluster.peak = candidate;
+    }
+    cluster.nrMembers++;
+    cluster.firstBeam = std::min(cluster.firstBeam, candidate.beam);
+    cluster.lastBeam = std::max(cluster.lastBeam, candidate.beam);
+    cluster.firstDM = std::min(cluster.firstDM, candidate.dm);
+    cluster.lastDM = std::max(cluster.lastDM, candidate.dm);
+    cluster.firstSample = std::min(cluster.firstSample, candidate.sample);
+    cluster.lastSample = std::max(cluster.lastSample, candidate.sample);
+  }
+  return clusters;
+}
@@ -0,0 +1,123 @@
+// Copyright 2017 Netherlands Institute for Radio Astronomy (ASTRON)
+// Copyright 2017 Netherlands eScience Center
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <cstdio>
+#include <unistd.h>
+
+#include <SNRKernelCache.hpp>
+
+namespace SNR {
+
+snrKernelCache::snrKernelCache(const std::string & directory) : directory(directory), nrHits(0), nrMisses(0) {}
+
+snrKernelCache::~snrKernelCache() {}
+
+cl::Kernel * snrKernelCache::getKernel(const std::string & name, const std::string & code, const std::string & flags, const std::string & description, cl::Context & context, cl::Device & device) {
+  std::string key = device.getInfo<CL_DEVICE_NAME>() + ";" + device.getInfo<CL_DRIVER_VERSION>() + ";" + flags + ";" + name + ";" + description + ";" + std::to_string(hash(code));
+  std::stringstream path;
+  cl::Kernel * kernel = 0;
+
+  path << directory << "/snr_" << std::hex << std::setw(16) << std::setfill('0') << hash(key) << ".bin";
+  kernel = load(path.str(), key, name, flags, context, device);
+  if ( kernel != 0 ) {
+    nrHits++;
+    return kernel;
+  }
+  nrMisses++;
+  kernel = isa::OpenCL::compile(name, code, flags, context, device);
+  store(path.str(), key, kernel);
+
+  return kernel;
+}
+
+uint64_t snrKernelCache::hash(const std::string & data) {
+  // 64 bits FNV-1a
+  uint64_t value = 0xcbf29ce484222325;
+
+  for ( auto character = data.begin(); character != data.end(); ++character ) {
+    value ^= static_cast< unsigned char >(*character);
+    value *= 0x100000001b3;
+  }
+  return value;
+}
+
+cl::Kernel * snrKernelCache::load(const std::string & path, const std::string & key, const std::string & name, const std::string & flags, cl::Context & context, cl::Device & device) {
+  std::string storedKey;
+  std::vector< char > binary;
+  std::ifstream binaryFile(path, std::ios::binary);
+
+  if ( !binaryFile ) {
+    return 0;
+  }
+  // The first line contains the key, to detect hash collisions
+  std::getline(binaryFile, storedKey);
+  if ( storedKey != key ) {
+    return 0;
+  }
+  binary.assign(std::istreambuf_iterator< char >(binaryFile), std::istreambuf_iterator< char >());
+  binaryFile.close();
+  if ( binary.size() == 0 ) {
+    return 0;
+  }
+  try {
+    std::vector< cl::Device > devices(1, device);
+    cl::Program::Binaries binaries(1, std::make_pair(reinterpret_cast< const void * >(binary.data()), binary.size()));
+    cl::Program program(context, devices, binaries);
+
+    program.build(devices, flags.c_str());
+    return new cl::Kernel(program, name.c_str());
+  } catch ( cl::Error & err ) {
+    return 0;
+  }
+}
+
+void snrKernelCache::store(const std::string & path, const std::string & key, cl::Kernel * kernel) {
+  cl::Program program;
+  std::vector< size_t > sizes;
+  std::vector< char * > binaries;
+  std::vector< char > binary;
+
+  try {
+    kernel->getInfo(CL_KERNEL_PROGRAM, &program);
+    program.getInfo(CL_PROGRAM_BINARY_SIZES, &sizes);
+    if ( sizes.size() != 1 || sizes.at(0) == 0 ) {
+      return;
+    }
+    binary.resize(sizes.at(0));
+    binaries.push_back(binary.data());
+    program.getInfo(CL_PROGRAM_BINARIES, &binaries);
+  } catch ( cl::Error & err ) {
+    return;
+  }
+  // Write and rename, concurrent readers never see a partial entry; the process id and the kernel make the temporary file unique between processes and threads
+  std::string temporaryPath = path + "." + std::to_string(getpid()) + "." + std::to_string(hash(key + std::to_string(reinterpret_cast< uintptr_t >(kernel))));
+  std::ofstream binaryFile(temporaryPath, std::ios::binary);
+
+  if ( !binaryFile ) {
+    return;
+  }
+  binaryFile << key << std::endl;
+  binaryFile.write(binary.data(), binary.size());
+  binaryFile.close();
+  if ( !binaryFile || std::rename(temporaryPath.c_str(), path.c_str()) != 0 ) {
+    std::remove(temporaryPath.c_str());
+  }
+}
+
+} // SNR
+
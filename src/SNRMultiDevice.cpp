@@ -0,0 +1,110 @@
+// Copyright 2017 Netherlands Institute for Radio Astronomy (ASTRON)
+// Copyright 2017 Netherlands eScience Center
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <thread>
+#include <mutex>
+#include <exception>
+
+#include <SNRMultiDevice.hpp>
+
+namespace SNR {
+
+snrMultiDevice::snrMultiDevice(const std::vector<cl::Device> & devices, const unsigned int nrBeamsPerChunk) : partitions(devices.size()), nrBeamsPerChunk(std::max(nrBeamsPerChunk, 1u)), nrProcessedBeams(devices.size(), 0), DMsSamples(false), nrBeams(0), nrDMs(0), inputBeamSize(0), outputSNRBeamSize(0), outputSampleBeamSize(0) {
+  for ( unsigned int device = 0; device < devices.size(); device++ ) {
+    partitions.at(device).device = devices.at(device);
+    partitions.at(device).context = cl::Context(std::vector<cl::Device>(1, devices.at(device)));
+    partitions.at(device).queue = cl::CommandQueue(partitions.at(device).context, partitions.at(device).device);
+    partitions.at(device).kernel = 0;
+  }
+}
+
+snrMultiDevice::~snrMultiDevice() {
+  for ( auto item = partitions.begin(); item != partitions.end(); ++item ) {
+    delete item->kernel;
+  }
+}
+
+void snrMultiDevice::parallel(const std::function<void(partition &, const unsigned int)> & body) {
+  std::vector<std::thread> threads;
+  std::exception_ptr error;
+  std::mutex errorMutex;
+
+  for ( unsigned int device = 0; device < partitions.size(); device++ ) {
+    threads.emplace_back([&, device]() {
+      try {
+        body(partitions.at(device), device);
+      } catch ( ... ) {
+        std::lock_guard<std::mutex> lock(errorMutex);
+
+        if ( !error ) {
+          error = std::current_exception();
+        }
+      }
+    });
+  }
+  for ( auto & thread : threads ) {
+    thread.join();
+  }
+  if ( error ) {
+    std::rethrow_exception(error);
+  }
+}
+
+void snrMultiDevice::allocate(partition & item, const uint64_t inputSize) {
+  const uint64_t nrChunkBeams = std::min(nrBeamsPerChunk, nrBeams);
+
+  item.input_d = cl::Buffer(item.context, CL_MEM_READ_ONLY | CL_MEM_ALLOC_HOST_PTR, inputSize, 0, 0);
+  item.outputSNR_d = cl::Buffer(item.context, CL_MEM_WRITE_ONLY | CL_MEM_ALLOC_HOST_PTR, nrChunkBeams * outputSNRBeamSize * sizeof(float), 0, 0);
+  item.outputSample_d = cl::Buffer(item.context, CL_MEM_WRITE_ONLY | CL_MEM_ALLOC_HOST_PTR, nrChunkBeams * outputSampleBeamSize * sizeof(unsigned int), 0, 0);
+  // The buffers are first written by the device, so that with first-touch placement the pages of a CPU sub-device are on its NUMA node
+  item.queue.enqueueFillBuffer(item.input_d, static_cast<cl_uchar>(0), 0, inputSize);
+  item.queue.enqueueFillBuffer(item.outputSNR_d, static_cast<cl_uchar>(0), 0, nrChunkBeams * outputSNRBeamSize * sizeof(float));
+  item.queue.enqueueFillBuffer(item.outputSample_d, static_cast<cl_uchar>(0), 0, nrChunkBeams * outputSampleBeamSize * sizeof(unsigned int));
+  item.queue.finish();
+}
+
+cl::NDRange snrMultiDevice::getGlobal(const snrConf & conf, const unsigned int nrChunkBeams) const {
+  if ( DMsSamples ) {
+    return cl::NDRange(conf.getNrThreadsD0(), nrDMs / conf.getNrItemsD1(), nrChunkBeams);
+  }
+  return cl::NDRange(nrDMs / conf.getNrItemsD0(), nrChunkBeams);
+}
+
+cl::NDRange snrMultiDevice::getLocal(const snrConf & conf) const {
+  if ( DMsSamples ) {
+    return cl::NDRange(conf.getNrThreadsD0(), conf.getNrThreadsD1(), 1);
+  }
+  return cl::NDRange(conf.getNrThreadsD0(), 1);
+}
+
+std::vector<cl::Device> getNUMASubDevices(cl::Device & device) {
+  std::vector<cl::Device> subDevices;
+  const cl_device_partition_property properties[] = {CL_DEVICE_PARTITION_BY_AFFINITY_DOMAIN, CL_DEVICE_AFFINITY_DOMAIN_NUMA, 0};
+
+  try {
+    if ( device.createSubDevices(properties, &subDevices) != CL_SUCCESS ) {
+      subDevices.clear();
+    }
+  } catch ( cl::Error & err ) {
+    subDevices.clear();
+  }
+  if ( subDevices.empty() ) {
+    subDevices.push_back(device);
+  }
+  return subDevices;
+}
+
+} // SNR
+
@@ -0,0 +1,102 @@
+// Copyright 2017 Netherlands Institute for Radio Astronomy (ASTRON)
+// Copyright 2017 Netherlands eScience Center
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <numeric>
+#include <sstream>
+#include <iomanip>
+#include <cmath>
+
+#include <SNRProfile.hpp>
+
+namespace SNR {
+
+snrProfile::snrProfile() {}
+
+snrProfile::~snrProfile() {}
+
+double snrProfile::getMeanKernelTime() const {
+  if ( kernelTimes.empty() ) {
+    return 0.0;
+  }
+  return std::accumulate(kernelTimes.begin(), kernelTimes.end(), 0.0) / kernelTimes.size();
+}
+
+void snrProfile::addEvent(const cl::Event & event) {
+  addEvent(event, event);
+}
+
+void snrProfile::addEvent(const cl::Event & first, const cl::Event & last) {
+  cl_ulong queued = first.getProfilingInfo<CL_PROFILING_COMMAND_QUEUED>();
+  cl_ulong submit = first.getProfilingInfo<CL_PROFILING_COMMAND_SUBMIT>();
+  cl_ulong start = first.getProfilingInfo<CL_PROFILING_COMMAND_START>();
+  cl_ulong end = last.getProfilingInfo<CL_PROFILING_COMMAND_END>();
+
+  // The timestamps are in nanoseconds
+  kernelTimes.push_back((static_cast<double>(end) - static_cast<double>(start)) * 1.0e-09);
+  submitTimes.push_back((static_cast<double>(submit) - static_cast<double>(queued)) * 1.0e-09);
+  launchTimes.push_back((static_cast<double>(start) - static_cast<double>(submit)) * 1.0e-09);
+  timestamps.push_back({{queued, submit, start, end}});
+}
+
+void snrProfile::reset() {
+  kernelTimes.clear();
+  submitTimes.clear();
+  launchTimes.clear();
+  timestamps.clear();
+}
+
+std::string snrProfile::getJSON() const {
+  std::string json = "{\"iterations\": " + std::to_string(kernelTimes.size()) + ", \"kernel\": " + getJSONStatistics(kernelTimes) + ", \"submit\": " + getJSONStatistics(submitTimes) + ", \"launch\": " + getJSONStatistics(launchTimes) + ", \"timestamps\": [";
+
+  for ( auto iteration = timestamps.begin(); iteration != timestamps.end(); ++iteration ) {
+    if ( iteration != timestamps.begin() ) {
+      json += ", ";
+    }
+    json += "[" + std::to_string((*iteration)[0]) + ", " + std::to_string((*iteration)[1]) + ", " + std::to_string((*iteration)[2]) + ", " + std::to_string((*iteration)[3]) + "]";
+  }
+  return json + "]}";
+}
+
+double snrProfile::getPercentile(std::vector<double> values, const double percentile) {
+  double rank = 0.0;
+  unsigned int lower = 0;
+
+  if ( values.empty() ) {
+    return 0.0;
+  }
+  std::sort(values.begin(), values.end());
+  rank = (std::min(std::max(percentile, 0.0), 100.0) / 100.0) * (values.size() - 1);
+  lower = static_cast<unsigned int>(std::floor(rank));
+  if ( lower + 1 >= values.size() ) {
+    return values.back();
+  }
+  return values.at(lower) + ((rank - lower) * (values.at(lower + 1) - values.at(lower)));
+}
+
+std::string snrProfile::getJSONStatistics(const std::vector<double> & values) {
+  std::stringstream json;
+  double mean = 0.0;
+
+  if ( !values.empty() ) {
+    mean = std::accumulate(values.begin(), values.end(), 0.0) / values.size();
+  }
+  json << std::setprecision(9);
+  json << "{\"mean\": " << mean << ", \"min\": " << getPercentile(values, 0.0) << ", \"p50\": " << getPercentile(values, 50.0) << ", \"p90\": " << getPercentile(values, 90.0) << ", \"p99\": " << getPercentile(values, 99.0) << ", \"max\": " << getPercentile(values, 100.0) << "}";
+  return json.str();
+}
+
+} // SNR
+
@@ -0,0 +1,235 @@
+// Copyright 2017 Netherlands Institute for Radio Astronomy (ASTRON)
+// Copyright 2017 Netherlands eScience Center
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <cmath>
+
+#include <SNRSearch.hpp>
+
+namespace SNR {
+
+snrSearch::snrSearch(const std::vector<snrConf> & configurations, const unsigned int seed) : configurations(configurations), coordinates(configurations.size()), evaluated(configurations.size(), false), performance(configurations.size(), 0.0), generator(seed), nrEvaluations(0), maxEvaluations(0), maxTime(0.0), start(std::chrono::steady_clock::now()) {
+  std::vector<unsigned int> threads;
+  std::vector<unsigned int> items;
+
+  for ( auto conf = configurations.begin(); conf != configurations.end(); ++conf ) {
+    threads.push_back(conf->getNrThreadsD0());
+    items.push_back(conf->getNrItemsD0());
+  }
+  std::sort(threads.begin(), threads.end());
+  threads.erase(std::unique(threads.begin(), threads.end()), threads.end());
+  std::sort(items.begin(), items.end());
+  items.erase(std::unique(items.begin(), items.end()), items.end());
+  for ( unsigned int conf = 0; conf < configurations.size(); conf++ ) {
+    coordinates.at(conf).first = std::lower_bound(threads.begin(), threads.end(), configurations.at(conf).getNrThreadsD0()) - threads.begin();
+    coordinates.at(conf).second = std::lower_bound(items.begin(), items.end(), configurations.at(conf).getNrItemsD0()) - items.begin();
+  }
+}
+
+snrSearch::~snrSearch() {}
+
+bool snrSearch::next(snrConf & conf) {
+  unsigned int index = 0;
+
+  if ( maxEvaluations > 0 && nrEvaluations >= maxEvaluations ) {
+    return false;
+  }
+  if ( maxTime > 0.0 && std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() >= maxTime ) {
+    return false;
+  }
+  if ( nrEvaluations == configurations.size() || !select(index) ) {
+    return false;
+  }
+  evaluated.at(index) = true;
+  nrEvaluations++;
+  pending.push_back(index);
+  conf = configurations.at(index);
+
+  return true;
+}
+
+void snrSearch::report(const double performance) {
+  unsigned int index = pending.front();
+
+  pending.pop_front();
+  this->performance.at(index) = performance;
+  update(index, performance);
+}
+
+void snrSearch::update(const unsigned int, const double) {}
+
+std::vector<unsigned int> snrSearch::getCandidates(const unsigned int index, const unsigned int radius) const {
+  std::vector<unsigned int> candidates;
+
+  for ( unsigned int conf = 0; conf < configurations.size(); conf++ ) {
+    if ( !evaluated.at(conf) && getDistance(index, conf) <= radius ) {
+      candidates.push_back(conf);
+    }
+  }
+  return candidates;
+}
+
+unsigned int snrSearch::getDistance(const unsigned int first, const unsigned int second) const {
+  unsigned int distance = 0;
+
+  distance += std::max(coordinates.at(first).first, coordinates.at(second).first) - std::min(coordinates.at(first).first, coordinates.at(second).first);
+  distance += std::max(coordinates.at(first).second, coordinates.at(second).second) - std::min(coordinates.at(first).second, coordinates.at(second).second);
+  if ( configurations.at(first).getSubgroupReduction() != configurations.at(second).getSubgroupReduction() ) {
+    distance++;
+  }
+  if ( configurations.at(first).getTransposeTile() != configurations.at(second).getTransposeTile() ) {
+    distance++;
+  }
+  // The numbers of slices and the vector widths are powers of two
+  distance += static_cast<unsigned int>(std::abs(std::log2(static_cast<double>(configurations.at(first).getNrSlices())) - std::log2(static_cast<double>(configurations.at(second).getNrSlices()))) + 0.5);
+  distance += static_cast<unsigned int>(std::abs(std::log2(static_cast<double>(configurations.at(first).getVectorWidth())) - std::log2(static_cast<double>(configurations.at(second).getVectorWidth()))) + 0.5);
+  // DMs per work-group are powers of two, DMs per work-item are consecutive
+  distance += static_cast<unsigned int>(std::abs(std::log2(static_cast<double>(configurations.at(first).getNrThreadsD1())) - std::log2(static_cast<double>(configurations.at(second).getNrThreadsD1()))) + 0.5);
+  distance += std::max(configurations.at(first).getNrItemsD1(), configurations.at(second).getNrItemsD1()) - std::min(configurations.at(first).getNrItemsD1(), configurations.at(second).getNrItemsD1());
+  return distance;
+}
+
+unsigned int snrSearch::getRandomCandidate() {
+  std::vector<unsigned int> candidates;
+
+  for ( unsigned int conf = 0; conf < configurations.size(); conf++ ) {
+    if ( !evaluated.at(conf) ) {
+      candidates.push_back(conf);
+    }
+  }
+  return candidates.at(std::uniform_int_distribution<unsigned int>(0, candidates.size() - 1)(generator));
+}
+
+snrExhaustiveSearch::snrExhaustiveSearch(const std::vector<snrConf> & configurations, const unsigned int seed) : snrSearch(configurations, seed) {}
+
+snrExhaustiveSearch::~snrExhaustiveSearch() {}
+
+bool snrExhaustiveSearch::select(unsigned int & index) {
+  for ( unsigned int conf = 0; conf < configurations.size(); conf++ ) {
+    if ( !evaluated.at(conf) ) {
+      index = conf;
+      return true;
+    }
+  }
+  return false;
+}
+
+snrRandomSearch::snrRandomSearch(const std::vector<snrConf> & configurations, const unsigned int seed) : snrSearch(configurations, seed) {}
+
+snrRandomSearch::~snrRandomSearch() {}
+
+bool snrRandomSearch::select(unsigned int & index) {
+  index = getRandomCandidate();
+  return true;
+}
+
+snrAnnealingSearch::snrAnnealingSearch(const std::vector<snrConf> & configurations, const unsigned int seed, const double temperature, const double cooling) : snrSearch(configurations, seed), temperature(temperature), cooling(cooling), started(false), current(0), currentPerformance(0.0) {}
+
+snrAnnealingSearch::~snrAnnealingSearch() {}
+
+bool snrAnnealingSearch::select(unsigned int & index) {
+  if ( !started ) {
+    index = getRandomCandidate();
+    return true;
+  }
+  // Closest configurations not evaluated yet, the radius grows when the neighbourhood is exhausted
+  for ( unsigned int radius = 1; ; radius++ ) {
+    std::vector<unsigned int> candidates = getCandidates(current, radius);
+
+    if ( !candidates.empty() ) {
+      index = candidates.at(std::uniform_int_distribution<unsigned int>(0, candidates.size() - 1)(generator));
+      return true;
+    }
+  }
+}
+
+void snrAnnealingSearch::update(const unsigned int index, const double performance) {
+  if ( !started || performance > currentPerformance ) {
+    started = true;
+    current = index;
+    currentPerformance = performance;
+  } else if ( temperature > 0.0 && currentPerformance > 0.0 ) {
+    double probability = std::exp((performance - currentPerformance) / (temperature * currentPerformance));
+
+    if ( std::uniform_real_distribution<double>(0.0, 1.0)(generator) < probability ) {
+      current = index;
+      currentPerformance = performance;
+    }
+  }
+  temperature *= cooling;
+}
+
+snrModelSearch::snrModelSearch(const std::vector<snrConf> & configurations, const unsigned int seed, const unsigned int nrSamples) : snrSearch(configurations, seed), nrSamples(nrSamples) {}
+
+snrModelSearch::~snrModelSearch() {}
+
+bool snrModelSearch::select(unsigned int & index) {
+  double bestPrediction = -1.0;
+
+  if ( getNrEvaluations() < nrSamples ) {
+    index = getRandomCandidate();
+    return true;
+  }
+  for ( unsigned int conf = 0; conf < configurations.size(); conf++ ) {
+    if ( evaluated.at(conf) ) {
+      continue;
+    }
+    double prediction = predict(conf);
+
+    if ( prediction > bestPrediction ) {
+      bestPrediction = prediction;
+      index = conf;
+    }
+  }
+  return true;
+}
+
+double snrModelSearch::predict(const unsigned int index) const {
+  double weights = 0.0;
+  double prediction = 0.0;
+
+  for ( unsigned int conf = 0; conf < configurations.size(); conf++ ) {
+    if ( !evaluated.at(conf) ) {
+      continue;
+    }
+    double distance = getDistance(index, conf);
+    double weight = 1.0 / (distance * distance);
+
+    weights += weight;
+    prediction += weight * performance.at(conf);
+  }
+  if ( weights == 0.0 ) {
+    return 0.0;
+  }
+  return prediction / weights;
+}
+
+snrSearch * getSNRSearch(const std::string & strategy, const std::vector<snrConf> & configurations, const unsigned int seed) {
+  if ( strategy == "exhaustive" ) {
+    return new snrExhaustiveSearch(configurations, seed);
+  } else if ( strategy == "random" ) {
+    return new snrRandomSearch(configurations, seed);
+  } else if ( strategy == "hill_climbing" ) {
+    return new snrAnnealingSearch(configurations, seed, 0.0, 1.0);
+  } else if ( strategy == "annealing" ) {
+    return new snrAnnealingSearch(configurations, seed, 0.1, 0.95);
+  } else if ( strategy == "model" ) {
+    return new snrModelSearch(configurations, seed, std::max(static_cast<unsigned int>(4), static_cast<unsigned int>(configurations.size() / 20)));
+  }
+  return 0;
+}
+
+} // SNR
+
@@ -0,0 +1,134 @@
+// Copyright 2017 Netherlands Institute for Radio Astronomy (ASTRON)
+// Copyright 2017 Netherlands eScience Center
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+
+#include <SNRStreaming.hpp>
+
+namespace SNR {
+
+snrStreamingDriver::snrStreamingDriver(cl::Context & context, cl::Device & device, const unsigned int nrBuffers) : context(context), device(device), writeQueue(context, device), kernelQueue(context, device), readQueue(context, device), kernel(0), sets(std::max(nrBuffers, 1u)), inputSize(0), outputSNRSize(0), outputSampleSize(0), nrBatches(0), stop(false), completion(&snrStreamingDriver::complete, this) {
+  for ( auto set = sets.begin(); set != sets.end(); ++set ) {
+    set->used = false;
+  }
+}
+
+snrStreamingDriver::~snrStreamingDriver() {
+  {
+    std::lock_guard<std::mutex> lock(pendingMutex);
+
+    stop = true;
+  }
+  pendingCondition.notify_all();
+  completion.join();
+  delete kernel;
+}
+
+void snrStreamingDriver::finish() {
+  std::unique_lock<std::mutex> lock(pendingMutex);
+
+  pendingCondition.wait(lock, [this]() { return pending.empty(); });
+  if ( error ) {
+    std::exception_ptr failure = error;
+
+    error = nullptr;
+    std::rethrow_exception(failure);
+  }
+}
+
+void snrStreamingDriver::allocate() {
+  for ( auto set = sets.begin(); set != sets.end(); ++set ) {
+    set->input_d = cl::Buffer(context, CL_MEM_READ_ONLY, inputSize, 0, 0);
+    set->outputSNR_d = cl::Buffer(context, CL_MEM_WRITE_ONLY, outputSNRSize, 0, 0);
+    set->outputSample_d = cl::Buffer(context, CL_MEM_WRITE_ONLY, outputSampleSize, 0, 0);
+    set->used = false;
+  }
+}
+
+void snrStreamingDriver::acquire(bufferSet & set) {
+  if ( set.used ) {
+    set.done.wait();
+  }
+  std::lock_guard<std::mutex> lock(pendingMutex);
+
+  if ( error ) {
+    std::exception_ptr failure = error;
+
+    error = nullptr;
+    std::rethrow_exception(failure);
+  }
+}
+
+void snrStreamingDriver::submit(bufferSet & set, const void * input, float * outputSNR, unsigned int * outputSample) {
+  std::vector<cl::Event> written(1);
+  std::vector<cl::Event> computed(1);
+
+  writeQueue.enqueueWriteBuffer(set.input_d, CL_FALSE, 0, inputSize, input, 0, &written.at(0));
+  kernel->setArg(0, set.input_d);
+  kernel->setArg(1, set.outputSNR_d);
+  kernel->setArg(2, set.outputSample_d);
+  kernelQueue.enqueueNDRangeKernel(*kernel, cl::NullRange, global, local, &written, &computed.at(0));
+  readQueue.enqueueReadBuffer(set.outputSNR_d, CL_FALSE, 0, outputSNRSize, reinterpret_cast<void *>(outputSNR), &computed, 0);
+  // The queue is in order, so the last transfer completes the batch
+  readQueue.enqueueReadBuffer(set.outputSample_d, CL_FALSE, 0, outputSampleSize, reinterpret_cast<void *>(outputSample), &computed, &set.done);
+  writeQueue.flush();
+  kernelQueue.flush();
+  readQueue.flush();
+  set.used = true;
+  {
+    std::lock_guard<std::mutex> lock(pendingMutex);
+
+    pending.push_back(std::make_pair(nrBatches, set.done));
+  }
+  pendingCondition.notify_all();
+}
+
+void snrStreamingDriver::complete() {
+  while ( true ) {
+    std::pair<uint64_t, cl::Event> batch;
+
+    {
+      std::unique_lock<std::mutex> lock(pendingMutex);
+
+      pendingCondition.wait(lock, [this]() { return stop || !pending.empty(); });
+      if ( pending.empty() ) {
+        return;
+      }
+      batch = pending.front();
+    }
+    try {
+      batch.second.wait();
+      if ( function ) {
+        function(batch.first);
+      }
+    } catch ( ... ) {
+      std::lock_guard<std::mutex> lock(pendingMutex);
+
+      if ( !error ) {
+        error = std::current_exception();
+      }
+    }
+    // The batch is removed after its callback, so that finish also waits for the callbacks
+    {
+      std::lock_guard<std::mutex> lock(pendingMutex);
+
+      pending.pop_front();
+    }
+    pendingCondition.notify_all();
+  }
+}
+
+} // SNR
+
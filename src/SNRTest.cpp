@@ -21,6 +21,9 @@
 #include <iomanip>
 #include <limits>
 #include <ctime>
+#include <cmath>
+#include <algorithm>
+#include <functional>
 
 #include <configuration.hpp>
 
@@ -30,13 +33,53 @@
 #include <Kernel.hpp>
 #include <utils.hpp>
 #include <SNR.hpp>
+#include <SNRCPU.hpp>
+#include <SNRMultiDevice.hpp>
+#include <SNRStreaming.hpp>
 #include <Stats.hpp>
 
 
+// Check the dense kernel with every configuration of threadsD0 in [minThreads, maxThreads] and itemsD0 up to maxItems, against the native CPU code on all the host cores
+// The other fields of conf are used as they are; returns the number of failed configurations
+unsigned int sweep(const bool DMsSamples, SNR::snrConf conf, const AstroData::Observation & observation, const unsigned int padding, const unsigned int minThreads, const unsigned int maxThreads, const unsigned int maxItems, const bool printCode, const std::vector< inputDataType > & input, cl::Context & clContext, cl::Device & clDevice, cl::CommandQueue & clQueue, cl::Buffer & input_d);
+
+
 int main(int argc, char *argv[]) {
   bool printCode = false;
   bool printResults = false;
   bool DMsSamples = false;
+  bool cpu = false;
+  bool thresholdMode = false;
+  bool topKMode = false;
+  float snrThreshold = 0.0f;
+  unsigned int maxCandidates = 0;
+  unsigned int nrTopCandidates = 0;
+  bool boxcarMode = false;
+  std::vector< unsigned int > widths;
+  bool sigmaClipMode = false;
+  unsigned int nrClipIterations = 0;
+  float sigma = 0.0f;
+  bool streamingMode = false;
+  bool timeSeriesMode = false;
+  bool runtimeMode = false;
+  bool scaledMode = false;
+  bool multiDeviceMode = false;
+  bool numaMode = false;
+  std::vector< unsigned int > deviceIDs;
+  unsigned int nrBeamsPerChunk = 1;
+  bool asyncMode = false;
+  unsigned int nrBuffers = 1;
+  bool slicedMode = false;
+  bool hierarchicalMode = false;
+  bool fullOutput = true;
+  bool transposeMode = false;
+  bool kernelDMsSamples = false;
+  bool sweepMode = false;
+  unsigned int minThreads = 0;
+  unsigned int maxThreads = 0;
+  unsigned int maxItems = 0;
+  unsigned int nrBatches = 1;
+  float decay = 1.0f;
   unsigned int padding = 0;
   unsigned int clPlatformID = 0;
   unsigned int clDeviceID = 0;
@@ -55,12 +98,161 @@ int main(int argc, char *argv[]) {
     }
     printCode = args.getSwitch("-print_code");
     printResults = args.getSwitch("-print_results");
-    clPlatformID = args.getSwitchArgument< unsigned int >("-opencl_platform");
-    clDeviceID = args.getSwitchArgument< unsigned int >("-opencl_device");
+    cpu = args.getSwitch("-cpu");
+    if ( !cpu ) {
+      clPlatformID = args.getSwitchArgument< unsigned int >("-opencl_platform");
+      clDeviceID = args.getSwitchArgument< unsigned int >("-opencl_device");
+    }
+    thresholdMode = args.getSwitch("-threshold");
+    if ( thresholdMode ) {
+      snrThreshold = args.getSwitchArgument< float >("-snr");
+      maxCandidates = args.getSwitchArgument< unsigned int >("-max_candidates");
+    }
+    topKMode = args.getSwitch("-top_k");
+    if ( topKMode ) {
+      nrTopCandidates = args.getSwitchArgument< unsigned int >("-candidates");
+    }
+    boxcarMode = args.getSwitch("-boxcar");
+    if ( boxcarMode ) {
+      std::string widths_s = args.getSwitchArgument< std::string >("-widths");
+      std::string::size_type splitPoint = 0;
+
+      while ( (splitPoint = widths_s.find(",")) != std::string::npos ) {
+        widths.push_back(isa::utils::castToType< std::string, unsigned int >(widths_s.substr(0, splitPoint)));
+        widths_s = widths_s.substr(splitPoint + 1);
+      }
+      widths.push_back(isa::utils::castToType< std::string, unsigned int >(widths_s));
+      std::sort(widths.begin(), widths.end());
+      widths.erase(std::unique(widths.begin(), widths.end()), widths.end());
+    }
+    sigmaClipMode = args.getSwitch("-sigma_clip");
+    if ( sigmaClipMode ) {
+      sigma = args.getSwitchArgument< float >("-sigma");
+      nrClipIterations = args.getSwitchArgument< unsigned int >("-iterations");
+    }
+    streamingMode = args.getSwitch("-streaming");
+    if ( streamingMode ) {
+      nrBatches = args.getSwitchArgument< unsigned int >("-batches");
+      decay = args.getSwitchArgument< float >("-decay");
+      timeSeriesMode = args.getSwitch("-time_series");
+    }
+    runtimeMode = args.getSwitch("-runtime");
+    scaledMode = args.getSwitch("-scaled");
+    multiDeviceMode = args.getSwitch("-multi_device");
+    if ( multiDeviceMode ) {
+      numaMode = args.getSwitch("-numa");
+      if ( !numaMode ) {
+        std::string devices_s = args.getSwitchArgument< std::string >("-devices");
+        std::string::size_type splitPoint = 0;
+
+        while ( (splitPoint = devices_s.find(",")) != std::string::npos ) {
+          deviceIDs.push_back(isa::utils::castToType< std::string, unsigned int >(devices_s.substr(0, splitPoint)));
+          devices_s = devices_s.substr(splitPoint + 1);
+        }
+        deviceIDs.push_back(isa::utils::castToType< std::string, unsigned int >(devices_s));
+      }
+      nrBeamsPerChunk = args.getSwitchArgument< unsigned int >("-chunk_beams");
+    }
+    asyncMode = args.getSwitch("-async");
+    if ( asyncMode ) {
+      nrBuffers = args.getSwitchArgument< unsigned int >("-buffers");
+      nrBatches = args.getSwitchArgument< unsigned int >("-batches");
+    }
+    slicedMode = args.getSwitch("-sliced");
+    if ( slicedMode ) {
+      conf.setNrSlices(args.getSwitchArgument< unsigned int >("-slices"));
+    }
+    hierarchicalMode = args.getSwitch("-hierarchical");
+    if ( hierarchicalMode ) {
+      fullOutput = !args.getSwitch("-no_full_output");
+    }
+    transposeMode = args.getSwitch("-transpose");
+    if ( transposeMode ) {
+      conf.setTransposeTile(args.getSwitchArgument< unsigned int >("-tile"));
+    }
+    sweepMode = args.getSwitch("-sweep");
+    if ( sweepMode ) {
+      minThreads = args.getSwitchArgument< unsigned int >("-min_threads");
+      maxThreads = args.getSwitchArgument< unsigned int >("-max_threads");
+      maxItems = args.getSwitchArgument< unsigned int >("-max_items");
+    }
+    // With -transpose the input is in the layout of the switches, and the kernel in the other one
+    kernelDMsSamples = DMsSamples != transposeMode;
+    if ( cpu && (thresholdMode || topKMode || boxcarMode || sigmaClipMode || streamingMode || runtimeMode || scaledMode) ) {
+      std::cerr << "-threshold, -top_k, -boxcar, -sigma_clip, -streaming, -runtime and -scaled are only available for OpenCL." << std::endl;
+      return 1;
+    } else if ( (thresholdMode + topKMode + boxcarMode + sigmaClipMode + streamingMode + runtimeMode) > 1 ) {
+      std::cerr << "-threshold, -top_k, -boxcar, -sigma_clip, -streaming and -runtime are mutually exclusive." << std::endl;
+      return 1;
+    } else if ( multiDeviceMode && (cpu || thresholdMode || topKMode || boxcarMode || sigmaClipMode || streamingMode || runtimeMode || scaledMode) ) {
+      std::cerr << "-multi_device is only available for the dense OpenCL kernel." << std::endl;
+      return 1;
+    } else if ( asyncMode && (cpu || thresholdMode || topKMode || boxcarMode || sigmaClipMode || streamingMode || runtimeMode || scaledMode || multiDeviceMode) ) {
+      std::cerr << "-async is only available for the dense OpenCL kernel." << std::endl;
+      return 1;
+    } else if ( scaledMode && (thresholdMode || topKMode || boxcarMode || sigmaClipMode || timeSeriesMode || runtimeMode) ) {
+      std::cerr << "-scaled can only be combined with -streaming." << std::endl;
+      return 1;
+    } else if ( slicedMode && (DMsSamples || cpu || thresholdMode || boxcarMode || sigmaClipMode || streamingMode || runtimeMode || scaledMode || multiDeviceMode || asyncMode) ) {
+      std::cerr << "-sliced is only available for the dense OpenCL kernel with -samples_dms." << std::endl;
+      return 1;
+    } else if ( hierarchicalMode && (cpu || thresholdMode || topKMode || boxcarMode || sigmaClipMode || streamingMode || runtimeMode || scaledMode || multiDeviceMode || asyncMode || slicedMode) ) {
+      std::cerr << "-hierarchical is only available for the dense OpenCL kernel." << std::endl;
+      return 1;
+    } else if ( transposeMode && (cpu || thresholdMode || topKMode || boxcarMode || sigmaClipMode || streamingMode || runtimeMode || scaledMode || multiDeviceMode || asyncMode || slicedMode || hierarchicalMode) ) {
+      std::cerr << "-transpose is only available for the dense OpenCL kernel." << std::endl;
+      return 1;
+    } else if ( sweepMode && (cpu || thresholdMode || topKMode || boxcarMode || sigmaClipMode || streamingMode || runtimeMode || scaledMode || multiDeviceMode || asyncMode || slicedMode || hierarchicalMode || transposeMode) ) {
+      std::cerr << "-sweep is only available for the dense OpenCL kernel." << std::endl;
+      return 1;
+    } else if ( sweepMode && (minThreads == 0 || maxThreads < minThreads || maxItems == 0) ) {
+      std::cerr << "-min_threads and -max_items must be larger than zero, and -max_threads at least -min_threads." << std::endl;
+      return 1;
+    } else if ( transposeMode && conf.getTransposeTile() == 0 ) {
+      std::cerr << "-tile must be larger than zero." << std::endl;
+      return 1;
+    } else if ( timeSeriesMode && DMsSamples ) {
+      std::cerr << "-time_series requires -samples_dms." << std::endl;
+      return 1;
+    } else if ( boxcarMode && !DMsSamples ) {
+      std::cerr << "-boxcar requires -dms_samples." << std::endl;
+      return 1;
+    }
     padding = args.getSwitchArgument< unsigned int >("-padding");
-    conf.setNrThreadsD0(args.getSwitchArgument< unsigned int >("-threadsD0"));
-    conf.setNrItemsD0(args.getSwitchArgument< unsigned int >("-itemsD0"));
+    if ( !sweepMode ) {
+      conf.setNrThreadsD0(args.getSwitchArgument< unsigned int >("-threadsD0"));
+      conf.setNrItemsD0(args.getSwitchArgument< unsigned int >("-itemsD0"));
+    }
     conf.setSubbandDedispersion(args.getSwitch("-subband"));
+    conf.setSubgroupReduction(args.getSwitch("-subgroup"));
+    if ( conf.getSubgroupReduction() && (cpu || (!kernelDMsSamples && !timeSeriesMode) || boxcarMode || sigmaClipMode || runtimeMode) ) {
+      std::cerr << "-subgroup requires OpenCL and -dms_samples or -time_series, and is not available with -boxcar, -sigma_clip and -runtime." << std::endl;
+      return 1;
+    }
+    if ( args.getSwitch("-vector") ) {
+      conf.setVectorWidth(args.getSwitchArgument< unsigned int >("-width"));
+      if ( cpu || boxcarMode || sigmaClipMode || runtimeMode || timeSeriesMode || slicedMode ) {
+        std::cerr << "-vector requires OpenCL, and is not available with -boxcar, -sigma_clip, -runtime, -time_series and -sliced." << std::endl;
+        return 1;
+      } else if ( (conf.getVectorWidth() != 2 && conf.getVectorWidth() != 4 && conf.getVectorWidth() != 8) || (!sweepMode && (conf.getNrItemsD0() % conf.getVectorWidth()) != 0) ) {
+        std::cerr << "-width must be 2, 4 or 8, and divide -itemsD0; with -sweep only the items divided by -width are checked." << std::endl;
+        return 1;
+      }
+    }
+    if ( args.getSwitch("-dm_rows") ) {
+      conf.setNrThreadsD1(args.getSwitchArgument< unsigned int >("-threadsD1"));
+      conf.setNrItemsD1(args.getSwitchArgument< unsigned int >("-itemsD1"));
+      if ( cpu || !kernelDMsSamples || boxcarMode || sigmaClipMode || runtimeMode ) {
+        std::cerr << "-dm_rows requires OpenCL and -dms_samples, and is not available with -boxcar, -sigma_clip and -runtime." << std::endl;
+        return 1;
+      } else if ( conf.getNrThreadsD1() == 0 || conf.getNrItemsD1() == 0 ) {
+        std::cerr << "-threadsD1 and -itemsD1 must be larger than zero." << std::endl;
+        return 1;
+      } else if ( conf.getSubgroupReduction() && conf.getNrThreadsD1() > 1 ) {
+        std::cerr << "-subgroup requires -threadsD1 1." << std::endl;
+        return 1;
+      }
+    }
     observation.setNrSynthesizedBeams(args.getSwitchArgument< unsigned int >("-beams"));
     observation.setNrSamplesPerBatch(args.getSwitchArgument< unsigned int >("-samples"));
     if ( conf.getSubbandDedispersion() ) {
@@ -69,12 +261,40 @@ int main(int argc, char *argv[]) {
       observation.setDMRange(1, 0.0f, 0.0f, true);
     }
     observation.setDMRange(args.getSwitchArgument< unsigned int >("-dms"), 0.0, 0.0);
+    if ( boxcarMode && (widths.front() == 0 || widths.back() > observation.getNrSamplesPerBatch()) ) {
+      std::cerr << "-widths must be between 1 and the number of samples." << std::endl;
+      return 1;
+    } else if ( slicedMode && (conf.getNrSlices() == 0 || conf.getNrSlices() > observation.getNrSamplesPerBatch()) ) {
+      std::cerr << "-slices must be between 1 and the number of samples." << std::endl;
+      return 1;
+    } else if ( kernelDMsSamples && (observation.getNrSamplesPerBatch() % conf.getVectorWidth()) != 0 ) {
+      std::cerr << "-width must divide the number of samples with -dms_samples." << std::endl;
+      return 1;
+    } else if ( ((observation.getNrDMs(true) * observation.getNrDMs()) % (conf.getNrThreadsD1() * conf.getNrItemsD1())) != 0 ) {
+      std::cerr << "-threadsD1 * -itemsD1 must divide the number of DMs." << std::endl;
+      return 1;
+    }
   } catch  ( isa::utils::SwitchNotFound & err ) {
     std::cerr << err.what() << std::endl;
     return 1;
   } catch ( std::exception &err ) {
-    std::cerr << "Usage: " << argv[0] << " [-dms_samples | -samples_dms] [-print_code] [-print_results] -opencl_platform ... -opencl_device ... -padding ... -threadsD0 ... -itemsD0 ... [-subband] -beams ... -dms ... -samples ..." << std::endl;
+    std::cerr << "Usage: " << argv[0] << " [-dms_samples | -samples_dms] [-print_code] [-print_results] [-cpu | -opencl_platform ... -opencl_device ...] [-threshold | -top_k | -boxcar | -sigma_clip | -streaming | -runtime] [-scaled] [-multi_device | -async | -sliced | -hierarchical | -transpose] [-sweep] -padding ... -threadsD0 ... -itemsD0 ... [-subband] [-subgroup] [-vector] [-dm_rows] -beams ... -dms ... -samples ..." << std::endl;
     std::cerr << "\t -subband : -subbanding_dms ..." << std::endl;
+    std::cerr << "\t -cpu : -threadsD0 is the number of host threads" << std::endl;
+    std::cerr << "\t -threshold : -snr ... -max_candidates ..." << std::endl;
+    std::cerr << "\t -top_k : -candidates ..." << std::endl;
+    std::cerr << "\t -boxcar : -widths ... (comma separated list)" << std::endl;
+    std::cerr << "\t -sigma_clip : -sigma ... -iterations ..." << std::endl;
+    std::cerr << "\t -streaming : -batches ... -decay ... [-time_series]" << std::endl;
+    std::cerr << "\t -scaled : only alone or with -streaming" << std::endl;
+    std::cerr << "\t -multi_device : [-numa | -devices ... (comma separated list)] -chunk_beams ..." << std::endl;
+    std::cerr << "\t -async : -buffers ... -batches ..." << std::endl;
+    std::cerr << "\t -sliced : -slices ..." << std::endl;
+    std::cerr << "\t -hierarchical : [-no_full_output]" << std::endl;
+    std::cerr << "\t -transpose : -tile ... (the kernel runs in the other layout)" << std::endl;
+    std::cerr << "\t -sweep : -min_threads ... -max_threads ... -max_items ... instead of -threadsD0 and -itemsD0" << std::endl;
+    std::cerr << "\t -vector : -width ..." << std::endl;
+    std::cerr << "\t -dm_rows : -threadsD1 ... -itemsD1 ..." << std::endl;
     return 1;
   }
 
@@ -84,13 +304,28 @@ int main(int argc, char *argv[]) {
   std::vector< cl::Device > * clDevices = new std::vector< cl::Device >();
   std::vector< std::vector< cl::CommandQueue > > * clQueues = new std::vector< std::vector < cl::CommandQueue > >();
 
-  isa::OpenCL::initializeOpenCL(clPlatformID, 1, clPlatforms, clContext, clDevices, clQueues);
+  if ( !cpu ) {
+    isa::OpenCL::initializeOpenCL(clPlatformID, 1, clPlatforms, clContext, clDevices, clQueues);
+    if ( !SNR::isSupportedSNRConf(conf, clDevices->at(clDeviceID)) ) {
+      std::cerr << "-subgroup requires a device with cl_khr_subgroups." << std::endl;
+      return 1;
+    }
+  }
 
   // Allocate memory
   std::vector< inputDataType > input;
   std::vector< float > outputSNR;
   std::vector< unsigned int > outputSample;
-  cl::Buffer input_d, outputSNR_d, outputSample_d;
+  std::vector< unsigned int > outputWidth;
+  std::vector< float > state;
+  std::vector< uint64_t > timeSeries;
+  std::vector< uint64_t > bestSubbandDM;
+  std::vector< uint64_t > bestBeam;
+  std::vector< SNR::snrCandidate > candidates;
+  std::vector< float > scale;
+  std::vector< float > offset;
+  unsigned int nrCandidates = 0;
+  cl::Buffer input_d, outputSNR_d, outputSample_d, outputWidth_d, state_d, timeSeries_d, candidates_d, nrCandidates_d, scale_d, offset_d, partials_d, partialSamples_d, bestSubbandDM_d, bestBeam_d, transposed_d;
   if ( DMsSamples ) {
     input.resize(observation.getNrSynthesizedBeams() * observation.getNrDMs(true) * observation.getNrDMs() * observation.getNrSamplesPerBatch(false, padding / sizeof(inputDataType)));
   } else {
@@ -98,10 +333,64 @@ int main(int argc, char *argv[]) {
   }
   outputSNR.resize(observation.getNrSynthesizedBeams() * isa::utils::pad(observation.getNrDMs(true) * observation.getNrDMs(), padding / sizeof(float)));
   outputSample.resize(observation.getNrSynthesizedBeams() * isa::utils::pad(observation.getNrDMs(true) * observation.getNrDMs(), padding / sizeof(unsigned int)));
+  if ( boxcarMode ) {
+    outputWidth.resize(outputSample.size());
+  }
+  if ( streamingMode ) {
+    state.resize(observation.getNrSynthesizedBeams() * observation.getNrDMs(true) * observation.getNrDMs() * 4);
+  }
+  if ( timeSeriesMode ) {
+    timeSeries.resize(observation.getNrSynthesizedBeams() * observation.getNrSamplesPerBatch(false, padding / sizeof(uint64_t)));
+  }
+  if ( hierarchicalMode ) {
+    bestSubbandDM.resize(observation.getNrSynthesizedBeams() * isa::utils::pad(observation.getNrDMs(true), padding / sizeof(uint64_t)));
+    bestBeam.resize(observation.getNrSynthesizedBeams());
+  }
+  if ( scaledMode ) {
+    scale.resize(observation.getNrDMs(true) * observation.getNrDMs());
+    offset.resize(scale.size());
+  }
+  if ( thresholdMode ) {
+    candidates.resize(maxCandidates);
+  } else if ( topKMode ) {
+    candidates.resize(observation.getNrSynthesizedBeams() * nrTopCandidates);
+  }
   try {
-    input_d = cl::Buffer(*clContext, CL_MEM_READ_WRITE, input.size() * sizeof(inputDataType), 0, 0);
-    outputSNR_d = cl::Buffer(*clContext, CL_MEM_WRITE_ONLY, outputSNR.size() * sizeof(float), 0, 0);
-    outputSample_d = cl::Buffer(*clContext, CL_MEM_WRITE_ONLY, outputSample.size() * sizeof(unsigned int), 0, 0);
+    if ( !cpu ) {
+      input_d = cl::Buffer(*clContext, CL_MEM_READ_WRITE, input.size() * sizeof(inputDataType), 0, 0);
+      outputSNR_d = cl::Buffer(*clContext, CL_MEM_READ_WRITE, outputSNR.size() * sizeof(float), 0, 0);
+      outputSample_d = cl::Buffer(*clContext, CL_MEM_READ_WRITE, outputSample.size() * sizeof(unsigned int), 0, 0);
+    }
+    if ( boxcarMode ) {
+      outputWidth_d = cl::Buffer(*clContext, CL_MEM_WRITE_ONLY, outputWidth.size() * sizeof(unsigned int), 0, 0);
+    }
+    if ( streamingMode ) {
+      state_d = cl::Buffer(*clContext, CL_MEM_READ_WRITE, state.size() * sizeof(float), 0, 0);
+    }
+    if ( timeSeriesMode ) {
+      timeSeries_d = cl::Buffer(*clContext, CL_MEM_READ_WRITE, timeSeries.size() * sizeof(uint64_t), 0, 0);
+    }
+    if ( scaledMode ) {
+      scale_d = cl::Buffer(*clContext, CL_MEM_READ_ONLY, scale.size() * sizeof(float), 0, 0);
+      offset_d = cl::Buffer(*clContext, CL_MEM_READ_ONLY, offset.size() * sizeof(float), 0, 0);
+    }
+    if ( slicedMode ) {
+      partials_d = cl::Buffer(*clContext, CL_MEM_READ_WRITE, observation.getNrSynthesizedBeams() * conf.getNrSlices() * observation.getNrDMs(true) * observation.getNrDMs() * 4 * sizeof(float), 0, 0);
+      partialSamples_d = cl::Buffer(*clContext, CL_MEM_READ_WRITE, observation.getNrSynthesizedBeams() * conf.getNrSlices() * observation.getNrDMs(true) * observation.getNrDMs() * sizeof(unsigned int), 0, 0);
+    }
+    if ( transposeMode && DMsSamples ) {
+      transposed_d = cl::Buffer(*clContext, CL_MEM_READ_WRITE, observation.getNrSynthesizedBeams() * observation.getNrSamplesPerBatch() * isa::utils::pad(observation.getNrDMs(true) * observation.getNrDMs(), padding / sizeof(inputDataType)) * sizeof(inputDataType), 0, 0);
+    } else if ( transposeMode ) {
+      transposed_d = cl::Buffer(*clContext, CL_MEM_READ_WRITE, observation.getNrSynthesizedBeams() * observation.getNrDMs(true) * observation.getNrDMs() * observation.getNrSamplesPerBatch(false, padding / sizeof(inputDataType)) * sizeof(inputDataType), 0, 0);
+    }
+    if ( hierarchicalMode ) {
+      bestSubbandDM_d = cl::Buffer(*clContext, CL_MEM_READ_WRITE, bestSubbandDM.size() * sizeof(uint64_t), 0, 0);
+      bestBeam_d = cl::Buffer(*clContext, CL_MEM_READ_WRITE, bestBeam.size() * sizeof(uint64_t), 0, 0);
+    }
+    if ( thresholdMode || topKMode ) {
+      candidates_d = cl::Buffer(*clContext, CL_MEM_WRITE_ONLY, candidates.size() * sizeof(SNR::snrCandidate), 0, 0);
+      nrCandidates_d = cl::Buffer(*clContext, CL_MEM_READ_WRITE, sizeof(unsigned int), 0, 0);
+    }
   } catch ( cl::Error &err ) {
     std::cerr << "OpenCL error allocating memory: " << std::to_string(err.err()) << "." << std::endl;
     return 1;
@@ -114,6 +403,10 @@ int main(int argc, char *argv[]) {
   for ( auto item = maxSample.begin(); item != maxSample.end(); ++item ) {
     *item = rand() % observation.getNrSamplesPerBatch();
   }
+  for ( unsigned int dm = 0; dm < scale.size(); dm++ ) {
+    scale[dm] = 0.5f + ((rand() % 100) / 50.0f);
+    offset[dm] = (rand() % 200) - 100.0f;
+  }
   for ( unsigned int beam = 0; beam < observation.getNrSynthesizedBeams(); beam++ ) {
     if ( printResults ) {
       std::cout << "Beam: " << beam << std::endl;
@@ -131,7 +424,7 @@ int main(int argc, char *argv[]) {
               input[(beam * observation.getNrDMs(true) * observation.getNrDMs() * observation.getNrSamplesPerBatch(false, padding / sizeof(inputDataType))) + (subbandDM * observation.getNrDMs() * observation.getNrSamplesPerBatch(false, padding / sizeof(inputDataType))) + (dm * observation.getNrSamplesPerBatch(false, padding / sizeof(inputDataType))) + sample] = static_cast< inputDataType >(rand() % 10);
             }
             if ( printResults ) {
-              std::cout << input[(beam * observation.getNrDMs(true) * observation.getNrDMs() * observation.getNrSamplesPerBatch(false, padding / sizeof(inputDataType))) + (subbandDM * observation.getNrDMs() * observation.getNrSamplesPerBatch(false, padding / sizeof(inputDataType))) + (dm * observation.getNrSamplesPerBatch(false, padding / sizeof(inputDataType))) + sample] << " ";
+              std::cout << static_cast< float >(input[(beam * observation.getNrDMs(true) * observation.getNrDMs() * observation.getNrSamplesPerBatch(false, padding / sizeof(inputDataType))) + (subbandDM * observation.getNrDMs() * observation.getNrSamplesPerBatch(false, padding / sizeof(inputDataType))) + (dm * observation.getNrSamplesPerBatch(false, padding / sizeof(inputDataType))) + sample]) << " ";
             }
           }
           if ( printResults ) {
@@ -152,7 +445,7 @@ int main(int argc, char *argv[]) {
               input[(beam * observation.getNrSamplesPerBatch() * observation.getNrDMs(true) * observation.getNrDMs(false, padding / sizeof(inputDataType))) + (sample * observation.getNrDMs(true) * observation.getNrDMs(false, padding / sizeof(inputDataType))) + (subbandDM * observation.getNrDMs(false, padding / sizeof(inputDataType))) + dm] = static_cast< inputDataType >(rand() % 10);
             }
             if ( printResults ) {
-              std::cout << input[(beam * observation.getNrSamplesPerBatch() * observation.getNrDMs(true) * observation.getNrDMs(false, padding / sizeof(inputDataType))) + (sample * observation.getNrDMs(true) * observation.getNrDMs(false, padding / sizeof(inputDataType))) + (subbandDM * observation.getNrDMs(false, padding / sizeof(inputDataType))) + dm] << " ";
+              std::cout << static_cast< float >(input[(beam * observation.getNrSamplesPerBatch() * observation.getNrDMs(true) * observation.getNrDMs(false, padding / sizeof(inputDataType))) + (sample * observation.getNrDMs(true) * observation.getNrDMs(false, padding / sizeof(inputDataType))) + (subbandDM * observation.getNrDMs(false, padding / sizeof(inputDataType))) + dm]) << " ";
             }
           }
           if ( printResults ) {
@@ -168,71 +461,386 @@ int main(int argc, char *argv[]) {
 
   // Copy data structures to device
   try {
-    clQueues->at(clDeviceID)[0].enqueueWriteBuffer(input_d, CL_FALSE, 0, input.size() * sizeof(inputDataType), reinterpret_cast< void * >(input.data()));
+    if ( !cpu ) {
+      clQueues->at(clDeviceID)[0].enqueueWriteBuffer(input_d, CL_FALSE, 0, input.size() * sizeof(inputDataType), reinterpret_cast< void * >(input.data()));
+    }
+    if ( streamingMode ) {
+      clQueues->at(clDeviceID)[0].enqueueWriteBuffer(state_d, CL_FALSE, 0, state.size() * sizeof(float), reinterpret_cast< void * >(state.data()));
+    }
+    if ( scaledMode ) {
+      clQueues->at(clDeviceID)[0].enqueueWriteBuffer(scale_d, CL_FALSE, 0, scale.size() * sizeof(float), reinterpret_cast< void * >(scale.data()));
+      clQueues->at(clDeviceID)[0].enqueueWriteBuffer(offset_d, CL_FALSE, 0, offset.size() * sizeof(float), reinterpret_cast< void * >(offset.data()));
+    }
+    if ( thresholdMode ) {
+      clQueues->at(clDeviceID)[0].enqueueWriteBuffer(nrCandidates_d, CL_FALSE, 0, sizeof(unsigned int), reinterpret_cast< void * >(&nrCandidates));
+    }
   } catch ( cl::Error &err ) {
     std::cerr << "OpenCL error H2D transfer: " << std::to_string(err.err()) << "." << std::endl;
     return 1;
   }
 
-  // Generate kernel
-  cl::Kernel * kernel;
-  std::string * code;
-  if ( DMsSamples ) {
-    code = SNR::getSNRDMsSamplesOpenCL< inputDataType >(conf, inputDataName, observation, observation.getNrSamplesPerBatch(), padding);
-  } else {
-    code = SNR::getSNRSamplesDMsOpenCL< inputDataType >(conf, inputDataName, observation, observation.getNrSamplesPerBatch(), padding);
-  }
-  if ( printCode ) {
-    std::cout << *code << std::endl;
+  // The input and the reference are computed once for all the configurations
+  if ( sweepMode ) {
+    return (sweep(DMsSamples, conf, observation, padding, minThreads, maxThreads, maxItems, printCode, input, *clContext, clDevices->at(clDeviceID), clQueues->at(clDeviceID)[0], input_d) > 0) ? 1 : 0;
   }
 
-  try {
-    if ( DMsSamples ) {
-      kernel = isa::OpenCL::compile("snrDMsSamples" + std::to_string(observation.getNrSamplesPerBatch()), *code, "-cl-mad-enable -Werror", *clContext, clDevices->at(clDeviceID));
+  // Generate kernel
+  cl::Kernel * kernel = 0;
+  cl::Kernel * topKKernel = 0;
+  cl::Kernel * mergeKernel = 0;
+  cl::Kernel * transposeKernel = 0;
+  if ( !cpu && !multiDeviceMode && !asyncMode ) {
+    std::string * code;
+    if ( thresholdMode && DMsSamples ) {
+      code = SNR::getSNRDMsSamplesThresholdOpenCL< inputDataType >(conf, inputDataName, observation, observation.getNrSamplesPerBatch(), padding, maxCandidates);
+    } else if ( thresholdMode ) {
+      code = SNR::getSNRSamplesDMsThresholdOpenCL< inputDataType >(conf, inputDataName, observation, observation.getNrSamplesPerBatch(), padding, maxCandidates);
+    } else if ( boxcarMode ) {
+      cl_ulong localMemory = 0;
+
+      clDevices->at(clDeviceID).getInfo(CL_DEVICE_LOCAL_MEM_SIZE, &localMemory);
+      try {
+        code = SNR::getSNRDMsSamplesBoxcarOpenCL< inputDataType >(conf, inputDataName, observation, observation.getNrSamplesPerBatch(), padding, widths, localMemory);
+      } catch ( std::invalid_argument & err ) {
+        std::cerr << err.what() << std::endl;
+        return 1;
+      }
+    } else if ( timeSeriesMode ) {
+      cl_ulong localMemory = 0;
+
+      clDevices->at(clDeviceID).getInfo(CL_DEVICE_LOCAL_MEM_SIZE, &localMemory);
+      try {
+        code = SNR::getSNRSamplesDMsTimeSeriesOpenCL< inputDataType >(conf, inputDataName, observation, observation.getNrSamplesPerBatch(), padding, decay, localMemory);
+      } catch ( std::invalid_argument & err ) {
+        std::cerr << err.what() << std::endl;
+        return 1;
+      }
+    } else if ( scaledMode && DMsSamples ) {
+      code = SNR::getSNRDMsSamplesScaledOpenCL< inputDataType >(conf, inputDataName, observation, observation.getNrSamplesPerBatch(), padding, streamingMode, decay);
+    } else if ( scaledMode ) {
+      code = SNR::getSNRSamplesDMsScaledOpenCL< inputDataType >(conf, inputDataName, observation, observation.getNrSamplesPerBatch(), padding, streamingMode, decay);
+    } else if ( streamingMode && DMsSamples ) {
+      code = SNR::getSNRDMsSamplesStreamingOpenCL< inputDataType >(conf, inputDataName, observation, observation.getNrSamplesPerBatch(), padding, decay);
+    } else if ( streamingMode ) {
+      code = SNR::getSNRSamplesDMsStreamingOpenCL< inputDataType >(conf, inputDataName, observation, observation.getNrSamplesPerBatch(), padding, decay);
+    } else if ( sigmaClipMode && DMsSamples ) {
+      code = SNR::getSNRDMsSamplesSigmaClipOpenCL< inputDataType >(conf, inputDataName, observation, observation.getNrSamplesPerBatch(), padding, nrClipIterations, sigma);
+    } else if ( sigmaClipMode ) {
+      code = SNR::getSNRSamplesDMsSigmaClipOpenCL< inputDataType >(conf, inputDataName, observation, observation.getNrSamplesPerBatch(), padding, nrClipIterations, sigma);
+    } else if ( runtimeMode && DMsSamples ) {
+      code = SNR::getSNRDMsSamplesRuntimeOpenCL< inputDataType >(conf, inputDataName, padding);
+    } else if ( runtimeMode ) {
+      code = SNR::getSNRSamplesDMsRuntimeOpenCL< inputDataType >(conf, inputDataName, padding);
+    } else if ( slicedMode ) {
+      code = SNR::getSNRSamplesDMsSlicedOpenCL< inputDataType >(conf, inputDataName, observation, observation.getNrSamplesPerBatch(), padding);
+    } else if ( hierarchicalMode ) {
+      try {
+        if ( DMsSamples ) {
+          code = SNR::getSNRDMsSamplesHierarchicalOpenCL< inputDataType >(conf, inputDataName, observation, observation.getNrSamplesPerBatch(), padding, fullOutput);
+        } else {
+          code = SNR::getSNRSamplesDMsHierarchicalOpenCL< inputDataType >(conf, inputDataName, observation, observation.getNrSamplesPerBatch(), padding, fullOutput);
+        }
+      } catch ( std::invalid_argument & err ) {
+        std::cerr << err.what() << std::endl;
+        return 1;
+      }
+    } else if ( kernelDMsSamples ) {
+      code = SNR::getSNRDMsSamplesOpenCL< inputDataType >(conf, inputDataName, observation, observation.getNrSamplesPerBatch(), padding);
     } else {
-      kernel = isa::OpenCL::compile("snrSamplesDMs" + std::to_string(observation.getNrDMs(true) * observation.getNrDMs()), *code, "-cl-mad-enable -Werror", *clContext, clDevices->at(clDeviceID));
+      code = SNR::getSNRSamplesDMsOpenCL< inputDataType >(conf, inputDataName, observation, observation.getNrSamplesPerBatch(), padding);
+    }
+    if ( printCode ) {
+      std::cout << *code << std::endl;
     }
-  } catch ( isa::OpenCL::OpenCLError & err ) {
-    std::cerr << err.what() << std::endl;
-    return 1;
-  }
 
-  // Run OpenCL kernel and CPU control
-  std::vector< isa::utils::Stats< inputDataType > > control(observation.getNrSynthesizedBeams() * observation.getNrDMs(true) * observation.getNrDMs());
-  try {
-    cl::NDRange global;
-    cl::NDRange local;
+    try {
+      if ( thresholdMode && DMsSamples ) {
+        kernel = isa::OpenCL::compile("snrDMsSamplesThreshold" + std::to_string(observation.getNrSamplesPerBatch()), *code, SNR::getSNRBuildFlags(conf), *clContext, clDevices->at(clDeviceID));
+      } else if ( thresholdMode ) {
+        kernel = isa::OpenCL::compile("snrSamplesDMsThreshold" + std::to_string(observation.getNrDMs(true) * observation.getNrDMs()), *code, SNR::getSNRBuildFlags(conf), *clContext, clDevices->at(clDeviceID));
+      } else if ( boxcarMode ) {
+        kernel = isa::OpenCL::compile("snrDMsSamplesBoxcar" + std::to_string(observation.getNrSamplesPerBatch()), *code, SNR::getSNRBuildFlags(conf), *clContext, clDevices->at(clDeviceID));
+      } else if ( timeSeriesMode ) {
+        kernel = isa::OpenCL::compile("snrSamplesDMsTimeSeries" + std::to_string(observation.getNrDMs(true) * observation.getNrDMs()), *code, SNR::getSNRBuildFlags(conf), *clContext, clDevices->at(clDeviceID));
+      } else if ( scaledMode && DMsSamples ) {
+        kernel = isa::OpenCL::compile("snrDMsSamples" + std::string(streamingMode ? "Streaming" : "") + "Scaled" + std::to_string(observation.getNrSamplesPerBatch()), *code, SNR::getSNRBuildFlags(conf), *clContext, clDevices->at(clDeviceID));
+      } else if ( scaledMode ) {
+        kernel = isa::OpenCL::compile("snrSamplesDMs" + std::string(streamingMode ? "Streaming" : "") + "Scaled" + std::to_string(observation.getNrDMs(true) * observation.getNrDMs()), *code, SNR::getSNRBuildFlags(conf), *clContext, clDevices->at(clDeviceID));
+      } else if ( streamingMode && DMsSamples ) {
+        kernel = isa::OpenCL::compile("snrDMsSamplesStreaming" + std::to_string(observation.getNrSamplesPerBatch()), *code, SNR::getSNRBuildFlags(conf), *clContext, clDevices->at(clDeviceID));
+      } else if ( streamingMode ) {
+        kernel = isa::OpenCL::compile("snrSamplesDMsStreaming" + std::to_string(observation.getNrDMs(true) * observation.getNrDMs()), *code, SNR::getSNRBuildFlags(conf), *clContext, clDevices->at(clDeviceID));
+      } else if ( sigmaClipMode && DMsSamples ) {
+        kernel = isa::OpenCL::compile("snrDMsSamplesSigmaClip" + std::to_string(observation.getNrSamplesPerBatch()), *code, SNR::getSNRBuildFlags(conf), *clContext, clDevices->at(clDeviceID));
+      } else if ( sigmaClipMode ) {
+        kernel = isa::OpenCL::compile("snrSamplesDMsSigmaClip" + std::to_string(observation.getNrDMs(true) * observation.getNrDMs()), *code, SNR::getSNRBuildFlags(conf), *clContext, clDevices->at(clDeviceID));
+      } else if ( runtimeMode && DMsSamples ) {
+        kernel = isa::OpenCL::compile("snrDMsSamplesRuntime", *code, SNR::getSNRBuildFlags(conf), *clContext, clDevices->at(clDeviceID));
+      } else if ( runtimeMode ) {
+        kernel = isa::OpenCL::compile("snrSamplesDMsRuntime", *code, SNR::getSNRBuildFlags(conf), *clContext, clDevices->at(clDeviceID));
+      } else if ( slicedMode ) {
+        kernel = isa::OpenCL::compile("snrSamplesDMsSliced" + std::to_string(observation.getNrDMs(true) * observation.getNrDMs()), *code, SNR::getSNRBuildFlags(conf), *clContext, clDevices->at(clDeviceID));
+      } else if ( hierarchicalMode && DMsSamples ) {
+        kernel = isa::OpenCL::compile("snrDMsSamplesHierarchical" + std::to_string(observation.getNrSamplesPerBatch()), *code, SNR::getSNRBuildFlags(conf), *clContext, clDevices->at(clDeviceID));
+      } else if ( hierarchicalMode ) {
+        kernel = isa::OpenCL::compile("snrSamplesDMsHierarchical" + std::to_string(observation.getNrDMs(true) * observation.getNrDMs()), *code, SNR::getSNRBuildFlags(conf), *clContext, clDevices->at(clDeviceID));
+      } else if ( kernelDMsSamples ) {
+        kernel = isa::OpenCL::compile("snrDMsSamples" + std::to_string(observation.getNrSamplesPerBatch()), *code, SNR::getSNRBuildFlags(conf), *clContext, clDevices->at(clDeviceID));
+      } else {
+        kernel = isa::OpenCL::compile("snrSamplesDMs" + std::to_string(observation.getNrDMs(true) * observation.getNrDMs()), *code, SNR::getSNRBuildFlags(conf), *clContext, clDevices->at(clDeviceID));
+      }
+    } catch ( isa::OpenCL::OpenCLError & err ) {
+      std::cerr << err.what() << std::endl;
+      return 1;
+    }
+    delete code;
+    if ( slicedMode ) {
+      code = SNR::getSNRSamplesDMsMergeOpenCL(conf, observation, observation.getNrSamplesPerBatch(), padding);
+      if ( printCode ) {
+        std::cout << *code << std::endl;
+      }
+      try {
+        mergeKernel = isa::OpenCL::compile("snrSamplesDMsMerge" + std::to_string(observation.getNrDMs(true) * observation.getNrDMs()), *code, "-cl-mad-enable -Werror", *clContext, clDevices->at(clDeviceID));
+      } catch ( isa::OpenCL::OpenCLError & err ) {
+        std::cerr << err.what() << std::endl;
+        return 1;
+      }
+      delete code;
+    }
+    if ( transposeMode ) {
+      code = SNR::getSNRTransposeOpenCL< inputDataType >(conf, inputDataName, observation, observation.getNrSamplesPerBatch(), padding, DMsSamples);
+      if ( printCode ) {
+        std::cout << *code << std::endl;
+      }
+      try {
+        transposeKernel = isa::OpenCL::compile("snrTranspose" + std::string(DMsSamples ? "DMsSamples" : "SamplesDMs") + std::to_string(observation.getNrSamplesPerBatch()), *code, "-cl-mad-enable -Werror", *clContext, clDevices->at(clDeviceID));
+      } catch ( isa::OpenCL::OpenCLError & err ) {
+        std::cerr << err.what() << std::endl;
+        return 1;
+      }
+      delete code;
+    }
+    if ( topKMode ) {
+      code = SNR::getSNRTopKOpenCL(conf, observation, nrTopCandidates, padding);
+      if ( printCode ) {
+        std::cout << *code << std::endl;
+      }
+      try {
+        topKKernel = isa::OpenCL::compile("snrTopK" + std::to_string(nrTopCandidates), *code, "-cl-mad-enable -Werror", *clContext, clDevices->at(clDeviceID));
+      } catch ( isa::OpenCL::OpenCLError & err ) {
+        std::cerr << err.what() << std::endl;
+        return 1;
+      }
+      delete code;
+    }
+  }
 
+  // Run OpenCL kernel or native CPU code, and CPU control
+  std::vector< isa::utils::Stats< float > > control(observation.getNrSynthesizedBeams() * observation.getNrDMs(true) * observation.getNrDMs());
+  if ( cpu ) {
     if ( DMsSamples ) {
-      global = cl::NDRange(conf.getNrThreadsD0(), observation.getNrDMs(true) * observation.getNrDMs(), observation.getNrSynthesizedBeams());
-      local = cl::NDRange(conf.getNrThreadsD0(), 1, 1);
+      SNR::snrDMsSamplesCPU< inputDataType >(conf, observation, observation.getNrSamplesPerBatch(), padding, input, outputSNR, outputSample);
     } else {
-      global = cl::NDRange((observation.getNrDMs(true) * observation.getNrDMs()) / conf.getNrItemsD0(), observation.getNrSynthesizedBeams());
-      local = cl::NDRange(conf.getNrThreadsD0(), 1);
+      SNR::snrSamplesDMsCPU< inputDataType >(conf, observation, observation.getNrSamplesPerBatch(), padding, input, outputSNR, outputSample);
     }
+  } else if ( multiDeviceMode ) {
+    // The beams are split between the selected devices, or the NUMA sub-devices of the OpenCL device
+    std::vector< cl::Device > devices;
 
-    kernel->setArg(0, input_d);
-    kernel->setArg(1, outputSNR_d);
-    kernel->setArg(2, outputSample_d);
+    if ( numaMode ) {
+      devices = SNR::getNUMASubDevices(clDevices->at(clDeviceID));
+    } else {
+      for ( auto deviceID = deviceIDs.begin(); deviceID != deviceIDs.end(); ++deviceID ) {
+        devices.push_back(clDevices->at(*deviceID));
+      }
+    }
+    try {
+      SNR::snrMultiDevice multiDevice(devices, nrBeamsPerChunk);
 
-    clQueues->at(clDeviceID)[0].enqueueNDRangeKernel(*kernel, cl::NullRange, global, local, 0, 0);
-    clQueues->at(clDeviceID)[0].enqueueReadBuffer(outputSNR_d, CL_TRUE, 0, outputSNR.size() * sizeof(float), reinterpret_cast< void * >(outputSNR.data()));
-    clQueues->at(clDeviceID)[0].enqueueReadBuffer(outputSample_d, CL_TRUE, 0, outputSample.size() * sizeof(unsigned int), reinterpret_cast< void * >(outputSample.data()));
-  } catch ( cl::Error & err ) {
-    std::cerr << "OpenCL error: " << std::to_string(err.err()) << "." << std::endl;
-    return 1;
+      multiDevice.setup< inputDataType >(DMsSamples, std::vector< SNR::snrConf >(devices.size(), conf), inputDataName, observation, padding);
+      multiDevice.run< inputDataType >(input, outputSNR, outputSample);
+      if ( printResults ) {
+        for ( unsigned int device = 0; device < multiDevice.getNrDevices(); device++ ) {
+          std::cout << "Device " << device << ": " << multiDevice.getNrProcessedBeams().at(device) << " beams" << std::endl;
+        }
+        std::cout << std::endl;
+      }
+    } catch ( isa::OpenCL::OpenCLError & err ) {
+      std::cerr << err.what() << std::endl;
+      return 1;
+    } catch ( cl::Error & err ) {
+      std::cerr << "OpenCL error: " << std::to_string(err.err()) << "." << std::endl;
+      return 1;
+    }
+  } else if ( asyncMode ) {
+    // The same batch is processed nrBatches times, rotating nrBuffers sets of host outputs; the callbacks must arrive in order
+    std::vector< std::vector< float > > batchSNR(nrBuffers, outputSNR);
+    std::vector< std::vector< unsigned int > > batchSample(nrBuffers, outputSample);
+    uint64_t nrCompleted = 0;
+
+    try {
+      SNR::snrStreamingDriver driver(*clContext, clDevices->at(clDeviceID), nrBuffers);
+
+      driver.setCallback([&](const uint64_t batch) {
+        if ( batch != nrCompleted ) {
+          wrongPositions++;
+        }
+        nrCompleted++;
+      });
+      driver.setup< inputDataType >(DMsSamples, conf, inputDataName, observation, padding);
+      for ( unsigned int batch = 0; batch < nrBatches; batch++ ) {
+        driver.enqueue< inputDataType >(input, batchSNR.at(batch % nrBuffers), batchSample.at(batch % nrBuffers));
+      }
+      driver.finish();
+    } catch ( isa::OpenCL::OpenCLError & err ) {
+      std::cerr << err.what() << std::endl;
+      return 1;
+    } catch ( cl::Error & err ) {
+      std::cerr << "OpenCL error: " << std::to_string(err.err()) << "." << std::endl;
+      return 1;
+    }
+    if ( nrCompleted != nrBatches ) {
+      std::cerr << "Completed batches: " << nrCompleted << " of " << nrBatches << "." << std::endl;
+      return 1;
+    }
+    outputSNR = batchSNR.at((nrBatches - 1) % nrBuffers);
+    outputSample = batchSample.at((nrBatches - 1) % nrBuffers);
+  } else {
+    try {
+      cl::NDRange global;
+      cl::NDRange local;
+
+      if ( kernelDMsSamples ) {
+        global = cl::NDRange(conf.getNrThreadsD0(), (observation.getNrDMs(true) * observation.getNrDMs()) / conf.getNrItemsD1(), observation.getNrSynthesizedBeams());
+        local = cl::NDRange(conf.getNrThreadsD0(), conf.getNrThreadsD1(), 1);
+      } else {
+        global = cl::NDRange((observation.getNrDMs(true) * observation.getNrDMs()) / conf.getNrItemsD0(), observation.getNrSynthesizedBeams());
+        local = cl::NDRange(conf.getNrThreadsD0(), 1);
+      }
+
+      if ( transposeMode ) {
+        transposeKernel->setArg(0, input_d);
+        transposeKernel->setArg(1, transposed_d);
+        kernel->setArg(0, transposed_d);
+      } else {
+        kernel->setArg(0, input_d);
+      }
+      if ( thresholdMode ) {
+        kernel->setArg(1, snrThreshold);
+        kernel->setArg(2, candidates_d);
+        kernel->setArg(3, nrCandidates_d);
+      } else if ( boxcarMode ) {
+        kernel->setArg(1, outputSNR_d);
+        kernel->setArg(2, outputWidth_d);
+        kernel->setArg(3, outputSample_d);
+      } else if ( streamingMode ) {
+        kernel->setArg(1, state_d);
+        kernel->setArg(2, outputSNR_d);
+        kernel->setArg(3, outputSample_d);
+        if ( timeSeriesMode ) {
+          kernel->setArg(4, timeSeries_d);
+        } else if ( scaledMode ) {
+          kernel->setArg(4, scale_d);
+          kernel->setArg(5, offset_d);
+        }
+      } else if ( slicedMode ) {
+        kernel->setArg(1, partials_d);
+        kernel->setArg(2, partialSamples_d);
+        mergeKernel->setArg(0, partials_d);
+        mergeKernel->setArg(1, partialSamples_d);
+        mergeKernel->setArg(2, outputSNR_d);
+        mergeKernel->setArg(3, outputSample_d);
+      } else if ( hierarchicalMode ) {
+        unsigned int argument = 1;
+
+        if ( fullOutput ) {
+          kernel->setArg(argument++, outputSNR_d);
+          kernel->setArg(argument++, outputSample_d);
+        }
+        kernel->setArg(argument++, bestSubbandDM_d);
+        kernel->setArg(argument, bestBeam_d);
+      } else {
+        kernel->setArg(1, outputSNR_d);
+        kernel->setArg(2, outputSample_d);
+        if ( runtimeMode ) {
+          kernel->setArg(3, observation.getNrSamplesPerBatch());
+          kernel->setArg(4, observation.getNrDMs(true) * observation.getNrDMs());
+        } else if ( scaledMode ) {
+          kernel->setArg(3, scale_d);
+          kernel->setArg(4, offset_d);
+        }
+      }
+
+      // In streaming mode the same batch is processed multiple times
+      for ( unsigned int batch = 0; batch < nrBatches; batch++ ) {
+        if ( timeSeriesMode ) {
+          clQueues->at(clDeviceID)[0].enqueueWriteBuffer(timeSeries_d, CL_FALSE, 0, timeSeries.size() * sizeof(uint64_t), reinterpret_cast< void * >(timeSeries.data()));
+        }
+        if ( hierarchicalMode ) {
+          // The best trials are combined with atomic maximum, starting from zero
+          clQueues->at(clDeviceID)[0].enqueueWriteBuffer(bestSubbandDM_d, CL_FALSE, 0, bestSubbandDM.size() * sizeof(uint64_t), reinterpret_cast< void * >(bestSubbandDM.data()));
+          clQueues->at(clDeviceID)[0].enqueueWriteBuffer(bestBeam_d, CL_FALSE, 0, bestBeam.size() * sizeof(uint64_t), reinterpret_cast< void * >(bestBeam.data()));
+        }
+        if ( transposeMode && DMsSamples ) {
+          clQueues->at(clDeviceID)[0].enqueueNDRangeKernel(*transposeKernel, cl::NullRange, cl::NDRange(isa::utils::pad(observation.getNrSamplesPerBatch(), conf.getTransposeTile()), isa::utils::pad(observation.getNrDMs(true) * observation.getNrDMs(), conf.getTransposeTile()), observation.getNrSynthesizedBeams()), cl::NDRange(conf.getTransposeTile(), conf.getTransposeTile(), 1), 0, 0);
+        } else if ( transposeMode ) {
+          clQueues->at(clDeviceID)[0].enqueueNDRangeKernel(*transposeKernel, cl::NullRange, cl::NDRange(isa::utils::pad(observation.getNrDMs(true) * observation.getNrDMs(), conf.getTransposeTile()), isa::utils::pad(observation.getNrSamplesPerBatch(), conf.getTransposeTile()), observation.getNrSynthesizedBeams()), cl::NDRange(conf.getTransposeTile(), conf.getTransposeTile(), 1), 0, 0);
+        }
+        if ( slicedMode ) {
+          clQueues->at(clDeviceID)[0].enqueueNDRangeKernel(*kernel, cl::NullRange, cl::NDRange((observation.getNrDMs(true) * observation.getNrDMs()) / conf.getNrItemsD0(), conf.getNrSlices(), observation.getNrSynthesizedBeams()), cl::NDRange(conf.getNrThreadsD0(), 1, 1), 0, 0);
+          clQueues->at(clDeviceID)[0].enqueueNDRangeKernel(*mergeKernel, cl::NullRange, global, local, 0, 0);
+        } else {
+          clQueues->at(clDeviceID)[0].enqueueNDRangeKernel(*kernel, cl::NullRange, global, local, 0, 0);
+        }
+      }
+      if ( timeSeriesMode ) {
+        clQueues->at(clDeviceID)[0].enqueueReadBuffer(timeSeries_d, CL_TRUE, 0, timeSeries.size() * sizeof(uint64_t), reinterpret_cast< void * >(timeSeries.data()));
+      }
+      if ( thresholdMode ) {
+        clQueues->at(clDeviceID)[0].enqueueReadBuffer(nrCandidates_d, CL_TRUE, 0, sizeof(unsigned int), reinterpret_cast< void * >(&nrCandidates));
+        nrCandidates = std::min(nrCandidates, maxCandidates);
+        if ( nrCandidates > 0 ) {
+          clQueues->at(clDeviceID)[0].enqueueReadBuffer(candidates_d, CL_TRUE, 0, nrCandidates * sizeof(SNR::snrCandidate), reinterpret_cast< void * >(candidates.data()));
+        }
+      } else if ( fullOutput ) {
+        clQueues->at(clDeviceID)[0].enqueueReadBuffer(outputSNR_d, CL_TRUE, 0, outputSNR.size() * sizeof(float), reinterpret_cast< void * >(outputSNR.data()));
+        clQueues->at(clDeviceID)[0].enqueueReadBuffer(outputSample_d, CL_TRUE, 0, outputSample.size() * sizeof(unsigned int), reinterpret_cast< void * >(outputSample.data()));
+      }
+      if ( hierarchicalMode ) {
+        clQueues->at(clDeviceID)[0].enqueueReadBuffer(bestSubbandDM_d, CL_TRUE, 0, bestSubbandDM.size() * sizeof(uint64_t), reinterpret_cast< void * >(bestSubbandDM.data()));
+        clQueues->at(clDeviceID)[0].enqueueReadBuffer(bestBeam_d, CL_TRUE, 0, bestBeam.size() * sizeof(uint64_t), reinterpret_cast< void * >(bestBeam.data()));
+      }
+      if ( boxcarMode ) {
+        clQueues->at(clDeviceID)[0].enqueueReadBuffer(outputWidth_d, CL_TRUE, 0, outputWidth.size() * sizeof(unsigned int), reinterpret_cast< void * >(outputWidth.data()));
+      }
+      if ( topKMode ) {
+        topKKernel->setArg(0, outputSNR_d);
+        topKKernel->setArg(1, outputSample_d);
+        topKKernel->setArg(2, candidates_d);
+        clQueues->at(clDeviceID)[0].enqueueNDRangeKernel(*topKKernel, cl::NullRange, cl::NDRange(conf.getNrThreadsD0(), observation.getNrSynthesizedBeams()), cl::NDRange(conf.getNrThreadsD0(), 1), 0, 0);
+        clQueues->at(clDeviceID)[0].enqueueReadBuffer(candidates_d, CL_TRUE, 0, candidates.size() * sizeof(SNR::snrCandidate), reinterpret_cast< void * >(candidates.data()));
+      }
+    } catch ( cl::Error & err ) {
+      std::cerr << "OpenCL error: " << std::to_string(err.err()) << "." << std::endl;
+      return 1;
+    }
   }
   for ( unsigned int beam = 0; beam < observation.getNrSynthesizedBeams(); beam++ ) {
     for ( unsigned int subbandDM = 0; subbandDM < observation.getNrDMs(true); subbandDM++ ) {
       for ( unsigned int dm = 0; dm < observation.getNrDMs(); dm++ ) {
-        control[(beam * observation.getNrDMs(true) * observation.getNrDMs()) + (subbandDM * observation.getNrDMs()) + dm] = isa::utils::Stats< inputDataType >();
+        control[(beam * observation.getNrDMs(true) * observation.getNrDMs()) + (subbandDM * observation.getNrDMs()) + dm] = isa::utils::Stats< float >();
       }
     }
     if ( DMsSamples ) {
       for ( unsigned int subbandDM = 0; subbandDM < observation.getNrDMs(true); subbandDM++ ) {
         for ( unsigned int dm = 0; dm < observation.getNrDMs(); dm++ ) {
           for ( unsigned int sample = 0; sample < observation.getNrSamplesPerBatch(); sample++ ) {
-            control[(beam * observation.getNrDMs(true) * observation.getNrDMs()) + (subbandDM * observation.getNrDMs()) + dm].addElement(input[(beam * observation.getNrDMs(true) * observation.getNrDMs() * observation.getNrSamplesPerBatch(false, padding / sizeof(inputDataType))) + (subbandDM * observation.getNrDMs() * observation.getNrSamplesPerBatch(false, padding / sizeof(inputDataType))) + (dm * observation.getNrSamplesPerBatch(false, padding / sizeof(inputDataType))) + sample]);
+            float item = input[(beam * observation.getNrDMs(true) * observation.getNrDMs() * observation.getNrSamplesPerBatch(false, padding / sizeof(inputDataType))) + (subbandDM * observation.getNrDMs() * observation.getNrSamplesPerBatch(false, padding / sizeof(inputDataType))) + (dm * observation.getNrSamplesPerBatch(false, padding / sizeof(inputDataType))) + sample];
+
+            if ( scaledMode ) {
+              item = (item * scale[(subbandDM * observation.getNrDMs()) + dm]) + offset[(subbandDM * observation.getNrDMs()) + dm];
+            }
+            control[(beam * observation.getNrDMs(true) * observation.getNrDMs()) + (subbandDM * observation.getNrDMs()) + dm].addElement(item);
           }
         }
       }
@@ -240,27 +848,247 @@ int main(int argc, char *argv[]) {
       for ( unsigned int sample = 0; sample < observation.getNrSamplesPerBatch(); sample++ ) {
         for ( unsigned int subbandDM = 0; subbandDM < observation.getNrDMs(true); subbandDM++ ) {
           for ( unsigned int dm = 0; dm < observation.getNrDMs(); dm++ ) {
-            control[(beam * observation.getNrDMs(true) * observation.getNrDMs()) + (subbandDM * observation.getNrDMs()) + dm].addElement(input[(beam * observation.getNrSamplesPerBatch() * observation.getNrDMs(true) * observation.getNrDMs(false, padding / sizeof(inputDataType))) + (sample * observation.getNrDMs(true) * observation.getNrDMs(false, padding / sizeof(inputDataType))) + (subbandDM * observation.getNrDMs(false, padding / sizeof(inputDataType))) + dm]);
+            float item = input[(beam * observation.getNrSamplesPerBatch() * observation.getNrDMs(true) * observation.getNrDMs(false, padding / sizeof(inputDataType))) + (sample * observation.getNrDMs(true) * observation.getNrDMs(false, padding / sizeof(inputDataType))) + (subbandDM * observation.getNrDMs(false, padding / sizeof(inputDataType))) + dm];
+
+            if ( scaledMode ) {
+              item = (item * scale[(subbandDM * observation.getNrDMs()) + dm]) + offset[(subbandDM * observation.getNrDMs()) + dm];
+            }
+            control[(beam * observation.getNrDMs(true) * observation.getNrDMs()) + (subbandDM * observation.getNrDMs()) + dm].addElement(item);
           }
         }
       }
     }
   }
 
-  for ( unsigned int beam = 0; beam < observation.getNrSynthesizedBeams(); beam++ ) {
+  std::vector< float > boxcarSNR;
+  std::vector< unsigned int > boxcarWidth;
+  std::vector< unsigned int > boxcarSample;
+  if ( boxcarMode ) {
+    // Best boxcar of every DM, the noise of width w has mean (w * mean) and standard deviation (sqrt(w) * stdDev)
+    boxcarSNR.resize(observation.getNrSynthesizedBeams() * observation.getNrDMs(true) * observation.getNrDMs());
+    boxcarWidth.resize(boxcarSNR.size());
+    boxcarSample.resize(boxcarSNR.size());
+    for ( unsigned int beam = 0; beam < observation.getNrSynthesizedBeams(); beam++ ) {
+      for ( unsigned int dm = 0; dm < observation.getNrDMs(true) * observation.getNrDMs(); dm++ ) {
+        const inputDataType * row = &(input[(beam * observation.getNrDMs(true) * observation.getNrDMs() * observation.getNrSamplesPerBatch(false, padding / sizeof(inputDataType))) + (dm * observation.getNrSamplesPerBatch(false, padding / sizeof(inputDataType)))]);
+
+        boxcarSNR[(beam * observation.getNrDMs(true) * observation.getNrDMs()) + dm] = -std::numeric_limits< float >::infinity();
+        for ( auto width = widths.begin(); width != widths.end(); ++width ) {
+          float maxSum = -std::numeric_limits< float >::infinity();
+          unsigned int maxSumSample = 0;
+
+          for ( unsigned int sample = 0; sample + *width <= observation.getNrSamplesPerBatch(); sample++ ) {
+            float sum = 0.0f;
+
+            for ( unsigned int offset = 0; offset < *width; offset++ ) {
+              sum += row[sample + offset];
+            }
+            if ( sum > maxSum ) {
+              maxSum = sum;
+              maxSumSample = sample;
+            }
+          }
+          float snr = (maxSum - (*width * control[(beam * observation.getNrDMs(true) * observation.getNrDMs()) + dm].getMean())) / (std::sqrt(static_cast< float >(*width)) * control[(beam * observation.getNrDMs(true) * observation.getNrDMs()) + dm].getStandardDeviation());
+          if ( snr > boxcarSNR[(beam * observation.getNrDMs(true) * observation.getNrDMs()) + dm] ) {
+            boxcarSNR[(beam * observation.getNrDMs(true) * observation.getNrDMs()) + dm] = snr;
+            boxcarWidth[(beam * observation.getNrDMs(true) * observation.getNrDMs()) + dm] = *width;
+            boxcarSample[(beam * observation.getNrDMs(true) * observation.getNrDMs()) + dm] = maxSumSample;
+          }
+        }
+      }
+    }
+  }
+  std::vector< float > clippedSNR;
+  if ( sigmaClipMode ) {
+    // Mean and standard deviation are recomputed excluding the samples further than sigma standard deviations
+    clippedSNR.resize(observation.getNrSynthesizedBeams() * observation.getNrDMs(true) * observation.getNrDMs());
+    for ( unsigned int beam = 0; beam < observation.getNrSynthesizedBeams(); beam++ ) {
+      for ( unsigned int dm = 0; dm < observation.getNrDMs(true) * observation.getNrDMs(); dm++ ) {
+        isa::utils::Stats< float > clipped = control[(beam * observation.getNrDMs(true) * observation.getNrDMs()) + dm];
+
+        for ( unsigned int iteration = 0; iteration < nrClipIterations; iteration++ ) {
+          double clipMean = clipped.getMean();
+          double clipLimit = sigma * clipped.getStandardDeviation();
+
+          clipped = isa::utils::Stats< float >();
+          for ( unsigned int sample = 0; sample < observation.getNrSamplesPerBatch(); sample++ ) {
+            float item = 0.0f;
+
+            if ( DMsSamples ) {
+              item = input[(beam * observation.getNrDMs(true) * observation.getNrDMs() * observation.getNrSamplesPerBatch(false, padding / sizeof(inputDataType))) + (dm * observation.getNrSamplesPerBatch(false, padding / sizeof(inputDataType))) + sample];
+            } else {
+              item = input[(beam * observation.getNrSamplesPerBatch() * observation.getNrDMs(true) * observation.getNrDMs(false, padding / sizeof(inputDataType))) + (sample * observation.getNrDMs(true) * observation.getNrDMs(false, padding / sizeof(inputDataType))) + dm];
+            }
+            if ( std::abs(item - clipMean) <= clipLimit ) {
+              clipped.addElement(item);
+            }
+          }
+        }
+        clippedSNR[(beam * observation.getNrDMs(true) * observation.getNrDMs()) + dm] = (control[(beam * observation.getNrDMs(true) * observation.getNrDMs()) + dm].getMax() - clipped.getMean()) / clipped.getStandardDeviation();
+      }
+    }
+  }
+  std::vector< float > streamingSNR;
+  std::vector< double > previousMean;
+  std::vector< double > previousNormalization;
+  if ( streamingMode ) {
+    // Merge the statistics of nrBatches copies of the batch, forgetting the previous state with decay
+    streamingSNR.resize(observation.getNrSynthesizedBeams() * observation.getNrDMs(true) * observation.getNrDMs());
+    previousMean.resize(streamingSNR.size());
+    previousNormalization.resize(streamingSNR.size());
+    for ( unsigned int item = 0; item < streamingSNR.size(); item++ ) {
+      double counter = 0.0;
+      double mean = 0.0;
+      double m2 = 0.0;
+
+      for ( unsigned int batch = 0; batch < nrBatches; batch++ ) {
+        if ( batch == nrBatches - 1 ) {
+          // The time series of the last batch is normalized with the state of the previous ones, or with its own statistics if it is the first
+          if ( counter > 1.0 ) {
+            previousMean[item] = mean;
+            previousNormalization[item] = 1.0 / std::sqrt(m2 / (counter - 1));
+          } else {
+            previousMean[item] = control[item].getMean();
+            previousNormalization[item] = (control[item].getNrElements() > 1) ? 1.0 / std::sqrt(control[item].getVariance()) : 0.0;
+          }
+        }
+        double batchCounter = control[item].getNrElements();
+        double delta = control[item].getMean() - mean;
+
+        counter *= decay;
+        m2 *= decay;
+        mean = ((counter * mean) + (batchCounter * control[item].getMean())) / (counter + batchCounter);
+        m2 += (control[item].getVariance() * (batchCounter - 1)) + ((delta * delta) * ((counter * batchCounter) / (counter + batchCounter)));
+        counter += batchCounter;
+      }
+      streamingSNR[item] = (control[item].getMax() - mean) / std::sqrt(m2 / (counter - 1));
+    }
+  }
+  if ( thresholdMode ) {
+    // Scatter the candidates; DMs without candidate are marked with -infinity
+    std::fill(outputSNR.begin(), outputSNR.end(), -std::numeric_limits< float >::infinity());
+    for ( unsigned int candidate = 0; candidate < nrCandidates; candidate++ ) {
+      outputSNR[(candidates[candidate].beam * isa::utils::pad(observation.getNrDMs(true) * observation.getNrDMs(), padding / sizeof(float))) + candidates[candidate].dm] = candidates[candidate].snr;
+      outputSample[(candidates[candidate].beam * isa::utils::pad(observation.getNrDMs(true) * observation.getNrDMs(), padding / sizeof(unsigned int))) + candidates[candidate].dm] = candidates[candidate].sample;
+    }
+  }
+  // Without the full output only the hierarchical outputs are checked
+  for ( unsigned int beam = 0; beam < observation.getNrSynthesizedBeams() && fullOutput; beam++ ) {
     for ( unsigned int subbandDM = 0; subbandDM < observation.getNrDMs(true); subbandDM++ ) {
       for ( unsigned int dm = 0; dm < observation.getNrDMs(); dm++ ) {
-        if ( !isa::utils::same(outputSNR[(beam * isa::utils::pad(observation.getNrDMs(true) * observation.getNrDMs(), padding / sizeof(float))) + (subbandDM * observation.getNrDMs()) + dm], static_cast<float>((control[(beam * observation.getNrDMs(true) * observation.getNrDMs()) + (subbandDM * observation.getNrDMs()) + dm].getMax() - control[(beam * observation.getNrDMs(true) * observation.getNrDMs()) + (subbandDM * observation.getNrDMs()) + dm].getMean()) / control[(beam * observation.getNrDMs(true) * observation.getNrDMs()) + (subbandDM * observation.getNrDMs()) + dm].getStandardDeviation()), static_cast<float>(1e-2)) ) {
+        float controlSNR = 0.0f;
+
+        if ( streamingMode ) {
+          controlSNR = streamingSNR[(beam * observation.getNrDMs(true) * observation.getNrDMs()) + (subbandDM * observation.getNrDMs()) + dm];
+        } else if ( sigmaClipMode ) {
+          controlSNR = clippedSNR[(beam * observation.getNrDMs(true) * observation.getNrDMs()) + (subbandDM * observation.getNrDMs()) + dm];
+        } else if ( boxcarMode ) {
+          controlSNR = boxcarSNR[(beam * observation.getNrDMs(true) * observation.getNrDMs()) + (subbandDM * observation.getNrDMs()) + dm];
+        } else {
+          controlSNR = static_cast<float>((control[(beam * observation.getNrDMs(true) * observation.getNrDMs()) + (subbandDM * observation.getNrDMs()) + dm].getMax() - control[(beam * observation.getNrDMs(true) * observation.getNrDMs()) + (subbandDM * observation.getNrDMs()) + dm].getMean()) / control[(beam * observation.getNrDMs(true) * observation.getNrDMs()) + (subbandDM * observation.getNrDMs()) + dm].getStandardDeviation());
+        }
+        if ( thresholdMode && std::isinf(outputSNR[(beam * isa::utils::pad(observation.getNrDMs(true) * observation.getNrDMs(), padding / sizeof(float))) + (subbandDM * observation.getNrDMs()) + dm]) ) {
+          // Missing candidate
+          if ( controlSNR >= snrThreshold + 1e-2 ) {
+            wrongSamples++;
+          }
+          continue;
+        }
+        if ( !isa::utils::same(outputSNR[(beam * isa::utils::pad(observation.getNrDMs(true) * observation.getNrDMs(), padding / sizeof(float))) + (subbandDM * observation.getNrDMs()) + dm], controlSNR, static_cast<float>(1e-2)) ) {
           wrongSamples++;
         }
-        if ( outputSample.at((beam * isa::utils::pad(observation.getNrDMs(true) * observation.getNrDMs(), padding / sizeof(unsigned int))) + (subbandDM * observation.getNrDMs()) + dm) != maxSample.at((beam * isa::utils::pad(observation.getNrDMs(true) * observation.getNrDMs(), padding / sizeof(unsigned int))) + (subbandDM * observation.getNrDMs()) + dm) ) {
+        if ( boxcarMode ) {
+          if ( outputWidth.at((beam * isa::utils::pad(observation.getNrDMs(true) * observation.getNrDMs(), padding / sizeof(unsigned int))) + (subbandDM * observation.getNrDMs()) + dm) != boxcarWidth[(beam * observation.getNrDMs(true) * observation.getNrDMs()) + (subbandDM * observation.getNrDMs()) + dm] || outputSample.at((beam * isa::utils::pad(observation.getNrDMs(true) * observation.getNrDMs(), padding / sizeof(unsigned int))) + (subbandDM * observation.getNrDMs()) + dm) != boxcarSample[(beam * observation.getNrDMs(true) * observation.getNrDMs()) + (subbandDM * observation.getNrDMs()) + dm] ) {
+            wrongPositions++;
+          }
+        } else if ( outputSample.at((beam * isa::utils::pad(observation.getNrDMs(true) * observation.getNrDMs(), padding / sizeof(unsigned int))) + (subbandDM * observation.getNrDMs()) + dm) != maxSample.at((beam * isa::utils::pad(observation.getNrDMs(true) * observation.getNrDMs(), padding / sizeof(unsigned int))) + (subbandDM * observation.getNrDMs()) + dm) ) {
           wrongPositions++;
         }
       }
     }
   }
   
-  if ( printResults ) {
+  if ( timeSeriesMode ) {
+    // The value of the selected DM must be correct and within tolerance from the best one
+    for ( unsigned int beam = 0; beam < observation.getNrSynthesizedBeams(); beam++ ) {
+      for ( unsigned int sample = 0; sample < observation.getNrSamplesPerBatch(); sample++ ) {
+        uint64_t key = timeSeries[(beam * observation.getNrSamplesPerBatch(false, padding / sizeof(uint64_t))) + sample];
+        unsigned int timeSeriesDM = SNR::getTimeSeriesDM(key);
+        float bestValue = -std::numeric_limits< float >::infinity();
+
+        if ( timeSeriesDM >= observation.getNrDMs(true) * observation.getNrDMs() ) {
+          wrongPositions++;
+          continue;
+        }
+        for ( unsigned int dm = 0; dm < observation.getNrDMs(true) * observation.getNrDMs(); dm++ ) {
+          float value = (input[(beam * observation.getNrSamplesPerBatch() * observation.getNrDMs(true) * observation.getNrDMs(false, padding / sizeof(inputDataType))) + (sample * observation.getNrDMs(true) * observation.getNrDMs(false, padding / sizeof(inputDataType))) + dm] - previousMean[(beam * observation.getNrDMs(true) * observation.getNrDMs()) + dm]) * previousNormalization[(beam * observation.getNrDMs(true) * observation.getNrDMs()) + dm];
+
+          bestValue = std::max(bestValue, value);
+          if ( dm == timeSeriesDM && !isa::utils::same(SNR::getTimeSeriesValue(key), value, static_cast<float>(1e-2)) ) {
+            wrongSamples++;
+          }
+        }
+        if ( !isa::utils::same(SNR::getTimeSeriesValue(key), bestValue, static_cast<float>(1e-2)) ) {
+          wrongPositions++;
+        }
+      }
+    }
+  }
+
+  if ( hierarchicalMode ) {
+    // The selected trial must be in the right range of DMs, have the correct sample, and an SNR within tolerance from the best one
+    // The subbanding DM steps are checked first, and the beam last
+    for ( unsigned int beam = 0; beam < observation.getNrSynthesizedBeams(); beam++ ) {
+      for ( unsigned int subbandDM = 0; subbandDM <= observation.getNrDMs(true); subbandDM++ ) {
+        uint64_t key = bestBeam[beam];
+        unsigned int firstDM = 0;
+        unsigned int lastDM = observation.getNrDMs(true) * observation.getNrDMs();
+        unsigned int bestDM = 0;
+        float bestSNR = -std::numeric_limits< float >::infinity();
+
+        if ( subbandDM < observation.getNrDMs(true) ) {
+          key = bestSubbandDM[(beam * isa::utils::pad(observation.getNrDMs(true), padding / sizeof(uint64_t))) + subbandDM];
+          firstDM = subbandDM * observation.getNrDMs();
+          lastDM = firstDM + observation.getNrDMs();
+        }
+        for ( unsigned int dm = firstDM; dm < lastDM; dm++ ) {
+          bestSNR = std::max(bestSNR, static_cast< float >((control[(beam * observation.getNrDMs(true) * observation.getNrDMs()) + dm].getMax() - control[(beam * observation.getNrDMs(true) * observation.getNrDMs()) + dm].getMean()) / control[(beam * observation.getNrDMs(true) * observation.getNrDMs()) + dm].getStandardDeviation()));
+        }
+        bestDM = SNR::getBestDM(key, observation.getNrSamplesPerBatch());
+        if ( bestDM < firstDM || bestDM >= lastDM || SNR::getBestSample(key, observation.getNrSamplesPerBatch()) != maxSample.at((beam * isa::utils::pad(observation.getNrDMs(true) * observation.getNrDMs(), padding / sizeof(unsigned int))) + bestDM) ) {
+          wrongPositions++;
+        } else if ( !isa::utils::same(SNR::getBestSNR(key), bestSNR, static_cast<float>(1e-2)) ) {
+          wrongSamples++;
+        }
+      }
+      if ( printResults ) {
+        std::cout << "Beam: " << beam << " best SNR " << SNR::getBestSNR(bestBeam[beam]) << " DM " << SNR::getBestDM(bestBeam[beam], observation.getNrSamplesPerBatch()) << " sample " << SNR::getBestSample(bestBeam[beam], observation.getNrSamplesPerBatch()) << std::endl;
+      }
+    }
+  }
+
+  if ( topKMode ) {
+    // The candidates of every beam must have the highest SNRs, in decreasing order
+    for ( unsigned int beam = 0; beam < observation.getNrSynthesizedBeams(); beam++ ) {
+      std::vector< float > controlSNRs;
+
+      for ( unsigned int dm = 0; dm < observation.getNrDMs(true) * observation.getNrDMs(); dm++ ) {
+        controlSNRs.push_back((control[(beam * observation.getNrDMs(true) * observation.getNrDMs()) + dm].getMax() - control[(beam * observation.getNrDMs(true) * observation.getNrDMs()) + dm].getMean()) / control[(beam * observation.getNrDMs(true) * observation.getNrDMs()) + dm].getStandardDeviation());
+      }
+      std::sort(controlSNRs.begin(), controlSNRs.end(), std::greater< float >());
+      for ( unsigned int candidate = 0; candidate < std::min(nrTopCandidates, static_cast< unsigned int >(controlSNRs.size())); candidate++ ) {
+        const SNR::snrCandidate & item = candidates[(beam * nrTopCandidates) + candidate];
+
+        if ( item.beam != beam || !isa::utils::same(item.snr, controlSNRs[candidate], static_cast<float>(1e-2)) ) {
+          wrongSamples++;
+        } else if ( item.sample != maxSample.at((beam * isa::utils::pad(observation.getNrDMs(true) * observation.getNrDMs(), padding / sizeof(unsigned int))) + item.dm) ) {
+          wrongPositions++;
+        }
+      }
+    }
+  }
+
+  if ( printResults && fullOutput ) {
     for ( unsigned int beam = 0; beam < observation.getNrSynthesizedBeams(); beam++ ) {
       std::cout << "Beam: " << beam << std::endl;
       for ( unsigned int subbandDM = 0; subbandDM < observation.getNrDMs(true); subbandDM++ ) {
@@ -285,3 +1113,127 @@ int main(int argc, char *argv[]) {
   return 0;
 }
 
+unsigned int sweep(const bool DMsSamples, SNR::snrConf conf, const AstroData::Observation & observation, const unsigned int padding, const unsigned int minThreads, const unsigned int maxThreads, const unsigned int maxItems, const bool printCode, const std::vector< inputDataType > & input, cl::Context & clContext, cl::Device & clDevice, cl::CommandQueue & clQueue, cl::Buffer & input_d) {
+  const unsigned int nrDMs = observation.getNrDMs(true) * observation.getNrDMs();
+  unsigned int nrConfigurations = 0;
+  unsigned int nrFailed = 0;
+  SNR::snrConf referenceConf = conf;
+  std::vector< float > referenceSNR(observation.getNrSynthesizedBeams() * isa::utils::pad(nrDMs, padding / sizeof(float)));
+  std::vector< unsigned int > referenceSample(observation.getNrSynthesizedBeams() * isa::utils::pad(nrDMs, padding / sizeof(unsigned int)));
+  std::vector< float > outputSNR(referenceSNR.size());
+  std::vector< unsigned int > outputSample(referenceSample.size());
+  cl::Buffer outputSNR_d, outputSample_d;
+
+  // Vectorized reference, with one task per DM (DMsSamples) or per 16 DMs block (SamplesDMs) on all the host cores
+  referenceConf.setNrThreadsD0(0);
+  referenceConf.setNrItemsD0(1);
+  if ( DMsSamples ) {
+    SNR::snrDMsSamplesCPU< inputDataType >(referenceConf, observation, observation.getNrSamplesPerBatch(), padding, input, referenceSNR, referenceSample);
+  } else {
+    SNR::snrSamplesDMsCPU< inputDataType >(referenceConf, observation, observation.getNrSamplesPerBatch(), padding, input, referenceSNR, referenceSample);
+  }
+  try {
+    outputSNR_d = cl::Buffer(clContext, CL_MEM_WRITE_ONLY, outputSNR.size() * sizeof(float), 0, 0);
+    outputSample_d = cl::Buffer(clContext, CL_MEM_WRITE_ONLY, outputSample.size() * sizeof(unsigned int), 0, 0);
+  } catch ( cl::Error & err ) {
+    std::cerr << "OpenCL error allocating memory: " << std::to_string(err.err()) << "." << std::endl;
+    return 1;
+  }
+
+  std::cout << std::fixed << std::endl;
+  std::cout << "# *configuration* result wrongSamples wrongPositions maxError" << std::endl << std::endl;
+  // Same configurations as SNRTuning
+  for ( unsigned int threads = minThreads; threads <= maxThreads; ) {
+    conf.setNrThreadsD0(threads);
+    if ( DMsSamples ) {
+      threads *= 2;
+    } else {
+      threads++;
+    }
+    for ( unsigned int itemsPerThread = 1; itemsPerThread <= maxItems; itemsPerThread++ ) {
+      uint64_t wrongSamples = 0;
+      uint64_t wrongPositions = 0;
+      float maxError = 0.0f;
+      std::string * code = 0;
+      cl::Kernel * kernel = 0;
+      cl::NDRange global, local;
+
+      if ( DMsSamples && (observation.getNrSamplesPerBatch() % itemsPerThread) != 0 ) {
+        continue;
+      } else if ( !DMsSamples && (observation.getNrDMs() % (itemsPerThread * conf.getNrThreadsD0())) != 0 ) {
+        continue;
+      } else if ( (itemsPerThread % conf.getVectorWidth()) != 0 ) {
+        continue;
+      }
+      conf.setNrItemsD0(itemsPerThread);
+      nrConfigurations++;
+      if ( DMsSamples ) {
+        code = SNR::getSNRDMsSamplesOpenCL< inputDataType >(conf, inputDataName, observation, observation.getNrSamplesPerBatch(), padding);
+        global = cl::NDRange(conf.getNrThreadsD0(), nrDMs / conf.getNrItemsD1(), observation.getNrSynthesizedBeams());
+        local = cl::NDRange(conf.getNrThreadsD0(), conf.getNrThreadsD1(), 1);
+      } else {
+        code = SNR::getSNRSamplesDMsOpenCL< inputDataType >(conf, inputDataName, observation, observation.getNrSamplesPerBatch(), padding);
+        global = cl::NDRange(nrDMs / conf.getNrItemsD0(), observation.getNrSynthesizedBeams());
+        local = cl::NDRange(conf.getNrThreadsD0(), 1);
+      }
+      if ( printCode ) {
+        std::cout << *code << std::endl;
+      }
+      try {
+        if ( DMsSamples ) {
+          kernel = isa::OpenCL::compile("snrDMsSamples" + std::to_string(observation.getNrSamplesPerBatch()), *code, SNR::getSNRBuildFlags(conf), clContext, clDevice);
+        } else {
+          kernel = isa::OpenCL::compile("snrSamplesDMs" + std::to_string(nrDMs), *code, SNR::getSNRBuildFlags(conf), clContext, clDevice);
+        }
+      } catch ( isa::OpenCL::OpenCLError & err ) {
+        std::cout << conf.print() << " compile_error" << std::endl;
+        delete code;
+        nrFailed++;
+        continue;
+      }
+      delete code;
+      try {
+        kernel->setArg(0, input_d);
+        kernel->setArg(1, outputSNR_d);
+        kernel->setArg(2, outputSample_d);
+        clQueue.enqueueNDRangeKernel(*kernel, cl::NullRange, global, local, 0, 0);
+        clQueue.enqueueReadBuffer(outputSNR_d, CL_TRUE, 0, outputSNR.size() * sizeof(float), reinterpret_cast< void * >(outputSNR.data()));
+        clQueue.enqueueReadBuffer(outputSample_d, CL_TRUE, 0, outputSample.size() * sizeof(unsigned int), reinterpret_cast< void * >(outputSample.data()));
+      } catch ( cl::Error & err ) {
+        std::cout << conf.print() << " run_error " << std::to_string(err.err()) << std::endl;
+        delete kernel;
+        nrFailed++;
+        continue;
+      }
+      delete kernel;
+      for ( unsigned int beam = 0; beam < observation.getNrSynthesizedBeams(); beam++ ) {
+        for ( unsigned int dm = 0; dm < nrDMs; dm++ ) {
+          const uint64_t item = (beam * static_cast< uint64_t >(isa::utils::pad(nrDMs, padding / sizeof(float)))) + dm;
+          const uint64_t sampleItem = (beam * static_cast< uint64_t >(isa::utils::pad(nrDMs, padding / sizeof(unsigned int)))) + dm;
+
+          maxError = std::max(maxError, std::abs(outputSNR[item] - referenceSNR[item]));
+          if ( !isa::utils::same(outputSNR[item], referenceSNR[item], static_cast<float>(1e-2)) ) {
+            wrongSamples++;
+          }
+          if ( outputSample[sampleItem] != referenceSample[sampleItem] ) {
+            wrongPositions++;
+          }
+        }
+      }
+      if ( wrongSamples > 0 || wrongPositions > 0 ) {
+        nrFailed++;
+      }
+      std::cout << conf.print() << " " << ((wrongSamples > 0 || wrongPositions > 0) ? "failed" : "passed") << " " << wrongSamples << " " << wrongPositions << " ";
+      std::cout << std::setprecision(6);
+      std::cout << maxError << std::endl;
+    }
+  }
+  std::cout << std::endl;
+  if ( nrFailed > 0 ) {
+    std::cout << "Failed configurations: " << nrFailed << " of " << nrConfigurations << "." << std::endl;
+  } else {
+    std::cout << "TEST PASSED (" << nrConfigurations << " configurations)." << std::endl;
+  }
+  return nrFailed;
+}
+
@@ -21,6 +21,8 @@
 #include <iomanip>
 #include <limits>
 #include <algorithm>
+#include <deque>
+#include <future>
 
 #include <configuration.hpp>
 
@@ -29,17 +31,46 @@
 #include <InitializeOpenCL.hpp>
 #include <Kernel.hpp>
 #include <SNR.hpp>
+#include <SNRCPU.hpp>
+#include <SNRKernelCache.hpp>
+#include <SNRSearch.hpp>
+#include <SNRProfile.hpp>
 #include <utils.hpp>
 #include <Timer.hpp>
 #include <Stats.hpp>
 
 
 void initializeDeviceMemoryD(cl::Context & clContext, cl::CommandQueue * clQueue, std::vector< inputDataType > * input, cl::Buffer * input_d, cl::Buffer * outputSNR_d, const uint64_t outputSNR_size, cl::Buffer * outputSample_d, const uint64_t outputSample_size);
+// Attainable bandwidth in GB/s, the highest of the copy and read probes over the input buffer
+double measureBandwidth(cl::Context & clContext, cl::Device & clDevice, cl::CommandQueue * clQueue, cl::Buffer * input_d, const uint64_t input_size, const unsigned int nrIterations);
+// Write the tuned configurations of tunedFile in binary format, and check that reading binaryFile back gives the same table; returns the number of mismatches
+unsigned int writeBinary(const std::string & tunedFile, const std::string & binaryFile);
 
 int main(int argc, char * argv[]) {
   bool reinitializeDeviceMemory = true;
   bool DMsSamples = false;
   bool bestMode = false;
+  bool cpu = false;
+  bool useKernelCache = false;
+  bool compareRuntime = false;
+  bool pipelined = false;
+  bool roofline = false;
+  bool profiling = false;
+  bool subgroup = false;
+  unsigned int maxSlices = 1;
+  unsigned int maxVectorWidth = 1;
+  unsigned int maxThreadsD1 = 1;
+  unsigned int maxItemsD1 = 1;
+  unsigned int maxTransposeTile = 0;
+  unsigned int nrCompileThreads = 0;
+  std::string kernelCacheDirectory;
+  bool prewarm = false;
+  std::string tunedFile;
+  std::string deviceName;
+  std::string searchStrategy = "exhaustive";
+  unsigned int searchSeed = 0;
+  unsigned int maxEvaluations = 0;
+  double maxTime = 0.0;
   unsigned int padding = 0;
   unsigned int nrIterations = 0;
   unsigned int clPlatformID = 0;
@@ -48,6 +79,7 @@ int main(int argc, char * argv[]) {
   unsigned int maxItems = 0;
   unsigned int maxThreads = 0;
   double bestGBs = 0.0;
+  double peakGBs = 0.0;
   AstroData::Observation observation;
   SNR::snrConf conf;
   SNR::snrConf bestConf;
@@ -55,6 +87,9 @@ int main(int argc, char * argv[]) {
 
   try {
     isa::utils::ArgumentList args(argc, argv);
+    if ( args.getSwitch("-write_binary") ) {
+      return writeBinary(args.getSwitchArgument< std::string >("-tuned_file"), args.getSwitchArgument< std::string >("-binary_file")) == 0 ? 0 : 1;
+    }
     DMsSamples = args.getSwitch("-dms_samples");
     bool samplesDMs = args.getSwitch("-samples_dms");
     if ( (DMsSamples && samplesDMs) || (!DMsSamples && !samplesDMs) ) {
@@ -62,9 +97,89 @@ int main(int argc, char * argv[]) {
       return 1;
     }
     nrIterations = args.getSwitchArgument< unsigned int >("-iterations");
-    clPlatformID = args.getSwitchArgument< unsigned int >("-opencl_platform");
-    clDeviceID = args.getSwitchArgument< unsigned int >("-opencl_device");
+    cpu = args.getSwitch("-cpu");
+    if ( !cpu ) {
+      clPlatformID = args.getSwitchArgument< unsigned int >("-opencl_platform");
+      clDeviceID = args.getSwitchArgument< unsigned int >("-opencl_device");
+    }
     bestMode = args.getSwitch("-best");
+    useKernelCache = args.getSwitch("-kernel_cache");
+    if ( useKernelCache ) {
+      kernelCacheDirectory = args.getSwitchArgument< std::string >("-cache_directory");
+    }
+    prewarm = args.getSwitch("-prewarm");
+    if ( prewarm ) {
+      tunedFile = args.getSwitchArgument< std::string >("-tuned_file");
+      deviceName = args.getSwitchArgument< std::string >("-device_name");
+      nrCompileThreads = args.getSwitchArgument< unsigned int >("-compile_threads");
+      if ( cpu || !useKernelCache || nrCompileThreads == 0 ) {
+        std::cerr << "-prewarm requires OpenCL, -kernel_cache and at least one compile thread." << std::endl;
+        return 1;
+      }
+    }
+    compareRuntime = args.getSwitch("-compare_runtime");
+    if ( compareRuntime && (args.getSwitch("-vector") || args.getSwitch("-subgroup")) ) {
+      std::cerr << "-compare_runtime is not available with -vector and -subgroup." << std::endl;
+      return 1;
+    }
+    pipelined = args.getSwitch("-pipeline");
+    if ( pipelined ) {
+      nrCompileThreads = args.getSwitchArgument< unsigned int >("-compile_threads");
+    }
+    roofline = args.getSwitch("-roofline");
+    if ( roofline && cpu ) {
+      std::cerr << "-roofline requires OpenCL." << std::endl;
+      return 1;
+    }
+    profiling = args.getSwitch("-profiling");
+    if ( profiling && (cpu || pipelined || compareRuntime) ) {
+      std::cerr << "-profiling requires OpenCL, and is not available with -pipeline and -compare_runtime." << std::endl;
+      return 1;
+    }
+    if ( pipelined && (cpu || compareRuntime || nrCompileThreads == 0) ) {
+      std::cerr << "-pipeline requires OpenCL, at least one compile thread, and no -compare_runtime." << std::endl;
+      return 1;
+    }
+    subgroup = args.getSwitch("-subgroup");
+    if ( subgroup && (cpu || !DMsSamples) ) {
+      std::cerr << "-subgroup requires OpenCL and -dms_samples." << std::endl;
+      return 1;
+    }
+    if ( args.getSwitch("-sliced") ) {
+      maxSlices = args.getSwitchArgument< unsigned int >("-max_slices");
+      if ( cpu || DMsSamples || pipelined || compareRuntime || maxSlices == 0 ) {
+        std::cerr << "-sliced requires OpenCL and -samples_dms, at least one slice, and is not available with -pipeline and -compare_runtime." << std::endl;
+        return 1;
+      }
+    }
+    if ( args.getSwitch("-vector") ) {
+      maxVectorWidth = args.getSwitchArgument< unsigned int >("-max_vector");
+      if ( cpu || maxVectorWidth == 0 ) {
+        std::cerr << "-vector requires OpenCL and a width of at least one." << std::endl;
+        return 1;
+      }
+    }
+    if ( args.getSwitch("-dm_rows") ) {
+      maxThreadsD1 = args.getSwitchArgument< unsigned int >("-max_threads_d1");
+      maxItemsD1 = args.getSwitchArgument< unsigned int >("-max_items_d1");
+      if ( cpu || !DMsSamples || compareRuntime || maxThreadsD1 == 0 || maxItemsD1 == 0 ) {
+        std::cerr << "-dm_rows requires OpenCL and -dms_samples, at least one DM per work-group and per work-item, and is not available with -compare_runtime." << std::endl;
+        return 1;
+      }
+    }
+    if ( args.getSwitch("-transpose") ) {
+      maxTransposeTile = args.getSwitchArgument< unsigned int >("-max_tile");
+      if ( cpu || pipelined || compareRuntime || maxSlices > 1 || maxThreadsD1 > 1 || maxItemsD1 > 1 || maxTransposeTile < 2 ) {
+        std::cerr << "-transpose requires OpenCL and a tile of at least two, and is not available with -pipeline, -compare_runtime, -sliced and -dm_rows." << std::endl;
+        return 1;
+      }
+    }
+    if ( args.getSwitch("-search") ) {
+      searchStrategy = args.getSwitchArgument< std::string >("-strategy");
+      searchSeed = args.getSwitchArgument< unsigned int >("-seed");
+      maxEvaluations = args.getSwitchArgument< unsigned int >("-max_evaluations");
+      maxTime = args.getSwitchArgument< double >("-max_time");
+    }
     padding = args.getSwitchArgument< unsigned int >("-padding");
     minThreads = args.getSwitchArgument< unsigned int >("-min_threads");
     maxItems = args.getSwitchArgument< unsigned int >("-max_items");
@@ -79,8 +194,18 @@ int main(int argc, char * argv[]) {
     }
     observation.setDMRange(args.getSwitchArgument< unsigned int >("-dms"), 0.0, 0.0);
   } catch ( isa::utils::EmptyCommandLine & err ) {
-    std::cerr << argv[0] << " [-best] [-dms_samples | -samples_dms] -iterations ... -opencl_platform ... -opencl_device ... -padding ... -min_threads ... -max_threads ... -max_items ... [-subband] -beams ... -dms ... -samples ..." << std::endl;
+    std::cerr << argv[0] << " [-best] [-dms_samples | -samples_dms] -iterations ... [-cpu | -opencl_platform ... -opencl_device ...] [-kernel_cache] [-prewarm] [-compare_runtime] [-roofline] [-profiling] [-subgroup] [-sliced] [-vector] [-dm_rows] [-transpose] [-search] [-pipeline] -padding ... -min_threads ... -max_threads ... -max_items ... [-subband] -beams ... -dms ... -samples ..." << std::endl;
+    std::cerr << argv[0] << " -write_binary -tuned_file ... -binary_file ..." << std::endl;
     std::cerr << "\t -subband : -subbanding_dms ..." << std::endl;
+    std::cerr << "\t -cpu : -min_threads and -max_threads are the number of host threads" << std::endl;
+    std::cerr << "\t -kernel_cache : -cache_directory ..." << std::endl;
+    std::cerr << "\t -prewarm : -tuned_file ... -device_name ... -compile_threads ..." << std::endl;
+    std::cerr << "\t -pipeline : -compile_threads ... (at most 1 with hill_climbing, annealing and model)" << std::endl;
+    std::cerr << "\t -sliced : -max_slices ..." << std::endl;
+    std::cerr << "\t -vector : -max_vector ..." << std::endl;
+    std::cerr << "\t -dm_rows : -max_threads_d1 ... -max_items_d1 ..." << std::endl;
+    std::cerr << "\t -transpose : -max_tile ..." << std::endl;
+    std::cerr << "\t -search : -strategy [exhaustive | random | hill_climbing | annealing | model] -seed ... -max_evaluations ... -max_time ..." << std::endl;
     return 1;
   } catch ( std::exception & err ) {
     std::cerr << err.what() << std::endl;
@@ -93,6 +218,18 @@ int main(int argc, char * argv[]) {
   std::vector< cl::Device > * clDevices = new std::vector< cl::Device >();
   std::vector< std::vector< cl::CommandQueue > > * clQueues = 0;
 
+  if ( subgroup ) {
+    SNR::snrConf subgroupConf;
+
+    subgroupConf.setSubgroupReduction(true);
+    clQueues = new std::vector< std::vector< cl::CommandQueue > >();
+    isa::OpenCL::initializeOpenCL(clPlatformID, 1, clPlatforms, &clContext, clDevices, clQueues);
+    if ( !SNR::isSupportedSNRConf(subgroupConf, clDevices->at(clDeviceID)) ) {
+      std::cerr << "-subgroup requires a device with cl_khr_subgroups." << std::endl;
+      return 1;
+    }
+  }
+
   // Allocate memory
   std::vector< inputDataType > input;
   cl::Buffer input_d, outputSNR_d, outputSample_d;
@@ -124,98 +261,432 @@ int main(int argc, char * argv[]) {
     }
   }
 
-  if ( !bestMode ) {
+  if ( profiling ) {
+    // One JSON record per line, without comments
+    std::cout << std::fixed;
+  } else if ( !bestMode ) {
     std::cout << std::fixed << std::endl;
-    std::cout << "# nrBeams nrDMs nrSamples *configuration* GB/s time stdDeviation COV" << std::endl << std::endl;
+    std::cout << "# nrBeams nrDMs nrSamples *configuration* GB/s time stdDeviation COV" << (roofline ? " roofline" : "") << std::endl << std::endl;
   }
 
-  for ( unsigned int threads = minThreads; threads <= maxThreads; ) {
+  // Tuning space
+  std::vector< SNR::snrConf > configurations;
+  for ( unsigned int threads = minThreads; cpu && threads <= maxThreads; threads++ ) {
     conf.setNrThreadsD0(threads);
-    if ( DMsSamples ) {
-      threads *= 2;
-    } else {
-      threads++;
-    }
     for ( unsigned int itemsPerThread = 1; itemsPerThread <= maxItems; itemsPerThread++ ) {
-      if ( DMsSamples ) {
-        if ( ((itemsPerThread * 5) + 8) > maxItems ) {
-          break;
-        }
-        if ( (observation.getNrSamplesPerBatch() % itemsPerThread) != 0 ) {
-          continue;
-        }
+      conf.setNrItemsD0(itemsPerThread);
+      configurations.push_back(conf);
+    }
+  }
+  // With -transpose the configurations of the other layout are added for every tile, powers of two, timed together with the transpose of the input
+  for ( unsigned int tile = 0; !cpu && tile <= maxTransposeTile && (tile * tile) <= maxThreads; tile = std::max(tile * 2, 2u) ) {
+    const bool layoutDMsSamples = DMsSamples != (tile > 0);
+
+    conf.setTransposeTile(tile);
+    for ( unsigned int threads = minThreads; threads <= maxThreads; ) {
+      conf.setNrThreadsD0(threads);
+      if ( layoutDMsSamples ) {
+        threads *= 2;
       } else {
-        if ( ((itemsPerThread * 5) + 3) > maxItems ) {
-          break;
+        threads++;
+      }
+      for ( unsigned int itemsPerThread = 1; itemsPerThread <= maxItems; itemsPerThread++ ) {
+        if ( layoutDMsSamples ) {
+          if ( ((itemsPerThread * 5) + 8) > maxItems ) {
+            break;
+          }
+          if ( (observation.getNrSamplesPerBatch() % itemsPerThread) != 0 ) {
+            continue;
+          }
+        } else {
+          if ( ((itemsPerThread * 5) + 3) > maxItems ) {
+            break;
+          }
+          if ( observation.getNrDMs() % ( itemsPerThread * conf.getNrThreadsD0()) != 0 ) {
+            continue;
+          }
         }
-        if ( observation.getNrDMs() % ( itemsPerThread * conf.getNrThreadsD0()) != 0 ) {
-          continue;
+        conf.setNrItemsD0(itemsPerThread);
+        // Vector widths, powers of two up to 8 dividing the number of items
+        for ( unsigned int width = 1; width <= std::min(maxVectorWidth, 8u) && (itemsPerThread % width) == 0; width *= 2 ) {
+          conf.setVectorWidth(width);
+          // DMs per work-group, powers of two, and DMs per work-item; the DMs must be divided evenly between work-groups
+          for ( unsigned int threadsD1 = 1; threadsD1 <= maxThreadsD1 && (conf.getNrThreadsD0() * threadsD1) <= maxThreads; threadsD1 *= 2 ) {
+            for ( unsigned int itemsD1 = 1; itemsD1 <= maxItemsD1; itemsD1++ ) {
+              if ( itemsD1 > 1 && ((itemsPerThread * itemsD1 * 5) + 8) > maxItems ) {
+                break;
+              }
+              if ( ((observation.getNrDMs(true) * observation.getNrDMs()) % (threadsD1 * itemsD1)) != 0 ) {
+                continue;
+              }
+              conf.setNrThreadsD1(threadsD1);
+              conf.setNrItemsD1(itemsD1);
+              configurations.push_back(conf);
+              // Number of work-groups splitting the samples, powers of two; the sliced kernel has no vector loads
+              for ( unsigned int slices = 2; !layoutDMsSamples && width == 1 && slices <= std::min(maxSlices, observation.getNrSamplesPerBatch()); slices *= 2 ) {
+                conf.setNrSlices(slices);
+                configurations.push_back(conf);
+              }
+              conf.setNrSlices(1);
+              // Sub-groups can span the rows of a work-group
+              if ( subgroup && layoutDMsSamples && threadsD1 == 1 ) {
+                conf.setSubgroupReduction(true);
+                configurations.push_back(conf);
+                conf.setSubgroupReduction(false);
+              }
+            }
+          }
+          conf.setNrThreadsD1(1);
+          conf.setNrItemsD1(1);
         }
+        conf.setVectorWidth(1);
       }
-      conf.setNrItemsD0(itemsPerThread);
+    }
+  }
+  conf.setTransposeTile(0);
+  SNR::snrSearch * search = SNR::getSNRSearch(searchStrategy, configurations, searchSeed);
+  if ( search == 0 ) {
+    std::cerr << "Unknown search strategy: " << searchStrategy << "." << std::endl;
+    return 1;
+  }
+  search->setMaxEvaluations(maxEvaluations);
+  search->setMaxTime(maxTime);
+
+  // Native CPU tuning
+  while ( cpu && search->next(conf) ) {
+    double gbs = isa::utils::giga((observation.getNrSynthesizedBeams() * static_cast< uint64_t >(observation.getNrDMs(true) * observation.getNrDMs()) * observation.getNrSamplesPerBatch() * sizeof(inputDataType)) + (observation.getNrSynthesizedBeams() * static_cast< uint64_t >(observation.getNrDMs(true) * observation.getNrDMs()) * sizeof(float)) + (observation.getNrSynthesizedBeams() * static_cast< uint64_t >(observation.getNrDMs(true) * observation.getNrDMs()) * sizeof(unsigned int)));
+    std::vector< float > outputSNR(observation.getNrSynthesizedBeams() * isa::utils::pad(observation.getNrDMs(true) * observation.getNrDMs(), padding / sizeof(float)));
+    std::vector< unsigned int > outputSample(observation.getNrSynthesizedBeams() * isa::utils::pad(observation.getNrDMs(true) * observation.getNrDMs(), padding / sizeof(unsigned int)));
+    isa::utils::Timer timer;
 
-      // Generate kernel
-      double gbs = isa::utils::giga((observation.getNrSynthesizedBeams() * static_cast< uint64_t >(observation.getNrDMs(true) * observation.getNrDMs()) * observation.getNrSamplesPerBatch() * sizeof(inputDataType)) + (observation.getNrSynthesizedBeams() * static_cast< uint64_t >(observation.getNrDMs(true) * observation.getNrDMs()) * sizeof(float)) + (observation.getNrSynthesizedBeams() * static_cast< uint64_t >(observation.getNrDMs(true) * observation.getNrDMs()) * sizeof(unsigned int)));
-      cl::Kernel * kernel;
-      isa::utils::Timer timer;
-      std::string * code;
+    // Warm-up run and tuning runs
+    for ( unsigned int iteration = 0; iteration <= nrIterations; iteration++ ) {
+      if ( iteration > 0 ) {
+        timer.start();
+      }
       if ( DMsSamples ) {
-        code = SNR::getSNRDMsSamplesOpenCL< inputDataType >(conf, inputDataName, observation, observation.getNrSamplesPerBatch(), padding);
+        SNR::snrDMsSamplesCPU< inputDataType >(conf, observation, observation.getNrSamplesPerBatch(), padding, input, outputSNR, outputSample);
       } else {
-        code = SNR::getSNRSamplesDMsOpenCL< inputDataType >(conf, inputDataName, observation, observation.getNrSamplesPerBatch(), padding);
+        SNR::snrSamplesDMsCPU< inputDataType >(conf, observation, observation.getNrSamplesPerBatch(), padding, input, outputSNR, outputSample);
+      }
+      if ( iteration > 0 ) {
+        timer.stop();
       }
+    }
+
+    if ( (gbs / timer.getAverageTime()) > bestGBs ) {
+      bestGBs = gbs / timer.getAverageTime();
+      bestConf = conf;
+    }
+    if ( !bestMode ) {
+      std::cout << observation.getNrSynthesizedBeams() << " " << observation.getNrDMs(true) * observation.getNrDMs() << " " << observation.getNrSamplesPerBatch() << " ";
+      std::cout << conf.print() << " ";
+      std::cout << std::setprecision(3);
+      std::cout << gbs / timer.getAverageTime() << " ";
+      std::cout << std::setprecision(6);
+      std::cout << timer.getAverageTime() << " " << timer.getStandardDeviation() << " " << timer.getCoefficientOfVariation() << std::endl;
+    }
+    search->report(gbs / timer.getAverageTime());
+  }
+
+  // OpenCL tuning
+  SNR::snrKernelCache kernelCache(kernelCacheDirectory);
+  if ( prewarm ) {
+    SNR::snrConfTable tunedSNR;
+
+    try {
+      SNR::readTunedSNRConf(tunedSNR, tunedFile);
+    } catch ( AstroData::FileError & err ) {
+      std::cerr << err.what() << std::endl;
+      return 1;
+    }
+    clQueues = new std::vector< std::vector< cl::CommandQueue > >();
+    isa::OpenCL::initializeOpenCL(clPlatformID, 1, clPlatforms, &clContext, clDevices, clQueues);
+    SNR::prewarmSNRKernels< inputDataType >(kernelCache, tunedSNR, deviceName, DMsSamples, inputDataName, observation, padding, clContext, clDevices->at(clDeviceID), nrCompileThreads);
+    std::cout << "# prewarm " << kernelCache.getNrHits() << " " << kernelCache.getNrMisses() << std::endl;
+    return 0;
+  }
+  while ( !cpu && !pipelined && search->next(conf) ) {
+    // Generate kernel
+    double gbs = isa::utils::giga((observation.getNrSynthesizedBeams() * static_cast< uint64_t >(observation.getNrDMs(true) * observation.getNrDMs()) * observation.getNrSamplesPerBatch() * sizeof(inputDataType)) + (observation.getNrSynthesizedBeams() * static_cast< uint64_t >(observation.getNrDMs(true) * observation.getNrDMs()) * sizeof(float)) + (observation.getNrSynthesizedBeams() * static_cast< uint64_t >(observation.getNrDMs(true) * observation.getNrDMs()) * sizeof(unsigned int)));
+    cl::Kernel * kernel = 0;
+    cl::Kernel * mergeKernel = 0;
+    cl::Kernel * transposeKernel = 0;
+    cl::Buffer partials_d, partialSamples_d, transposed_d;
+    cl::Event sliceEvent;
+    cl::Event transposeEvent;
+    isa::utils::Timer timer;
+    isa::utils::Timer compileTimer;
+    SNR::snrProfile profile;
+    std::string * code;
+    std::string * mergeCode = 0;
+    std::string * transposeCode = 0;
+    // Layout of the SNR kernel, the one of the input unless the input is transposed
+    const bool layoutDMsSamples = DMsSamples != (conf.getTransposeTile() > 0);
+    if ( layoutDMsSamples ) {
+      code = SNR::getSNRDMsSamplesOpenCL< inputDataType >(conf, inputDataName, observation, observation.getNrSamplesPerBatch(), padding);
+    } else if ( conf.getNrSlices() > 1 ) {
+      code = SNR::getSNRSamplesDMsSlicedOpenCL< inputDataType >(conf, inputDataName, observation, observation.getNrSamplesPerBatch(), padding);
+      mergeCode = SNR::getSNRSamplesDMsMergeOpenCL(conf, observation, observation.getNrSamplesPerBatch(), padding);
+    } else {
+      code = SNR::getSNRSamplesDMsOpenCL< inputDataType >(conf, inputDataName, observation, observation.getNrSamplesPerBatch(), padding);
+    }
+    if ( conf.getTransposeTile() > 0 ) {
+      transposeCode = SNR::getSNRTransposeOpenCL< inputDataType >(conf, inputDataName, observation, observation.getNrSamplesPerBatch(), padding, DMsSamples);
+    }
 
-      if ( reinitializeDeviceMemory ) {
-        delete clQueues;
-        clQueues = new std::vector< std::vector< cl::CommandQueue > >();
-        isa::OpenCL::initializeOpenCL(clPlatformID, 1, clPlatforms, &clContext, clDevices, clQueues);
+    if ( reinitializeDeviceMemory ) {
+      delete clQueues;
+      clQueues = new std::vector< std::vector< cl::CommandQueue > >();
+      isa::OpenCL::initializeOpenCL(clPlatformID, 1, clPlatforms, &clContext, clDevices, clQueues);
+      if ( profiling ) {
+        clQueues->at(clDeviceID)[0] = cl::CommandQueue(clContext, clDevices->at(clDeviceID), CL_QUEUE_PROFILING_ENABLE);
+      }
+      try {
+        initializeDeviceMemoryD(clContext, &(clQueues->at(clDeviceID)[0]), &input, &input_d, &outputSNR_d, observation.getNrSynthesizedBeams() * isa::utils::pad(observation.getNrDMs(true) * observation.getNrDMs(), padding / sizeof(float)) * sizeof(float), &outputSample_d, observation.getNrSynthesizedBeams() * isa::utils::pad(observation.getNrDMs(true) * observation.getNrDMs(), padding / sizeof(unsigned int)) * sizeof(unsigned int));
+      } catch ( cl::Error & err ) {
+        return -1;
+      }
+      if ( roofline && peakGBs == 0.0 ) {
         try {
-          initializeDeviceMemoryD(clContext, &(clQueues->at(clDeviceID)[0]), &input, &input_d, &outputSNR_d, observation.getNrSynthesizedBeams() * isa::utils::pad(observation.getNrDMs(true) * observation.getNrDMs(), padding / sizeof(float)) * sizeof(float), &outputSample_d, observation.getNrSynthesizedBeams() * isa::utils::pad(observation.getNrDMs(true) * observation.getNrDMs(), padding / sizeof(unsigned int)) * sizeof(unsigned int));
+          peakGBs = measureBandwidth(clContext, clDevices->at(clDeviceID), &(clQueues->at(clDeviceID)[0]), &input_d, input.size() * sizeof(inputDataType), nrIterations);
+        } catch ( isa::OpenCL::OpenCLError & err ) {
+          std::cerr << err.what() << std::endl;
+          return -1;
         } catch ( cl::Error & err ) {
+          std::cerr << "OpenCL error bandwidth probe: " << std::to_string(err.err()) << "." << std::endl;
           return -1;
         }
-        reinitializeDeviceMemory = false;
+        if ( !bestMode && profiling ) {
+          std::cout << std::setprecision(3);
+          std::cout << "{\"bandwidth\": " << peakGBs << "}" << std::endl;
+        } else if ( !bestMode ) {
+          std::cout << std::setprecision(3);
+          std::cout << "# bandwidth " << peakGBs << std::endl;
+        }
       }
-      try {
-        if ( DMsSamples ) {
-          kernel = isa::OpenCL::compile("snrDMsSamples" + std::to_string(observation.getNrSamplesPerBatch()), *code, "-cl-mad-enable -Werror", clContext, clDevices->at(clDeviceID));
+      reinitializeDeviceMemory = false;
+    }
+    compileTimer.start();
+    try {
+      if ( mergeCode != 0 ) {
+        if ( useKernelCache ) {
+          kernel = SNR::getSNRSlicedKernel< inputDataType >(kernelCache, conf, inputDataName, observation, observation.getNrSamplesPerBatch(), padding, clContext, clDevices->at(clDeviceID), &mergeKernel);
         } else {
-          kernel = isa::OpenCL::compile("snrSamplesDMs" + std::to_string(observation.getNrDMs(true) * observation.getNrDMs()), *code, "-cl-mad-enable -Werror", clContext, clDevices->at(clDeviceID));
+          kernel = isa::OpenCL::compile("snrSamplesDMsSliced" + std::to_string(observation.getNrDMs(true) * observation.getNrDMs()), *code, "-cl-mad-enable -Werror", clContext, clDevices->at(clDeviceID));
+          mergeKernel = isa::OpenCL::compile("snrSamplesDMsMerge" + std::to_string(observation.getNrDMs(true) * observation.getNrDMs()), *mergeCode, "-cl-mad-enable -Werror", clContext, clDevices->at(clDeviceID));
         }
-      } catch ( isa::OpenCL::OpenCLError & err ) {
-        std::cerr << err.what() << std::endl;
-        delete code;
-        break;
+      } else if ( useKernelCache ) {
+        kernel = SNR::getSNRKernel< inputDataType >(kernelCache, layoutDMsSamples, conf, inputDataName, observation, observation.getNrSamplesPerBatch(), padding, clContext, clDevices->at(clDeviceID));
+      } else if ( layoutDMsSamples ) {
+        kernel = isa::OpenCL::compile("snrDMsSamples" + std::to_string(observation.getNrSamplesPerBatch()), *code, SNR::getSNRBuildFlags(conf), clContext, clDevices->at(clDeviceID));
+      } else {
+        kernel = isa::OpenCL::compile("snrSamplesDMs" + std::to_string(observation.getNrDMs(true) * observation.getNrDMs()), *code, SNR::getSNRBuildFlags(conf), clContext, clDevices->at(clDeviceID));
       }
+      if ( transposeCode != 0 && useKernelCache ) {
+        transposeKernel = SNR::getSNRTransposeKernel< inputDataType >(kernelCache, DMsSamples, conf, inputDataName, observation, observation.getNrSamplesPerBatch(), padding, clContext, clDevices->at(clDeviceID));
+      } else if ( transposeCode != 0 ) {
+        transposeKernel = isa::OpenCL::compile("snrTranspose" + std::string(DMsSamples ? "DMsSamples" : "SamplesDMs") + std::to_string(observation.getNrSamplesPerBatch()), *transposeCode, "-cl-mad-enable -Werror", clContext, clDevices->at(clDeviceID));
+      }
+    } catch ( isa::OpenCL::OpenCLError & err ) {
+      std::cerr << err.what() << std::endl;
+      // Only the sliced kernel, or the SNR kernel before the transpose, can be compiled at this point
+      delete kernel;
       delete code;
+      delete mergeCode;
+      delete transposeCode;
+      search->report(0.0);
+      continue;
+    }
+    compileTimer.stop();
+    uint64_t sourceSize = code->size();
+    delete code;
+    if ( mergeCode != 0 ) {
+      sourceSize += mergeCode->size();
+      delete mergeCode;
+    }
+    if ( transposeCode != 0 ) {
+      sourceSize += transposeCode->size();
+      delete transposeCode;
+    }
 
-      cl::NDRange global, local;
-      if ( DMsSamples ) {
-        global = cl::NDRange(conf.getNrThreadsD0(), observation.getNrDMs(true) * observation.getNrDMs(), observation.getNrSynthesizedBeams());
-        local = cl::NDRange(conf.getNrThreadsD0(), 1, 1);
+    cl::NDRange global, local;
+    cl::NDRange transposeGlobal, transposeLocal;
+    if ( layoutDMsSamples ) {
+      global = cl::NDRange(conf.getNrThreadsD0(), (observation.getNrDMs(true) * observation.getNrDMs()) / conf.getNrItemsD1(), observation.getNrSynthesizedBeams());
+      local = cl::NDRange(conf.getNrThreadsD0(), conf.getNrThreadsD1(), 1);
+    } else {
+      global = cl::NDRange((observation.getNrDMs(true) * observation.getNrDMs()) / conf.getNrItemsD0(), observation.getNrSynthesizedBeams());
+      local = cl::NDRange(conf.getNrThreadsD0(), 1);
+    }
+    if ( conf.getTransposeTile() > 0 && DMsSamples ) {
+      transposeGlobal = cl::NDRange(isa::utils::pad(observation.getNrSamplesPerBatch(), conf.getTransposeTile()), isa::utils::pad(observation.getNrDMs(true) * observation.getNrDMs(), conf.getTransposeTile()), observation.getNrSynthesizedBeams());
+      transposeLocal = cl::NDRange(conf.getTransposeTile(), conf.getTransposeTile(), 1);
+    } else if ( conf.getTransposeTile() > 0 ) {
+      transposeGlobal = cl::NDRange(isa::utils::pad(observation.getNrDMs(true) * observation.getNrDMs(), conf.getTransposeTile()), isa::utils::pad(observation.getNrSamplesPerBatch(), conf.getTransposeTile()), observation.getNrSynthesizedBeams());
+      transposeLocal = cl::NDRange(conf.getTransposeTile(), conf.getTransposeTile(), 1);
+    }
+
+    try {
+      if ( transposeKernel != 0 ) {
+        // The SNR kernel reads the transposed input
+        if ( DMsSamples ) {
+          transposed_d = cl::Buffer(clContext, CL_MEM_READ_WRITE, observation.getNrSynthesizedBeams() * observation.getNrSamplesPerBatch() * isa::utils::pad(observation.getNrDMs(true) * observation.getNrDMs(), padding / sizeof(inputDataType)) * sizeof(inputDataType), 0, 0);
+        } else {
+          transposed_d = cl::Buffer(clContext, CL_MEM_READ_WRITE, observation.getNrSynthesizedBeams() * observation.getNrDMs(true) * observation.getNrDMs() * observation.getNrSamplesPerBatch(false, padding / sizeof(inputDataType)) * sizeof(inputDataType), 0, 0);
+        }
+        transposeKernel->setArg(0, input_d);
+        transposeKernel->setArg(1, transposed_d);
+        kernel->setArg(0, transposed_d);
+      } else {
+        kernel->setArg(0, input_d);
+      }
+      if ( mergeKernel != 0 ) {
+        // The sliced kernel writes the partial statistics, the merge kernel the outputs
+        partials_d = cl::Buffer(clContext, CL_MEM_READ_WRITE, observation.getNrSynthesizedBeams() * conf.getNrSlices() * observation.getNrDMs(true) * observation.getNrDMs() * 4 * sizeof(float), 0, 0);
+        partialSamples_d = cl::Buffer(clContext, CL_MEM_READ_WRITE, observation.getNrSynthesizedBeams() * conf.getNrSlices() * observation.getNrDMs(true) * observation.getNrDMs() * sizeof(unsigned int), 0, 0);
+        kernel->setArg(1, partials_d);
+        kernel->setArg(2, partialSamples_d);
+        mergeKernel->setArg(0, partials_d);
+        mergeKernel->setArg(1, partialSamples_d);
+        mergeKernel->setArg(2, outputSNR_d);
+        mergeKernel->setArg(3, outputSample_d);
       } else {
-        global = cl::NDRange((observation.getNrDMs(true) * observation.getNrDMs()) / conf.getNrItemsD0(), observation.getNrSynthesizedBeams());
-        local = cl::NDRange(conf.getNrThreadsD0(), 1);
+        kernel->setArg(1, outputSNR_d);
+        kernel->setArg(2, outputSample_d);
       }
+      // Warm-up run
+      clQueues->at(clDeviceID)[0].finish();
+      if ( transposeKernel != 0 ) {
+        clQueues->at(clDeviceID)[0].enqueueNDRangeKernel(*transposeKernel, cl::NullRange, transposeGlobal, transposeLocal, 0, &transposeEvent);
+      }
+      if ( mergeKernel != 0 ) {
+        clQueues->at(clDeviceID)[0].enqueueNDRangeKernel(*kernel, cl::NullRange, cl::NDRange((observation.getNrDMs(true) * observation.getNrDMs()) / conf.getNrItemsD0(), conf.getNrSlices(), observation.getNrSynthesizedBeams()), cl::NDRange(conf.getNrThreadsD0(), 1, 1), 0, &sliceEvent);
+        clQueues->at(clDeviceID)[0].enqueueNDRangeKernel(*mergeKernel, cl::NullRange, global, local, 0, &event);
+      } else {
+        clQueues->at(clDeviceID)[0].enqueueNDRangeKernel(*kernel, cl::NullRange, global, local, 0, &event);
+      }
+      event.wait();
+      // Tuning runs
+      for ( unsigned int iteration = 0; iteration < nrIterations; iteration++ ) {
+        timer.start();
+        if ( transposeKernel != 0 ) {
+          clQueues->at(clDeviceID)[0].enqueueNDRangeKernel(*transposeKernel, cl::NullRange, transposeGlobal, transposeLocal, 0, &transposeEvent);
+        }
+        if ( mergeKernel != 0 ) {
+          clQueues->at(clDeviceID)[0].enqueueNDRangeKernel(*kernel, cl::NullRange, cl::NDRange((observation.getNrDMs(true) * observation.getNrDMs()) / conf.getNrItemsD0(), conf.getNrSlices(), observation.getNrSynthesizedBeams()), cl::NDRange(conf.getNrThreadsD0(), 1, 1), 0, &sliceEvent);
+          clQueues->at(clDeviceID)[0].enqueueNDRangeKernel(*mergeKernel, cl::NullRange, global, local, 0, &event);
+        } else {
+          clQueues->at(clDeviceID)[0].enqueueNDRangeKernel(*kernel, cl::NullRange, global, local, 0, &event);
+        }
+        event.wait();
+        timer.stop();
+        if ( profiling && mergeKernel != 0 ) {
+          profile.addEvent(sliceEvent, event);
+        } else if ( profiling && transposeKernel != 0 ) {
+          profile.addEvent(transposeEvent, event);
+        } else if ( profiling ) {
+          profile.addEvent(event);
+        }
+      }
+    } catch ( cl::Error & err ) {
+      std::cerr << "OpenCL error kernel execution (";
+      std::cerr << conf.print();
+      std::cerr << "): " << std::to_string(err.err()) << "." << std::endl;
+      delete kernel;
+      delete mergeKernel;
+      delete transposeKernel;
+      if ( err.err() == -4 || err.err() == -61 ) {
+        return -1;
+      }
+      reinitializeDeviceMemory = true;
+      search->report(0.0);
+      continue;
+    }
+    delete kernel;
+    delete mergeKernel;
+    delete transposeKernel;
 
-      kernel->setArg(0, input_d);
-      kernel->setArg(1, outputSNR_d);
-      kernel->setArg(2, outputSample_d);
+    // With profiling the kernel time comes from the events, without launch and wake-up overhead; the host time is kept if the events have no timestamps
+    double time = timer.getAverageTime();
+    if ( profiling && profile.getMeanKernelTime() > 0.0 ) {
+      time = profile.getMeanKernelTime();
+    }
+    if ( (gbs / time) > bestGBs ) {
+      bestGBs = gbs / time;
+      bestConf = conf;
+    }
+    if ( !bestMode && profiling ) {
+      std::cout << std::setprecision(6);
+      std::cout << "{\"beams\": " << observation.getNrSynthesizedBeams() << ", \"dms\": " << observation.getNrDMs(true) * observation.getNrDMs() << ", \"samples\": " << observation.getNrSamplesPerBatch() << ", ";
+      std::cout << "\"configuration\": \"" << conf.print() << "\", \"source_bytes\": " << sourceSize << ", \"compile_time\": " << compileTimer.getAverageTime() << ", ";
+      std::cout << "\"gbs\": " << gbs / time << ", ";
+      if ( peakGBs > 0.0 ) {
+        std::cout << "\"roofline\": " << (100.0 * (gbs / time)) / peakGBs << ", ";
+      }
+      std::cout << std::setprecision(9);
+      std::cout << "\"host_time\": " << timer.getAverageTime() << ", ";
+      std::cout << "\"profile\": " << profile.getJSON() << "}" << std::endl;
+    } else if ( !bestMode ) {
+      std::cout << observation.getNrSynthesizedBeams() << " " << observation.getNrDMs(true) * observation.getNrDMs() << " " << observation.getNrSamplesPerBatch() << " ";
+      std::cout << conf.print() << " ";
+      std::cout << std::setprecision(3);
+      std::cout << gbs / timer.getAverageTime() << " ";
+      std::cout << std::setprecision(6);
+      std::cout << timer.getAverageTime() << " " << timer.getStandardDeviation() << " " << timer.getCoefficientOfVariation();
+      if ( roofline ) {
+        std::cout << std::setprecision(1);
+        std::cout << " " << (100.0 * (gbs / timer.getAverageTime())) / peakGBs;
+      }
+      std::cout << std::endl;
+    }
+    search->report(gbs / time);
 
+    // Same configuration, with the shape of the input passed at run time
+    if ( compareRuntime && !bestMode ) {
+      isa::utils::Timer runtimeTimer;
+
+      // The runtime DMsSamples kernel loads nrThreadsD0 * nrItemsD0 samples before checking the number of samples
+      if ( DMsSamples && observation.getNrSamplesPerBatch() < (conf.getNrThreadsD0() * conf.getNrItemsD0()) ) {
+        std::cerr << "Runtime kernel skipped (" << conf.print() << "): fewer samples than nrThreadsD0 * nrItemsD0." << std::endl;
+        continue;
+      }
+      if ( DMsSamples ) {
+        code = SNR::getSNRDMsSamplesRuntimeOpenCL< inputDataType >(conf, inputDataName, padding);
+      } else {
+        code = SNR::getSNRSamplesDMsRuntimeOpenCL< inputDataType >(conf, inputDataName, padding);
+      }
       try {
+        if ( DMsSamples ) {
+          kernel = isa::OpenCL::compile("snrDMsSamplesRuntime", *code, "-cl-mad-enable -Werror", clContext, clDevices->at(clDeviceID));
+        } else {
+          kernel = isa::OpenCL::compile("snrSamplesDMsRuntime", *code, "-cl-mad-enable -Werror", clContext, clDevices->at(clDeviceID));
+        }
+      } catch ( isa::OpenCL::OpenCLError & err ) {
+        std::cerr << err.what() << std::endl;
+        delete code;
+        continue;
+      }
+      delete code;
+      try {
+        kernel->setArg(0, input_d);
+        kernel->setArg(1, outputSNR_d);
+        kernel->setArg(2, outputSample_d);
+        kernel->setArg(3, observation.getNrSamplesPerBatch());
+        kernel->setArg(4, observation.getNrDMs(true) * observation.getNrDMs());
         // Warm-up run
         clQueues->at(clDeviceID)[0].finish();
         clQueues->at(clDeviceID)[0].enqueueNDRangeKernel(*kernel, cl::NullRange, global, local, 0, &event);
         event.wait();
         // Tuning runs
         for ( unsigned int iteration = 0; iteration < nrIterations; iteration++ ) {
-          timer.start();
+          runtimeTimer.start();
           clQueues->at(clDeviceID)[0].enqueueNDRangeKernel(*kernel, cl::NullRange, global, local, 0, &event);
           event.wait();
-          timer.stop();
+          runtimeTimer.stop();
         }
       } catch ( cl::Error & err ) {
-        std::cerr << "OpenCL error kernel execution (";
+        std::cerr << "OpenCL error runtime kernel execution (";
         std::cerr << conf.print();
         std::cerr << "): " << std::to_string(err.err()) << "." << std::endl;
         delete kernel;
@@ -223,28 +694,187 @@ int main(int argc, char * argv[]) {
           return -1;
         }
         reinitializeDeviceMemory = true;
-        break;
+        continue;
       }
       delete kernel;
 
-      if ( (gbs / timer.getAverageTime()) > bestGBs ) {
-        bestGBs = gbs / timer.getAverageTime();
-        bestConf = conf;
+      std::cout << "# runtime ";
+      std::cout << std::setprecision(3);
+      std::cout << gbs / runtimeTimer.getAverageTime() << " ";
+      std::cout << std::setprecision(6);
+      std::cout << runtimeTimer.getAverageTime() << " " << runtimeTimer.getStandardDeviation() << " " << runtimeTimer.getCoefficientOfVariation() << " ";
+      std::cout << std::setprecision(3);
+      std::cout << timer.getAverageTime() / runtimeTimer.getAverageTime() << std::endl;
+    }
+  }
+
+  // Pipelined OpenCL tuning, nrCompileThreads configurations are generated and compiled on host threads while the device measures the oldest one
+  // The configurations compiled ahead are selected without the performance of the ones still in the pipeline, so the adaptive strategies only look one configuration ahead
+  std::deque< std::pair< SNR::snrConf, std::future< cl::Kernel * > > > pipeline;
+  unsigned int nrLookAhead = nrCompileThreads;
+  if ( searchStrategy == "hill_climbing" || searchStrategy == "annealing" || searchStrategy == "model" ) {
+    nrLookAhead = std::min(nrCompileThreads, 1u);
+  }
+  auto compileKernel = [&](const SNR::snrConf kernelConf) -> cl::Kernel * {
+    cl::Kernel * kernel = 0;
+    std::string * code = 0;
+
+    if ( useKernelCache ) {
+      return SNR::getSNRKernel< inputDataType >(kernelCache, DMsSamples, kernelConf, inputDataName, observation, observation.getNrSamplesPerBatch(), padding, clContext, clDevices->at(clDeviceID));
+    }
+    if ( DMsSamples ) {
+      code = SNR::getSNRDMsSamplesOpenCL< inputDataType >(kernelConf, inputDataName, observation, observation.getNrSamplesPerBatch(), padding);
+    } else {
+      code = SNR::getSNRSamplesDMsOpenCL< inputDataType >(kernelConf, inputDataName, observation, observation.getNrSamplesPerBatch(), padding);
+    }
+    try {
+      if ( DMsSamples ) {
+        kernel = isa::OpenCL::compile("snrDMsSamples" + std::to_string(observation.getNrSamplesPerBatch()), *code, SNR::getSNRBuildFlags(kernelConf), clContext, clDevices->at(clDeviceID));
+      } else {
+        kernel = isa::OpenCL::compile("snrSamplesDMs" + std::to_string(observation.getNrDMs(true) * observation.getNrDMs()), *code, SNR::getSNRBuildFlags(kernelConf), clContext, clDevices->at(clDeviceID));
+      }
+    } catch ( isa::OpenCL::OpenCLError & err ) {
+      delete code;
+      throw;
+    }
+    delete code;
+
+    return kernel;
+  };
+  while ( !cpu && pipelined ) {
+    SNR::snrConf nextConf;
+    cl::Kernel * kernel = 0;
+    isa::utils::Timer timer;
+    double gbs = isa::utils::giga((observation.getNrSynthesizedBeams() * static_cast< uint64_t >(observation.getNrDMs(true) * observation.getNrDMs()) * observation.getNrSamplesPerBatch() * sizeof(inputDataType)) + (observation.getNrSynthesizedBeams() * static_cast< uint64_t >(observation.getNrDMs(true) * observation.getNrDMs()) * sizeof(float)) + (observation.getNrSynthesizedBeams() * static_cast< uint64_t >(observation.getNrDMs(true) * observation.getNrDMs()) * sizeof(unsigned int)));
+
+    if ( reinitializeDeviceMemory ) {
+      // Kernels compiled for the previous context cannot be used
+      for ( auto entry = pipeline.begin(); entry != pipeline.end(); ++entry ) {
+        try {
+          delete entry->second.get();
+        } catch ( isa::OpenCL::OpenCLError & err ) {
+        } catch ( cl::Error & err ) {
+        }
+      }
+      delete clQueues;
+      clQueues = new std::vector< std::vector< cl::CommandQueue > >();
+      isa::OpenCL::initializeOpenCL(clPlatformID, 1, clPlatforms, &clContext, clDevices, clQueues);
+      try {
+        initializeDeviceMemoryD(clContext, &(clQueues->at(clDeviceID)[0]), &input, &input_d, &outputSNR_d, observation.getNrSynthesizedBeams() * isa::utils::pad(observation.getNrDMs(true) * observation.getNrDMs(), padding / sizeof(float)) * sizeof(float), &outputSample_d, observation.getNrSynthesizedBeams() * isa::utils::pad(observation.getNrDMs(true) * observation.getNrDMs(), padding / sizeof(unsigned int)) * sizeof(unsigned int));
+      } catch ( cl::Error & err ) {
+        return -1;
+      }
+      if ( roofline && peakGBs == 0.0 ) {
+        try {
+          peakGBs = measureBandwidth(clContext, clDevices->at(clDeviceID), &(clQueues->at(clDeviceID)[0]), &input_d, input.size() * sizeof(inputDataType), nrIterations);
+        } catch ( isa::OpenCL::OpenCLError & err ) {
+          std::cerr << err.what() << std::endl;
+          return -1;
+        } catch ( cl::Error & err ) {
+          std::cerr << "OpenCL error bandwidth probe: " << std::to_string(err.err()) << "." << std::endl;
+          return -1;
+        }
+        if ( !bestMode ) {
+          std::cout << std::setprecision(3);
+          std::cout << "# bandwidth " << peakGBs << std::endl;
+        }
+      }
+      for ( auto entry = pipeline.begin(); entry != pipeline.end(); ++entry ) {
+        entry->second = std::async(std::launch::async, compileKernel, entry->first);
+      }
+      reinitializeDeviceMemory = false;
+    }
+    while ( pipeline.size() < (nrLookAhead + 1) && search->next(nextConf) ) {
+      pipeline.push_back(std::make_pair(nextConf, std::async(std::launch::async, compileKernel, nextConf)));
+    }
+    if ( pipeline.empty() ) {
+      break;
+    }
+    conf = pipeline.front().first;
+    try {
+      kernel = pipeline.front().second.get();
+    } catch ( isa::OpenCL::OpenCLError & err ) {
+      std::cerr << err.what() << std::endl;
+    } catch ( cl::Error & err ) {
+      std::cerr << "OpenCL error kernel compilation (" << conf.print() << "): " << std::to_string(err.err()) << "." << std::endl;
+    }
+    pipeline.pop_front();
+    if ( kernel == 0 ) {
+      search->report(0.0);
+      continue;
+    }
+
+    cl::NDRange global, local;
+    if ( DMsSamples ) {
+      global = cl::NDRange(conf.getNrThreadsD0(), (observation.getNrDMs(true) * observation.getNrDMs()) / conf.getNrItemsD1(), observation.getNrSynthesizedBeams());
+      local = cl::NDRange(conf.getNrThreadsD0(), conf.getNrThreadsD1(), 1);
+    } else {
+      global = cl::NDRange((observation.getNrDMs(true) * observation.getNrDMs()) / conf.getNrItemsD0(), observation.getNrSynthesizedBeams());
+      local = cl::NDRange(conf.getNrThreadsD0(), 1);
+    }
+
+    kernel->setArg(0, input_d);
+    kernel->setArg(1, outputSNR_d);
+    kernel->setArg(2, outputSample_d);
+
+    try {
+      // Warm-up run
+      clQueues->at(clDeviceID)[0].finish();
+      clQueues->at(clDeviceID)[0].enqueueNDRangeKernel(*kernel, cl::NullRange, global, local, 0, &event);
+      event.wait();
+      // Tuning runs
+      for ( unsigned int iteration = 0; iteration < nrIterations; iteration++ ) {
+        timer.start();
+        clQueues->at(clDeviceID)[0].enqueueNDRangeKernel(*kernel, cl::NullRange, global, local, 0, &event);
+        event.wait();
+        timer.stop();
       }
-      if ( !bestMode ) {
-        std::cout << observation.getNrSynthesizedBeams() << " " << observation.getNrDMs(true) * observation.getNrDMs() << " " << observation.getNrSamplesPerBatch() << " ";
-        std::cout << conf.print() << " ";
-        std::cout << std::setprecision(3);
-        std::cout << gbs / timer.getAverageTime() << " ";
-        std::cout << std::setprecision(6);
-        std::cout << timer.getAverageTime() << " " << timer.getStandardDeviation() << " " << timer.getCoefficientOfVariation() << std::endl;
+    } catch ( cl::Error & err ) {
+      std::cerr << "OpenCL error kernel execution (";
+      std::cerr << conf.print();
+      std::cerr << "): " << std::to_string(err.err()) << "." << std::endl;
+      delete kernel;
+      if ( err.err() == -4 || err.err() == -61 ) {
+        return -1;
       }
+      reinitializeDeviceMemory = true;
+      search->report(0.0);
+      continue;
     }
+    delete kernel;
+
+    if ( (gbs / timer.getAverageTime()) > bestGBs ) {
+      bestGBs = gbs / timer.getAverageTime();
+      bestConf = conf;
+    }
+    if ( !bestMode ) {
+      std::cout << observation.getNrSynthesizedBeams() << " " << observation.getNrDMs(true) * observation.getNrDMs() << " " << observation.getNrSamplesPerBatch() << " ";
+      std::cout << conf.print() << " ";
+      std::cout << std::setprecision(3);
+      std::cout << gbs / timer.getAverageTime() << " ";
+      std::cout << std::setprecision(6);
+      std::cout << timer.getAverageTime() << " " << timer.getStandardDeviation() << " " << timer.getCoefficientOfVariation();
+      if ( roofline ) {
+        std::cout << std::setprecision(1);
+        std::cout << " " << (100.0 * (gbs / timer.getAverageTime())) / peakGBs;
+      }
+      std::cout << std::endl;
+    }
+    search->report(gbs / timer.getAverageTime());
   }
+  delete search;
 
   if ( bestMode ) {
-    std::cout << observation.getNrDMs(true) * observation.getNrDMs() << " " << observation.getNrSamplesPerBatch() << " " << bestConf.print() << std::endl;
-  } else {
+    std::cout << observation.getNrDMs(true) * observation.getNrDMs() << " " << observation.getNrSamplesPerBatch() << " " << bestConf.print(roofline && peakGBs > 0.0);
+    if ( roofline && peakGBs > 0.0 ) {
+      // Trailing columns after all the fields of the configuration, ignored when reading the tuned configurations
+      std::cout << std::setprecision(3);
+      std::cout << " " << bestGBs << " " << peakGBs << " ";
+      std::cout << std::setprecision(1);
+      std::cout << (100.0 * bestGBs) / peakGBs;
+    }
+    std::cout << std::endl;
+  } else if ( !profiling ) {
     std::cout << std::endl;
   }
 
@@ -264,3 +894,106 @@ void initializeDeviceMemoryD(cl::Context & clContext, cl::CommandQueue * clQueue
   }
 }
 
+
+double measureBandwidth(cl::Context & clContext, cl::Device & clDevice, cl::CommandQueue * clQueue, cl::Buffer * input_d, const uint64_t input_size, const unsigned int nrIterations) {
+  const unsigned int nrItemsPerThread = 16;
+  // Number of float4 elements, a multiple of nrItemsPerThread not larger than the input
+  const uint64_t nrItems = ((input_size / (4 * sizeof(float))) / nrItemsPerThread) * nrItemsPerThread;
+  std::string * code = 0;
+  cl::Kernel * copyKernel = 0;
+  cl::Kernel * readKernel = 0;
+  cl::Buffer output_d;
+  cl::Event event;
+  isa::utils::Timer copyTimer;
+  isa::utils::Timer readTimer;
+
+  if ( nrItems == 0 ) {
+    return 0.0;
+  }
+  code = SNR::getBandwidthOpenCL(nrItemsPerThread);
+  try {
+    copyKernel = isa::OpenCL::compile("bandwidthCopy", *code, "-Werror", clContext, clDevice);
+    readKernel = isa::OpenCL::compile("bandwidthRead", *code, "-Werror", clContext, clDevice);
+  } catch ( isa::OpenCL::OpenCLError & err ) {
+    delete code;
+    delete copyKernel;
+    throw;
+  }
+  delete code;
+  output_d = cl::Buffer(clContext, CL_MEM_WRITE_ONLY, nrItems * 4 * sizeof(float), 0, 0);
+  copyKernel->setArg(0, *input_d);
+  copyKernel->setArg(1, output_d);
+  readKernel->setArg(0, *input_d);
+  readKernel->setArg(1, output_d);
+  // Warm-up runs and measurements
+  for ( unsigned int iteration = 0; iteration <= nrIterations; iteration++ ) {
+    if ( iteration > 0 ) {
+      copyTimer.start();
+    }
+    clQueue->enqueueNDRangeKernel(*copyKernel, cl::NullRange, cl::NDRange(nrItems), cl::NullRange, 0, &event);
+    event.wait();
+    if ( iteration > 0 ) {
+      copyTimer.stop();
+      readTimer.start();
+    }
+    clQueue->enqueueNDRangeKernel(*readKernel, cl::NullRange, cl::NDRange(nrItems / nrItemsPerThread), cl::NullRange, 0, &event);
+    event.wait();
+    if ( iteration > 0 ) {
+      readTimer.stop();
+    }
+  }
+  delete copyKernel;
+  delete readKernel;
+
+  return std::max(isa::utils::giga(2 * nrItems * 4 * sizeof(float)) / copyTimer.getAverageTime(), isa::utils::giga(nrItems * 4 * sizeof(float)) / readTimer.getAverageTime());
+}
+
+unsigned int writeBinary(const std::string & tunedFile, const std::string & binaryFile) {
+  unsigned int nrEntries = 0;
+  unsigned int nrMismatches = 0;
+  SNR::snrConfTable tunedSNR;
+  SNR::snrConfTable binarySNR;
+
+  SNR::readTunedSNRConf(tunedSNR, tunedFile);
+  tunedSNR.writeBinary(binaryFile);
+  binarySNR.readBinary(binaryFile);
+  for ( auto device = tunedSNR.getDevices().begin(); device != tunedSNR.getDevices().end(); ++device ) {
+    auto entries = tunedSNR.getEntries(*device);
+    auto binaryEntries = binarySNR.getEntries(*device);
+
+    if ( (entries.second - entries.first) != (binaryEntries.second - binaryEntries.first) ) {
+      std::cerr << "Wrong number of entries for " << *device << "." << std::endl;
+      nrMismatches++;
+      continue;
+    }
+    for ( auto item = entries.first, binaryItem = binaryEntries.first; item != entries.second; ++item, ++binaryItem ) {
+      nrEntries++;
+      if ( item->nrDMs != binaryItem->nrDMs || item->nrSamples != binaryItem->nrSamples || item->conf.print() != binaryItem->conf.print() ) {
+        std::cerr << "Wrong entry for " << *device << " " << item->nrDMs << " " << item->nrSamples << "." << std::endl;
+        nrMismatches++;
+        continue;
+      }
+      // Exact lookups give the tuned configuration, the closest shapes a valid one
+      for ( unsigned int layout = 0; layout < 2; layout++ ) {
+        const bool DMsSamples = (layout == 1);
+        const bool layoutDMsSamples = DMsSamples != (item->conf.getTransposeTile() > 0);
+
+        if ( SNR::isValidSNRConf(item->conf, layoutDMsSamples, item->nrDMs, item->nrSamples) && binarySNR.getConf(*device, DMsSamples, item->nrDMs, item->nrSamples).print() != item->conf.print() ) {
+          std::cerr << "Wrong lookup for " << *device << " " << item->nrDMs << " " << item->nrSamples << "." << std::endl;
+          nrMismatches++;
+        }
+        try {
+          const SNR::snrConf & closest = binarySNR.getConf(*device, DMsSamples, item->nrDMs * 2, item->nrSamples * 2);
+
+          if ( !SNR::isValidSNRConf(closest, DMsSamples != (closest.getTransposeTile() > 0), item->nrDMs * 2, item->nrSamples * 2) ) {
+            std::cerr << "Invalid closest configuration for " << *device << " " << item->nrDMs * 2 << " " << item->nrSamples * 2 << "." << std::endl;
+            nrMismatches++;
+          }
+        } catch ( std::out_of_range & err ) {
+        }
+      }
+    }
+  }
+  std::cout << "# binary " << tunedSNR.getDevices().size() << " " << nrEntries << " " << nrMismatches << std::endl;
+  return nrMismatches;
+}